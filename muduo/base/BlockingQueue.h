@@ -1,11 +1,16 @@
 #ifndef MUDUO_BASE_BLOCKINGQUEUE_H
 #define MUDUO_BASE_BLOCKINGQUEUE_H
 
+#include "muduo/base/Clock.h"
 #include "muduo/base/Condition.h"
 #include "muduo/base/Mutex.h"
 
-#include <assert.h>
+#include <algorithm>
 #include <deque>
+#include <iterator>
+
+#include <assert.h>
+#include <stddef.h>
 
 namespace muduo
 {
@@ -50,6 +55,47 @@ class BlockingQueue : public noncopyable
     return front;
   }
 
+  /// Waits up to @c timeoutSeconds for at least one element (forever if negative),
+  /// then takes up to @c maxItems in the same critical section.
+  /// @return empty on timeout
+  queue_type takeUpTo(size_t maxItems, double timeoutSeconds = -1.0)
+  {
+    assert(maxItems > 0);
+    queue_type batch;
+    MutexGuard lock(mutex_);
+    if (queue_.empty() && timeoutSeconds != 0.0)
+    {
+      const int64_t deadline = Clock::monotonicMicroseconds() + static_cast<int64_t>(timeoutSeconds * 1e6);
+      while (queue_.empty())
+      {
+        if (timeoutSeconds < 0)
+        {
+          notEmpty_.wait();
+          continue;
+        }
+        const int64_t left = deadline - Clock::monotonicMicroseconds();
+        // 虚假唤醒以后按剩下的时间接着等
+        if (left <= 0 || (notEmpty_.waitForSeconds(static_cast<double>(left) * 1e-6) && queue_.empty()))
+        {
+          return batch;
+        }
+      }
+    }
+    const size_t n = std::min(maxItems, queue_.size());
+    if (n == queue_.size())
+    {
+      batch.swap(queue_);
+    }
+    else
+    {
+      batch.insert(batch.end(), std::make_move_iterator(queue_.begin()), std::make_move_iterator(queue_.begin() + static_cast<std::ptrdiff_t>(n)));
+      queue_.erase(queue_.begin(), queue_.begin() + static_cast<std::ptrdiff_t>(n));
+      // 还有剩的，叫醒下一个消费者
+      notEmpty_.notify();
+    }
+    return batch;
+  }
+
   queue_type drain()  // drain意为排干
   {
     queue_type queue;
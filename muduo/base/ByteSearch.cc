@@ -0,0 +1,310 @@
+#include "muduo/base/ByteSearch.h"
+
+#include <algorithm>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MUDUO_BYTESEARCH_X86 1
+#include <immintrin.h>
+#endif
+
+using namespace muduo;
+
+namespace
+{
+struct Impl
+{
+  const char *name;
+  const char *(*findByte)(const char *, const char *, char);
+  const char *(*findCRLF)(const char *, const char *);
+  const char *(*find)(const char *, const char *, const char *, size_t);
+};
+
+const char *scalarFindByte(const char *begin, const char *end, char c)
+{
+  if (begin == end)
+  {
+    return NULL;
+  }
+  return static_cast<const char *>(::memchr(begin, c, end - begin));
+}
+
+const char *scalarFindCRLF(const char *begin, const char *end)
+{
+  static const char kCRLF[] = "\r\n";
+  const char *crlf = std::search(begin, end, kCRLF, kCRLF + 2);
+  return crlf == end ? NULL : crlf;
+}
+
+const char *scalarFind(const char *begin, const char *end, const char *needle, size_t needleLen)
+{
+  const char *found = std::search(begin, end, needle, needle + needleLen);
+  return found == end ? NULL : found;
+}
+
+#ifdef MUDUO_BYTESEARCH_X86
+
+// mask的每一位对应一个位置，依次检查候选位置
+inline const char *firstMatch(const char *p, unsigned mask, const char *needle, size_t needleLen)
+{
+  while (mask != 0)
+  {
+    int i = __builtin_ctz(mask);
+    if (::memcmp(p + i + 1, needle + 1, needleLen - 2) == 0)
+    {
+      return p + i;
+    }
+    mask &= mask - 1;
+  }
+  return NULL;
+}
+
+// glibc的memchr已经向量化，长距离扫描交给它；短行(HTTP header)自己扫，省掉函数调用和对齐处理的开销
+const ptrdiff_t kShortScan = 64;
+
+__attribute__((target("sse2"))) const char *sse2FindByte(const char *begin, const char *end, char c)
+{
+  const __m128i vc = _mm_set1_epi8(c);
+  const char *p = begin;
+  const char *shortEnd = end - begin > kShortScan ? begin + kShortScan : end;
+  for (; p + 16 <= shortEnd; p += 16)
+  {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, vc)));
+    if (mask != 0)
+    {
+      return p + __builtin_ctz(mask);
+    }
+  }
+  return scalarFindByte(p, end, c);
+}
+
+__attribute__((target("sse2"))) const char *sse2FindCRLF(const char *begin, const char *end)
+{
+  const __m128i cr = _mm_set1_epi8('\r');
+  const char *p = begin;
+  // 只比较'\r'，'\r'很少见，找到了再看下一个字节是不是'\n'
+  for (; p + 17 <= end; p += 16)
+  {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, cr)));
+    while (mask != 0)
+    {
+      int i = __builtin_ctz(mask);
+      if (p[i + 1] == '\n')
+      {
+        return p + i;
+      }
+      mask &= mask - 1;
+    }
+  }
+  return scalarFindCRLF(p, end);
+}
+
+__attribute__((target("sse2"))) const char *sse2Find(const char *begin, const char *end, const char *needle, size_t needleLen)
+{
+  if (needleLen == 1)
+  {
+    return sse2FindByte(begin, end, needle[0]);
+  }
+  // 先用首尾两个字节过滤候选位置，再memcmp中间部分
+  const __m128i first = _mm_set1_epi8(needle[0]);
+  const __m128i last = _mm_set1_epi8(needle[needleLen - 1]);
+  const char *p = begin;
+  for (; p + needleLen - 1 + 16 <= end; p += 16)
+  {
+    __m128i vf = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    __m128i vl = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + needleLen - 1));
+    __m128i eq = _mm_and_si128(_mm_cmpeq_epi8(vf, first), _mm_cmpeq_epi8(vl, last));
+    const char *found = firstMatch(p, static_cast<unsigned>(_mm_movemask_epi8(eq)), needle, needleLen);
+    if (found)
+    {
+      return found;
+    }
+  }
+  return scalarFind(p, end, needle, needleLen);
+}
+
+__attribute__((target("avx2"))) const char *avx2FindByte(const char *begin, const char *end, char c)
+{
+  if (end - begin <= kShortScan)
+  {
+    // 短行用16字节的循环更快，尾部更短
+    return sse2FindByte(begin, end, c);
+  }
+  const __m256i vc = _mm256_set1_epi8(c);
+  __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin));
+  __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin + 32));
+  unsigned mask0 = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v0, vc)));
+  if (mask0 != 0)
+  {
+    return begin + __builtin_ctz(mask0);
+  }
+  unsigned mask1 = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v1, vc)));
+  if (mask1 != 0)
+  {
+    return begin + 32 + __builtin_ctz(mask1);
+  }
+  return scalarFindByte(begin + kShortScan, end, c);
+}
+
+__attribute__((target("avx2"))) inline const char *avx2CheckCR(const char *p, uint64_t mask)
+{
+  while (mask != 0)
+  {
+    int i = __builtin_ctzll(mask);
+    if (p[i + 1] == '\n')
+    {
+      return p + i;
+    }
+    mask &= mask - 1;
+  }
+  return NULL;
+}
+
+__attribute__((target("avx2"))) const char *avx2FindCRLF(const char *begin, const char *end)
+{
+  const __m256i cr = _mm256_set1_epi8('\r');
+  const char *p = begin;
+  // 前kShortScan个字节每次32字节，照顾短行
+  for (; p + 33 <= end && p - begin < kShortScan; p += 32)
+  {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    const char *found = avx2CheckCR(p, static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, cr))));
+    if (found)
+    {
+      return found;
+    }
+  }
+  // 之后每次64字节，没有'\r'的话只需要一次testz
+  for (; p + 65 <= end; p += 64)
+  {
+    __m256i eq0 = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)), cr);
+    __m256i eq1 = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + 32)), cr);
+    __m256i any = _mm256_or_si256(eq0, eq1);
+    if (_mm256_testz_si256(any, any))
+    {
+      continue;
+    }
+    uint64_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(eq0)) | static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(eq1))) << 32;
+    const char *found = avx2CheckCR(p, mask);
+    if (found)
+    {
+      return found;
+    }
+  }
+  return sse2FindCRLF(p, end);
+}
+
+__attribute__((target("avx2"))) const char *avx2Find(const char *begin, const char *end, const char *needle, size_t needleLen)
+{
+  if (needleLen == 1)
+  {
+    return avx2FindByte(begin, end, needle[0]);
+  }
+  const __m256i first = _mm256_set1_epi8(needle[0]);
+  const __m256i last = _mm256_set1_epi8(needle[needleLen - 1]);
+  const char *p = begin;
+  for (; p + needleLen - 1 + 32 <= end; p += 32)
+  {
+    __m256i vf = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    __m256i vl = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + needleLen - 1));
+    __m256i eq = _mm256_and_si256(_mm256_cmpeq_epi8(vf, first), _mm256_cmpeq_epi8(vl, last));
+    const char *found = firstMatch(p, static_cast<unsigned>(_mm256_movemask_epi8(eq)), needle, needleLen);
+    if (found)
+    {
+      return found;
+    }
+  }
+  return sse2Find(p, end, needle, needleLen);
+}
+
+#endif  // MUDUO_BYTESEARCH_X86
+
+const Impl kScalar = {"scalar", scalarFindByte, scalarFindCRLF, scalarFind};
+#ifdef MUDUO_BYTESEARCH_X86
+const Impl kSse2 = {"sse2", sse2FindByte, sse2FindCRLF, sse2Find};
+const Impl kAvx2 = {"avx2", avx2FindByte, avx2FindCRLF, avx2Find};
+#endif
+
+const Impl *lookup(const char *name)
+{
+#ifdef MUDUO_BYTESEARCH_X86
+  __builtin_cpu_init();
+  if (::strcmp(name, "avx2") == 0)
+  {
+    return __builtin_cpu_supports("avx2") ? &kAvx2 : NULL;
+  }
+  if (::strcmp(name, "sse2") == 0)
+  {
+    return __builtin_cpu_supports("sse2") ? &kSse2 : NULL;
+  }
+#endif
+  return ::strcmp(name, "scalar") == 0 ? &kScalar : NULL;
+}
+
+const Impl *chooseImpl()
+{
+  const char *name = ::getenv("MUDUO_BYTESEARCH");
+  const Impl *impl = name ? lookup(name) : NULL;
+  if (impl == NULL)
+  {
+    impl = lookup("avx2");
+  }
+  if (impl == NULL)
+  {
+    impl = lookup("sse2");
+  }
+  return impl ? impl : &kScalar;
+}
+
+const Impl *&current()
+{
+  // 第一次调用时根据CPU选择实现，之后只是一次load
+  static const Impl *impl = chooseImpl();
+  return impl;
+}
+
+}  // namespace
+
+const char *ByteSearch::findByte(const char *begin, const char *end, char c)
+{
+  return current()->findByte(begin, end, c);
+}
+
+const char *ByteSearch::findCRLF(const char *begin, const char *end)
+{
+  return current()->findCRLF(begin, end);
+}
+
+const char *ByteSearch::find(const char *begin, const char *end, const char *needle, size_t needleLen)
+{
+  if (needleLen == 0)
+  {
+    // 各个实现都不用管空needle，std::search在空范围上会给出end，这里统一成开头就匹配上
+    return begin;
+  }
+  if (end - begin < static_cast<ptrdiff_t>(needleLen))
+  {
+    return NULL;
+  }
+  return current()->find(begin, end, needle, needleLen);
+}
+
+const char *ByteSearch::implementation()
+{
+  return current()->name;
+}
+
+bool ByteSearch::useImplementation(const char *name)
+{
+  const Impl *impl = lookup(name);
+  if (impl)
+  {
+    current() = impl;
+  }
+  return impl != NULL;
+}
@@ -0,0 +1,34 @@
+#ifndef MUDUO_BASE_BYTESEARCH_H
+#define MUDUO_BASE_BYTESEARCH_H
+
+#include <stddef.h>
+
+namespace muduo
+{
+///
+/// Vectorized scanners for delimiters, used by Buffer and the parsers on top of it.
+///
+/// The implementation is picked once at first use by the CPU features,
+/// AVX2 > SSE2 > scalar, and can be forced with env MUDUO_BYTESEARCH=avx2|sse2|scalar.
+/// All functions search [begin, end) and return NULL if not found.
+namespace ByteSearch
+{
+const char *findByte(const char *begin, const char *end, char c);
+
+const char *findCRLF(const char *begin, const char *end);
+
+/// Best for short needles, a few dozen bytes at most.
+/// An empty needle matches at @c begin, even if the range is empty.
+const char *find(const char *begin, const char *end, const char *needle, size_t needleLen);
+
+/// "avx2", "sse2" or "scalar"
+const char *implementation();
+
+/// For tests and benchmarks, not thread safe.
+/// @return false if name is unknown or not supported by this CPU
+bool useImplementation(const char *name);
+
+}  // namespace ByteSearch
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_BYTESEARCH_H
@@ -0,0 +1,132 @@
+#ifndef MUDUO_BASE_CHASELEVDEQUE_H
+#define MUDUO_BASE_CHASELEVDEQUE_H
+
+#include "muduo/base/noncopyable.h"
+
+#include <atomic>
+#include <memory>
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace muduo
+{
+///
+/// Bounded work-stealing deque of pointers, after Chase and Lev,
+/// with the memory orders of Le, Pop, Cohen and Zappa Nardelli (PPoPP 2013).
+///
+/// The owner thread push()es and pop()s at the bottom (LIFO, no atomic RMW
+/// unless it races for the last element), any thread steal()s at the top (FIFO).
+/// A full deque refuses push(), the caller puts the element somewhere else.
+///
+/// @code
+///   top_(thieves)                 bottom_(owner)
+///     |                               |
+///   [old] [ ] [ ] ... [ ] [new] [empty]
+/// @endcode
+template <typename T>
+class ChaseLevDeque : noncopyable
+{
+ public:
+  /// @param capacity rounded up to a power of two
+  explicit ChaseLevDeque(size_t capacity = 1024) : mask_(roundUp(capacity) - 1), buffer_(new std::atomic<T *>[mask_ + 1]), top_(0), bottom_(0) {}
+
+  /// Owner only.
+  /// @return false if full
+  bool push(T *x)
+  {
+    const int64_t b = bottom_.load(std::memory_order_relaxed);
+    const int64_t t = top_.load(std::memory_order_acquire);
+    if (b - t > static_cast<int64_t>(mask_))
+    {
+      return false;
+    }
+    slot(b).store(x, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(b + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  /// Owner only, the newest element.
+  /// @return NULL if empty
+  T *pop()
+  {
+    const int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+    bottom_.store(b, std::memory_order_relaxed);
+    // 先占住bottom再看top，和steal()的先看top再看bottom配对
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top_.load(std::memory_order_relaxed);
+    if (t > b)
+    {
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return NULL;
+    }
+    T *x = slot(b).load(std::memory_order_relaxed);
+    if (t == b)
+    {
+      // 只剩最后一个，和小偷抢
+      if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+      {
+        x = NULL;
+      }
+      bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+    return x;
+  }
+
+  /// Thread safe, the oldest element.
+  /// @return NULL if empty or another thief won the race
+  T *steal()
+  {
+    int64_t t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t b = bottom_.load(std::memory_order_acquire);
+    if (t >= b)
+    {
+      return NULL;
+    }
+    T *x = slot(t).load(std::memory_order_relaxed);
+    if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+      return NULL;
+    }
+    return x;
+  }
+
+  /// Thread safe, approximate while others push or steal.
+  size_t size() const
+  {
+    const int64_t b = bottom_.load(std::memory_order_relaxed);
+    const int64_t t = top_.load(std::memory_order_relaxed);
+    return b > t ? static_cast<size_t>(b - t) : 0;
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+
+ private:
+  static size_t roundUp(size_t n)
+  {
+    size_t capacity = 1;
+    while (capacity < n)
+    {
+      capacity <<= 1;
+    }
+    return capacity;
+  }
+
+  std::atomic<T *> &slot(int64_t i) { return buffer_[static_cast<size_t>(i) & mask_]; }
+
+  const size_t mask_;
+  std::unique_ptr<std::atomic<T *>[]> buffer_;
+  // 小偷和主人各占一个cache line；用填充而不是alignas，C++11的new不保证超过16的对齐
+  char pad0_[64];
+  std::atomic<int64_t> top_;
+  char pad1_[64 - sizeof(std::atomic<int64_t>)];
+  std::atomic<int64_t> bottom_;
+  char pad2_[64 - sizeof(std::atomic<int64_t>)];
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_CHASELEVDEQUE_H
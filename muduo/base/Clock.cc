@@ -0,0 +1,150 @@
+#include "muduo/base/Clock.h"
+#include "muduo/base/FileUtil.h"
+
+#include <atomic>
+
+#include <time.h>
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+using namespace muduo;
+
+namespace
+{
+__thread int64_t t_loopTime = 0;  // 0表示这个线程没有在跑的loop
+
+int64_t microsecondsOf(clockid_t id)
+{
+  struct timespec ts;
+  ::clock_gettime(id, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * Timestamp::kMicroSecondsPerSecond + ts.tv_nsec / 1000;
+}
+
+// 以一对(tsc, 微秒)为基准，按斜率换算。
+// 重新校准时整个换掉，读的时候只要拿到的三个值是同一次校准的就行，用一个指针发布
+struct TscCalibration
+{
+  uint64_t baseTsc;
+  int64_t baseMicroseconds;
+  double microsecondsPerTick;
+  const TscCalibration *previous;  // 别的线程可能还在用，不释放
+};
+
+std::atomic<const TscCalibration *> g_tsc(NULL);
+
+bool invariantTsc()
+{
+#if defined(__x86_64__)
+  string cpuinfo;
+  // /proc/cpuinfo的大小是0，只读开头就有flags
+  FileUtil::readFile("/proc/cpuinfo", 64 * 1024, &cpuinfo);
+  return cpuinfo.find(" constant_tsc") != string::npos && cpuinfo.find(" nonstop_tsc") != string::npos;
+#else
+  return false;
+#endif
+}
+
+uint64_t readTsc()
+{
+#if defined(__x86_64__)
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+TscCalibration *calibrate(const TscCalibration *previous)
+{
+  // 10ms里两边各读一次，两头的clock_gettime夹着rdtsc，误差在几十纳秒
+  const int64_t startUs = microsecondsOf(CLOCK_REALTIME);
+  const uint64_t startTsc = readTsc();
+  struct timespec ts = {0, 10 * 1000 * 1000};
+  ::nanosleep(&ts, NULL);
+  const uint64_t endTsc = readTsc();
+  const int64_t endUs = microsecondsOf(CLOCK_REALTIME);
+  TscCalibration *calibration = new TscCalibration;
+  calibration->baseTsc = endTsc;
+  calibration->baseMicroseconds = endUs;
+  calibration->microsecondsPerTick = static_cast<double>(endUs - startUs) / static_cast<double>(endTsc - startTsc);
+  calibration->previous = previous;
+  return calibration;
+}
+
+bool initTsc()
+{
+  if (!invariantTsc())
+  {
+    return false;
+  }
+  g_tsc.store(calibrate(NULL), std::memory_order_release);
+  return true;
+}
+
+bool checkTsc()
+{
+  static const bool available = initTsc();
+  return available;
+}
+
+}  // namespace
+
+Timestamp Clock::realtime()
+{
+  return Timestamp(microsecondsOf(CLOCK_REALTIME));
+}
+
+Timestamp Clock::realtimeCoarse()
+{
+  return Timestamp(microsecondsOf(CLOCK_REALTIME_COARSE));
+}
+
+int64_t Clock::monotonicMicroseconds()
+{
+  return microsecondsOf(CLOCK_MONOTONIC);
+}
+
+int64_t Clock::monotonicCoarseMicroseconds()
+{
+  return microsecondsOf(CLOCK_MONOTONIC_COARSE);
+}
+
+bool Clock::tscAvailable()
+{
+  return checkTsc();
+}
+
+void Clock::calibrateTsc()
+{
+  if (checkTsc())
+  {
+    const TscCalibration *previous = g_tsc.load(std::memory_order_acquire);
+    TscCalibration *calibration = calibrate(previous);
+    // 并发校准的话，后发布的那个生效，前一个挂在它后面
+    while (!g_tsc.compare_exchange_weak(previous, calibration, std::memory_order_acq_rel))
+    {
+      calibration->previous = previous;
+    }
+  }
+}
+
+Timestamp Clock::tsc()
+{
+  if (!checkTsc())
+  {
+    return realtime();
+  }
+  const TscCalibration *c = g_tsc.load(std::memory_order_acquire);
+  const int64_t ticks = static_cast<int64_t>(readTsc() - c->baseTsc);
+  return Timestamp(c->baseMicroseconds + static_cast<int64_t>(static_cast<double>(ticks) * c->microsecondsPerTick));
+}
+
+Timestamp Clock::loopTime()
+{
+  return t_loopTime != 0 ? Timestamp(t_loopTime) : Timestamp::now();
+}
+
+void Clock::setLoopTime(Timestamp now)
+{
+  t_loopTime = now.microSecondsSinceEpoch();
+}
@@ -0,0 +1,47 @@
+#ifndef MUDUO_BASE_CLOCK_H
+#define MUDUO_BASE_CLOCK_H
+
+#include "muduo/base/Timestamp.h"
+
+namespace muduo
+{
+///
+/// Clock sources cheaper than Timestamp::now(), for hot paths that can live
+/// with less precision. See test_clock_bench for what each one costs.
+///
+namespace Clock
+{
+/// CLOCK_REALTIME, the same clock as Timestamp::now() (gettimeofday costs the same through the vDSO).
+Timestamp realtime();
+
+/// CLOCK_REALTIME_COARSE, the time of the last scheduler tick (1-4ms resolution),
+/// read from the vDSO without touching the TSC.
+Timestamp realtimeCoarse();
+
+/// CLOCK_MONOTONIC and CLOCK_MONOTONIC_COARSE in microseconds since some unspecified point,
+/// for measuring intervals that must not jump with the wall clock.
+int64_t monotonicMicroseconds();
+int64_t monotonicCoarseMicroseconds();
+
+/// Wall clock from the TSC, calibrated against CLOCK_REALTIME on first use (about 10ms).
+/// Only on x86-64 with an invariant TSC (constant_tsc and nonstop_tsc),
+/// otherwise it is Clock::realtime().
+/// It does not follow later adjustments of the system clock,
+/// call calibrateTsc() again every now and then if that matters.
+Timestamp tsc();
+bool tscAvailable();
+/// Thread safe, but tsc() in other threads may see the old or the new calibration.
+void calibrateTsc();
+
+/// The time the current thread's EventLoop last returned from poll,
+/// Timestamp::now() in threads without a running loop.
+/// It can be behind by as long as the loop iteration has been running.
+Timestamp loopTime();
+
+/// Internal use only, called by EventLoop, invalid clears it.
+void setLoopTime(Timestamp now);
+
+}  // namespace Clock
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_CLOCK_H
@@ -91,13 +91,14 @@ void defaultFlush()
 Logger::OutputFunc g_output = defaultOutput;
 Logger::FlushFunc g_flush = defaultFlush;
 TimeZone g_logTimeZone;
+Logger::ClockFunc g_clock = Timestamp::now;
 
 }  // namespace muduo
 
 using namespace muduo;
 
 Logger::Impl::Impl(LogLevel level, int savedErrno, const SourceFile &file, int line)
-    : time_(Timestamp::now()), stream_(), level_(level), line_(line), basename_(file)
+    : time_(g_clock()), stream_(), level_(level), line_(line), basename_(file)
 {
   formatTime();
   CurrentThread::tid();
@@ -194,3 +195,8 @@ void Logger::setTimeZone(const TimeZone &tz)
 {
   g_logTimeZone = tz;
 }
+
+void Logger::setClock(ClockFunc clock)
+{
+  g_clock = clock;
+}
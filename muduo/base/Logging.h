@@ -64,9 +64,14 @@ class Logger
 
   typedef void (*OutputFunc)(const char *msg, int len);
   typedef void (*FlushFunc)();
+  typedef Timestamp (*ClockFunc)();
   static void setOutput(OutputFunc);
   static void setFlush(FlushFunc);
   static void setTimeZone(const TimeZone &tz);
+  /// Where log lines get their time, Timestamp::now by default.
+  /// Clock::loopTime stamps lines logged in a loop thread with the loop's poll return time
+  /// for free, Clock::realtimeCoarse and Clock::tsc are cheaper than now() anywhere.
+  static void setClock(ClockFunc);
 
  private:
   class Impl
@@ -0,0 +1,285 @@
+#ifndef MUDUO_BASE_MPMCQUEUE_H
+#define MUDUO_BASE_MPMCQUEUE_H
+
+#include "muduo/base/noncopyable.h"
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <assert.h>
+#include <linux/futex.h>
+#include <sched.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace muduo
+{
+///
+/// Bounded lock-free multi-producer/multi-consumer FIFO,
+/// after Dmitry Vyukov's bounded MPMC queue.
+///
+/// An array of cells, each with a sequence number telling whose turn it is,
+/// producers and consumers claim positions with one CAS and never share a lock.
+/// The try* calls never block, tryPutN()/tryTakeN() claim a run of cells with one CAS.
+/// put()/take() spin briefly and then sleep on a futex,
+/// the other side only makes the futex syscall when somebody sleeps.
+///
+/// Use it instead of BoundedBlockingQueue for stage queues at millions of messages per second.
+/// take() and takeN() need a default constructible T.
+///
+template <typename T>
+class MpmcQueue : noncopyable
+{
+ public:
+  /// @param capacity rounded up to a power of two, at least 2
+  explicit MpmcQueue(size_t capacity)
+      : mask_(roundUp(capacity) - 1),
+        cells_(new Cell[mask_ + 1]),
+        enqueuePos_(0),
+        dequeuePos_(0),
+        notEmpty_(0),
+        notFull_(0),
+        takers_(0),
+        putters_(0)
+  {
+    for (size_t i = 0; i <= mask_; ++i)
+    {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  ~MpmcQueue()
+  {
+    const size_t end = enqueuePos_.load(std::memory_order_relaxed);
+    for (size_t pos = dequeuePos_.load(std::memory_order_relaxed); pos != end; ++pos)
+    {
+      cell(pos).value()->~T();
+    }
+  }
+
+  /// Thread safe.
+  /// @return false if full
+  bool tryPut(const T &x)
+  {
+    T copy(x);
+    return tryPutN(&copy, 1) == 1;
+  }
+  bool tryPut(T &&x) { return tryPutN(&x, 1) == 1; }
+
+  /// Thread safe, moves the longest prefix of items[0, n) that fits.
+  /// @return how many were put, in order
+  size_t tryPutN(T *items, size_t n)
+  {
+    size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    size_t k = 0;
+    for (;;)
+    {
+      // 从pos起连续几个空格子，一次CAS全占下
+      k = 0;
+      while (k < n && cell(pos + k).sequence.load(std::memory_order_acquire) == pos + k)
+      {
+        ++k;
+      }
+      if (k == 0)
+      {
+        const size_t seq = cell(pos).sequence.load(std::memory_order_acquire);
+        if (static_cast<intptr_t>(seq - pos) < 0)
+        {
+          return 0;  // 满了，格子还是上一圈的
+        }
+        pos = enqueuePos_.load(std::memory_order_relaxed);  // 被别的生产者抢先了
+        continue;
+      }
+      if (enqueuePos_.compare_exchange_weak(pos, pos + k, std::memory_order_relaxed))
+      {
+        break;
+      }
+    }
+    for (size_t i = 0; i < k; ++i)
+    {
+      Cell &c = cell(pos + i);
+      new (&c.storage) T(std::move(items[i]));
+      c.sequence.store(pos + i + 1, std::memory_order_release);
+    }
+    wake(&notEmpty_, takers_, k);
+    return k;
+  }
+
+  /// Thread safe.
+  /// @return false if empty
+  bool tryTake(T *x) { return tryTakeN(x, 1) == 1; }
+
+  /// Thread safe, moves up to n of the oldest elements to out[0, n).
+  /// @return how many were taken
+  size_t tryTakeN(T *out, size_t n)
+  {
+    size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+    size_t k = 0;
+    for (;;)
+    {
+      k = 0;
+      while (k < n && cell(pos + k).sequence.load(std::memory_order_acquire) == pos + k + 1)
+      {
+        ++k;
+      }
+      if (k == 0)
+      {
+        const size_t seq = cell(pos).sequence.load(std::memory_order_acquire);
+        if (static_cast<intptr_t>(seq - (pos + 1)) < 0)
+        {
+          return 0;  // 空的，或者生产者占了位置还没写完
+        }
+        pos = dequeuePos_.load(std::memory_order_relaxed);
+        continue;
+      }
+      if (dequeuePos_.compare_exchange_weak(pos, pos + k, std::memory_order_relaxed))
+      {
+        break;
+      }
+    }
+    for (size_t i = 0; i < k; ++i)
+    {
+      Cell &c = cell(pos + i);
+      T *value = c.value();
+      out[i] = std::move(*value);
+      value->~T();
+      // 留给下一圈的生产者
+      c.sequence.store(pos + i + mask_ + 1, std::memory_order_release);
+    }
+    wake(&notFull_, putters_, k);
+    return k;
+  }
+
+  /// Thread safe, blocks while full.
+  void put(T x)
+  {
+    while (!tryPut(std::move(x)))
+    {
+      wait(&notFull_, &putters_, [this] { return !full(); });
+    }
+  }
+
+  /// Thread safe, blocks while empty.
+  T take()
+  {
+    T x;
+    takeN(&x, 1);
+    return x;
+  }
+
+  /// Thread safe, blocks until there is at least one element, then takes up to n.
+  size_t takeN(T *out, size_t n)
+  {
+    assert(n > 0);
+    size_t k = 0;
+    while ((k = tryTakeN(out, n)) == 0)
+    {
+      wait(&notEmpty_, &takers_, [this] { return !empty(); });
+    }
+    return k;
+  }
+
+  /// Thread safe, approximate while others put or take.
+  size_t size() const
+  {
+    const size_t dequeue = dequeuePos_.load(std::memory_order_relaxed);
+    const size_t enqueue = enqueuePos_.load(std::memory_order_relaxed);
+    return enqueue > dequeue ? enqueue - dequeue : 0;
+  }
+  bool empty() const
+  {
+    const size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+    return cells_[pos & mask_].sequence.load(std::memory_order_acquire) != pos + 1;
+  }
+  bool full() const
+  {
+    const size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    return cells_[pos & mask_].sequence.load(std::memory_order_acquire) != pos;
+  }
+  size_t capacity() const { return mask_ + 1; }
+
+ private:
+  struct Cell
+  {
+    T *value() { return static_cast<T *>(static_cast<void *>(&storage)); }
+
+    std::atomic<size_t> sequence;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+  };
+
+  static size_t roundUp(size_t n)
+  {
+    size_t capacity = 2;
+    while (capacity < n)
+    {
+      capacity <<= 1;
+    }
+    return capacity;
+  }
+
+  Cell &cell(size_t pos) { return cells_[pos & mask_]; }
+
+  static long futex(std::atomic<uint32_t> *word, int op, uint32_t value)
+  {
+    return ::syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), op, value, NULL, NULL, 0);
+  }
+
+  // 另一边有人在睡才进内核，和wait()里的fence配对
+  static void wake(std::atomic<uint32_t> *word, const std::atomic<int> &sleepers, size_t n)
+  {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers.load(std::memory_order_relaxed) > 0)
+    {
+      word->fetch_add(1, std::memory_order_relaxed);
+      futex(word, FUTEX_WAKE_PRIVATE, n > static_cast<size_t>(INT32_MAX) ? INT32_MAX : static_cast<uint32_t>(n));
+    }
+  }
+
+  template <typename Ready>
+  static void wait(std::atomic<uint32_t> *word, std::atomic<int> *sleepers, Ready ready)
+  {
+    // 先让几次CPU，对面马上就放东西进来的话不用睡
+    for (int i = 0; i < kSpins; ++i)
+    {
+      if (ready())
+      {
+        return;
+      }
+      ::sched_yield();
+    }
+    const uint32_t seen = word->load(std::memory_order_relaxed);
+    sleepers->fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // 登记以后再看一次，之后的put/take都会来叫醒；叫醒过word就变了，futex不会睡
+    if (!ready())
+    {
+      futex(word, FUTEX_WAIT_PRIVATE, seen);
+    }
+    sleepers->fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  static const int kSpins = 16;
+
+  const size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  // 生产者、消费者、两个futex各占一个cache line；C++11的new不保证超过16的对齐，用填充
+  char pad0_[64];
+  std::atomic<size_t> enqueuePos_;
+  char pad1_[64 - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> dequeuePos_;
+  char pad2_[64 - sizeof(std::atomic<size_t>)];
+  std::atomic<uint32_t> notEmpty_;  // futex，每次唤醒等着取的加一
+  std::atomic<uint32_t> notFull_;   // futex，每次唤醒等着放的加一
+  std::atomic<int> takers_;         // 在notEmpty_上睡的
+  std::atomic<int> putters_;        // 在notFull_上睡的
+  char pad3_[64];
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_MPMCQUEUE_H
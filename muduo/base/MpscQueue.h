@@ -0,0 +1,166 @@
+#ifndef MUDUO_BASE_MPSCQUEUE_H
+#define MUDUO_BASE_MPSCQUEUE_H
+
+#include "muduo/base/noncopyable.h"
+
+#include <atomic>
+#include <utility>
+
+#include <assert.h>
+#include <stddef.h>
+
+namespace muduo
+{
+/// Link embedded in the elements of an MpscNodeQueue.
+struct MpscNode
+{
+  MpscNode() : mpscNext(NULL) {}
+
+  std::atomic<MpscNode *> mpscNext;
+};
+
+/// Intrusive lock-free multi-producer/single-consumer FIFO,
+/// after Dmitry Vyukov's non-blocking MPSC node-based queue.
+///
+/// push() is wait-free, one atomic exchange no matter how many producers.
+/// pop() must be called by one thread at a time, and may return NULL while a
+/// producer is between its exchange and its link, the producer is expected to
+/// notify the consumer after push(), like EventLoop::queueInLoop does.
+///
+/// @code
+///   tail_(consumer)                               head_(producers)
+///      |                                              |
+///   [node] -> [node] -> [node] -> ... -> [node] -> [node] -> NULL
+/// @endcode
+class MpscNodeQueue : noncopyable
+{
+ public:
+  MpscNodeQueue() : head_(&stub_), tail_(&stub_) {}
+
+  /// Thread safe.
+  void push(MpscNode *node)
+  {
+    node->mpscNext.store(NULL, std::memory_order_relaxed);
+    // 先抢到位置，再把前一个节点接上，两步之间消费者看到的链表是断开的
+    MpscNode *prev = head_.exchange(node, std::memory_order_acq_rel);
+    prev->mpscNext.store(node, std::memory_order_release);
+  }
+
+  /// Consumer only.
+  /// @return the oldest node, NULL if empty or the oldest push is not linked yet
+  MpscNode *pop()
+  {
+    MpscNode *tail = tail_;
+    MpscNode *next = tail->mpscNext.load(std::memory_order_acquire);
+    if (tail == &stub_)
+    {
+      // 跳过哑节点
+      if (next == NULL)
+      {
+        return NULL;
+      }
+      tail_ = next;
+      tail = next;
+      next = next->mpscNext.load(std::memory_order_acquire);
+    }
+    if (next != NULL)
+    {
+      tail_ = next;
+      return tail;
+    }
+    if (tail != head_.load(std::memory_order_acquire))
+    {
+      // 有生产者正在push，还没接上
+      return NULL;
+    }
+    // tail是最后一个节点，放回哑节点才能把它取走
+    push(&stub_);
+    next = tail->mpscNext.load(std::memory_order_acquire);
+    if (next != NULL)
+    {
+      tail_ = next;
+      return tail;
+    }
+    return NULL;
+  }
+
+  /// Consumer only, may miss a push in progress.
+  bool empty() const
+  {
+    return tail_ == &stub_ && stub_.mpscNext.load(std::memory_order_acquire) == NULL;
+  }
+
+ private:
+  // 生产者和消费者各占一个cache line
+  alignas(64) std::atomic<MpscNode *> head_;
+  alignas(64) MpscNode *tail_;
+  MpscNode stub_;
+};
+
+/// Typed MPSC queue, each push allocates one node holding the value.
+template <typename T>
+class MpscQueue : noncopyable
+{
+ public:
+  MpscQueue() : pushed_(0), popped_(0) {}
+
+  ~MpscQueue()
+  {
+    T x;
+    while (pop(&x))
+    {
+    }
+  }
+
+  /// Thread safe.
+  void push(const T &x) { push(T(x)); }
+
+  /// Thread safe.
+  void push(T &&x)
+  {
+    pushed_.fetch_add(1, std::memory_order_relaxed);
+    queue_.push(new Node(std::move(x)));
+  }
+
+  /// Consumer only, moves the oldest element to *x.
+  /// @return false if nothing is ready
+  bool pop(T *x)
+  {
+    Node *node = static_cast<Node *>(queue_.pop());
+    if (node == NULL)
+    {
+      return false;
+    }
+    *x = std::move(node->value);
+    delete node;
+    popped_.store(popped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  /// Consumer only.
+  bool empty() const { return queue_.empty(); }
+
+  /// Thread safe, approximate while producers are pushing.
+  size_t size() const
+  {
+    const size_t popped = popped_.load(std::memory_order_relaxed);
+    const size_t pushed = pushed_.load(std::memory_order_relaxed);
+    return pushed > popped ? pushed - popped : 0;
+  }
+
+ private:
+  struct Node : MpscNode
+  {
+    explicit Node(T &&x) : value(std::move(x)) {}
+
+    T value;
+  };
+
+  MpscNodeQueue queue_;
+  alignas(64) std::atomic<size_t> pushed_;
+  alignas(64) std::atomic<size_t> popped_;
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_MPSCQUEUE_H
@@ -1,11 +1,22 @@
 #include "muduo/base/ThreadPool.h"
+#include "muduo/base/Clock.h"
 #include "muduo/base/Exception.h"
 
+#include <algorithm>
+
 #include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
 
 using namespace muduo;
 
-ThreadPool::ThreadPool(const string &nameArg) : mutex_(), notEmpty_(mutex_), notFull_(mutex_), name_(nameArg), maxQueueSize_(0), running_(false) {}
+ThreadPool::ThreadPool(const string &nameArg)
+    : mutex_(), notEmpty_(mutex_), notFull_(mutex_), name_(nameArg), queued_(0), maxQueueSize_(0), taskBatch_(1), running_(false)
+{
+  memset(stats_, 0, sizeof stats_);
+  memset(maxQueueWait_, 0, sizeof maxQueueWait_);
+}
 
 ThreadPool::~ThreadPool()
 {
@@ -47,13 +58,46 @@ void ThreadPool::stop()
   }
 }
 
+void ThreadPool::setMaxQueueWait(Priority priority, double seconds)
+{
+  maxQueueWait_[priority] = static_cast<int64_t>(seconds * 1000 * 1000);
+}
+
 size_t ThreadPool::queueSize() const
 {
   MutexGuard lock(mutex_);
-  return queue_.size();
+  return queued_;
+}
+
+ThreadPool::Stats ThreadPool::stats(Priority priority) const
+{
+  MutexGuard lock(mutex_);
+  Stats s = stats_[priority];
+  s.queued = static_cast<int64_t>(queues_[priority].size());
+  return s;
+}
+
+string ThreadPool::statsString() const
+{
+  static const char *const kNames[kNumPriorities] = {"high", "normal", "low"};
+  string result;
+  for (int p = 0; p < kNumPriorities; ++p)
+  {
+    Stats s = stats(static_cast<Priority>(p));
+    int64_t avgWait = s.started > 0 ? s.waitMicros / s.started : 0;
+    char buf[256];
+    snprintf(buf, sizeof buf,
+             "pool=%s priority=%s submitted=%" PRId64 " started=%" PRId64 " expired=%" PRId64 " queued=%" PRId64 " avg_wait_us=%" PRId64
+             " max_wait_us=%" PRId64 "\n",
+             name_.c_str(), kNames[p], s.submitted, s.started, s.expired, s.queued, avgWait, s.maxWaitMicros);
+    result += buf;
+  }
+  return result;
 }
 
-void ThreadPool::run(Task task)
+void ThreadPool::run(Task task) { run(std::move(task), kNormalPriority); }
+
+void ThreadPool::run(Task task, Priority priority, double timeoutSeconds, Task onExpired)
 {
   if (threads_.empty())
   {
@@ -61,45 +105,136 @@ void ThreadPool::run(Task task)
   }
   else
   {
+    // 超时从调用时算起，包括下面等队列有空位的时间
+    const int64_t submitted = Clock::monotonicMicroseconds();
     MutexGuard lock(mutex_);
+    bool waited = false;
     while (isFull() && running_)
     {
       notFull_.wait();
+      waited = true;
     }
     if (!running_)
     {
       return;
     }
     assert(!isFull());
-    queue_.push_back(std::move(task));
+    Entry entry;
+    entry.task = std::move(task);
+    entry.onExpired = std::move(onExpired);
+    entry.enqueued = waited ? Clock::monotonicMicroseconds() : submitted;
+    entry.deadline = timeoutSeconds > 0 ? submitted + static_cast<int64_t>(timeoutSeconds * 1000 * 1000) : 0;
+    entry.priority = priority;
+    queues_[priority].push_back(std::move(entry));
+    ++queued_;
+    ++stats_[priority].submitted;
     notEmpty_.notify();
   }
 }
 
-ThreadPool::Task ThreadPool::take()
+// 按优先级从高到低取最老的一个，过期与否等到要跑的时候再看
+// @return 是否取到了
+bool ThreadPool::popLocked(Entry *entry)
+{
+  mutex_.assertLocked();
+  for (int p = 0; p < kNumPriorities; ++p)
+  {
+    std::deque<Entry> &queue = queues_[p];
+    if (!queue.empty())
+    {
+      *entry = std::move(queue.front());
+      queue.pop_front();
+      --queued_;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::mergeStatsLocked(Stats *done)
+{
+  mutex_.assertLocked();
+  for (int p = 0; p < kNumPriorities; ++p)
+  {
+    Stats &stats = stats_[p];
+    stats.started += done[p].started;
+    stats.expired += done[p].expired;
+    stats.waitMicros += done[p].waitMicros;
+    stats.maxWaitMicros = std::max(stats.maxWaitMicros, done[p].maxWaitMicros);
+  }
+  memset(done, 0, sizeof(Stats) * kNumPriorities);
+}
+
+bool ThreadPool::take(Entry *entry, Stats *done)
+{
+  MutexGuard lock(mutex_);
+  // 反正要加锁，顺便把上一个任务的统计并进去，睡之前stats()就是准的
+  mergeStatsLocked(done);
+  while (queued_ == 0 && running_)
+  {
+    notEmpty_.wait();
+  }
+  const bool taken = popLocked(entry);
+  if (taken && maxQueueSize_ > 0)
+  {
+    notFull_.notify();
+  }
+  return taken;
+}
+
+void ThreadPool::takeBatch(std::vector<Entry> *batch, Stats *done)
 {
   MutexGuard lock(mutex_);
-  while (queue_.empty() && running_)
+  mergeStatsLocked(done);
+  while (queued_ == 0 && running_)
   {
     notEmpty_.wait();
   }
-  Task task;
-  if (!queue_.empty())
+  // 最多拿自己那一份，别让一个worker把活都揽了
+  const size_t share = (queued_ + threads_.size() - 1) / threads_.size();
+  const size_t n = std::min(taskBatch_, share);
+  batch->resize(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    popLocked(&(*batch)[i]);
+  }
+  if (n > 0 && maxQueueSize_ > 0)
+  {
+    notFull_.notifyAll();  // 腾出了n个位置
+  }
+}
+
+// 就在要跑之前看期限，排在同一批后面的任务过了期限也不会再跑；
+// 统计先记在done里，下次取任务时并进stats_
+void ThreadPool::runEntry(Entry *entry, Stats *done)
+{
+  const int64_t now = Clock::monotonicMicroseconds();
+  const int64_t wait = now - entry->enqueued;
+  Stats &stats = done[entry->priority];
+  if ((entry->deadline > 0 && now > entry->deadline) || (maxQueueWait_[entry->priority] > 0 && wait > maxQueueWait_[entry->priority]))
+  {
+    ++stats.expired;
+    if (entry->onExpired)
+    {
+      entry->onExpired();
+    }
+  }
+  else
   {
-    task = queue_.front();
-    queue_.pop_front();
-    if (maxQueueSize_ > 0)
+    ++stats.started;
+    stats.waitMicros += wait;
+    stats.maxWaitMicros = std::max(stats.maxWaitMicros, wait);
+    if (entry->task)
     {
-      notFull_.notify();
+      entry->task();
     }
   }
-  return task;
 }
 
 bool ThreadPool::isFull() const
 {
   mutex_.assertLocked();
-  return maxQueueSize_ > 0 && queue_.size() >= maxQueueSize_;
+  return maxQueueSize_ > 0 && queued_ >= maxQueueSize_;
 }
 
 void ThreadPool::runInThread()
@@ -110,14 +245,36 @@ void ThreadPool::runInThread()
     {
       threadInitCallback_();
     }
-    while (running_)
+    Stats done[kNumPriorities];  // 这个worker跑过的，取任务的时候并进stats_
+    memset(done, 0, sizeof done);
+    if (taskBatch_ > 1)
     {
-      Task task(take());
-      if (task)
+      std::vector<Entry> batch;
+      batch.reserve(taskBatch_);
+      while (running_)
       {
-        task();
+        takeBatch(&batch, done);
+        // stop()以后这一批剩下的也不跑了，和一次取一个时一样
+        for (size_t i = 0; i < batch.size() && running_; ++i)
+        {
+          runEntry(&batch[i], done);
+        }
+        batch.clear();
       }
     }
+    else
+    {
+      while (running_)
+      {
+        Entry entry;
+        if (take(&entry, done))
+        {
+          runEntry(&entry, done);
+        }
+      }
+    }
+    MutexGuard lock(mutex_);
+    mergeStatsLocked(done);
   }
   catch (const Exception &ex)
   {
@@ -11,15 +11,54 @@
 
 namespace muduo
 {
+///
+/// Fixed number of threads running tasks from one queue.
+///
+/// Tasks are queued in priority classes, a worker always takes the oldest task
+/// of the highest non-empty class, so a flood of kLowPriority work does not
+/// delay kHighPriority tasks (but kLowPriority may starve while higher classes keep coming).
+/// A task may carry a timeout; if it has not started when the timeout passes,
+/// or it waited longer than the maxQueueWait of its class, it is not run,
+/// its onExpired callback runs in the worker instead.
+/// Both are checked right before the task would run, also for tasks taken in a batch.
+///
 class ThreadPool : public noncopyable
 {
  public:
   typedef std::function<void()> Task;
 
+  enum Priority
+  {
+    kHighPriority,
+    kNormalPriority,
+    kLowPriority,
+  };
+  static const int kNumPriorities = 3;
+
+  /// Counters of one priority class since start().
+  /// A worker adds the tasks it ran when it takes the next ones, or at stop().
+  struct Stats
+  {
+    int64_t submitted;      // queued by run()
+    int64_t started;        // run by a worker
+    int64_t expired;        // reached its turn after the deadline, onExpired run instead
+    int64_t waitMicros;     // total queueing time of the started ones, time spent behind others in a batch included
+    int64_t maxWaitMicros;  // longest queueing time of a started one
+    int64_t queued;         // waiting now
+  };
+
   explicit ThreadPool(const string &nameArg = string("ThreadPool"));
   ~ThreadPool();
 
   void setMaxQueueSize(int maxSize) { maxQueueSize_ = maxSize; }
+  /// Each worker takes up to @c batch tasks per lock acquisition and wakeup,
+  /// no more than its share of the queue so the other workers are not starved.
+  /// Call before start(). The default 1 takes one task at a time.
+  void setTaskBatch(int batch) { taskBatch_ = batch; }
+  /// Tasks of @c priority queued longer than @c seconds are dropped like expired ones,
+  /// so under overload the pool sheds stale work instead of falling further behind.
+  /// Call before start(). The default 0 never drops.
+  void setMaxQueueWait(Priority priority, double seconds);
   void setThreadInitCallback(const Task &cb) { threadInitCallback_ = cb; }
 
   void start(int numThreads);
@@ -37,10 +76,33 @@ class ThreadPool : public noncopyable
   // https://stackoverflow.com/a/25408989
   void run(Task f);
 
+  /// Like run(f), in class @c priority.
+  /// With @c timeoutSeconds > 0, @c f is not run if it has not started within
+  /// @c timeoutSeconds from now, @c onExpired (if any) runs in the worker instead.
+  /// Tasks dropped by stop() run neither.
+  void run(Task f, Priority priority, double timeoutSeconds = 0.0, Task onExpired = Task());
+
+  Stats stats(Priority priority) const;
+  /// One line per priority class.
+  string statsString() const;
+
  private:
+  struct Entry
+  {
+    Task task;
+    Task onExpired;
+    int64_t enqueued;  // Clock::monotonicMicroseconds()
+    int64_t deadline;  // 0 for none
+    Priority priority;
+  };
+
   bool isFull() const;
   void runInThread();
-  Task take();
+  bool popLocked(Entry *entry);
+  void mergeStatsLocked(Stats *done);
+  bool take(Entry *entry, Stats *done);
+  void takeBatch(std::vector<Entry> *batch, Stats *done);
+  void runEntry(Entry *entry, Stats *done);
 
   mutable Mutex mutex_;
   Condition notEmpty_;
@@ -48,8 +110,12 @@ class ThreadPool : public noncopyable
   string name_;
   Task threadInitCallback_;
   std::vector<std::unique_ptr<muduo::Thread>> threads_;
-  std::deque<Task> queue_;
+  std::deque<Entry> queues_[kNumPriorities];
+  size_t queued_;  // 所有优先级加起来
+  Stats stats_[kNumPriorities];
+  int64_t maxQueueWait_[kNumPriorities];  // 微秒，0不限
   size_t maxQueueSize_;
+  size_t taskBatch_;
   bool running_;
 };
 }  // namespace muduo
@@ -0,0 +1,307 @@
+#include "muduo/base/WorkStealingThreadPool.h"
+#include "muduo/base/Exception.h"
+
+#include <algorithm>
+
+#include <assert.h>
+#include <sched.h>
+#include <stdio.h>
+
+using namespace muduo;
+
+namespace
+{
+const size_t kDequeCapacity = 1024;
+// 从注入队列一次最多搬到自己deque里的个数，剩下的留给别的worker
+const size_t kInjectBatch = 32;
+// 睡之前让出CPU再找几次，短任务一个接一个来的时候不用每个都走一遍futex
+const int kSpinsBeforePark = 16;
+
+__thread void *t_worker = NULL;  // 当前线程所在的Worker，不是worker线程为NULL
+}  // namespace
+
+struct WorkStealingThreadPool::Worker
+{
+  explicit Worker(WorkStealingThreadPool *p) : pool(p), deque(kDequeCapacity), victim(0) {}
+
+  WorkStealingThreadPool *pool;
+  ChaseLevDeque<Task> deque;
+  size_t victim;  // 上次偷成功的worker，下次从它开始
+};
+
+WorkStealingThreadPool::WorkStealingThreadPool(const string &nameArg)
+    : name_(nameArg),
+      maxQueueSize_(0),
+      running_(false),
+      injectedSize_(0),
+      wakeup_(parkMutex_),
+      notFull_(parkMutex_),
+      epoch_(0),
+      parked_(0),
+      queued_(0),
+      steals_(0),
+      parks_(0)
+{
+}
+
+WorkStealingThreadPool::~WorkStealingThreadPool()
+{
+  if (running_)
+  {
+    stop();
+  }
+}
+
+void WorkStealingThreadPool::start(int numThreads)
+{
+  assert(threads_.empty());
+  running_ = true;
+  // 所有worker先建好，线程跑起来以后workers_不再变，偷的时候不用加锁
+  workers_.reserve(numThreads);
+  for (int i = 0; i < numThreads; i++)
+  {
+    workers_.emplace_back(new Worker(this));
+  }
+  threads_.reserve(numThreads);
+  for (int i = 0; i < numThreads; i++)
+  {
+    char id[32];
+    snprintf(id, sizeof(id), "%d", i + 1);
+    threads_.emplace_back(new muduo::Thread(std::bind(&WorkStealingThreadPool::runInThread, this, static_cast<size_t>(i)), name_ + id));
+    threads_[i]->start();
+  }
+  if (numThreads == 0 && threadInitCallback_)  // 如果是单线程
+  {
+    threadInitCallback_();
+  }
+}
+
+void WorkStealingThreadPool::stop()
+{
+  {
+    MutexGuard lock(parkMutex_);
+    running_ = false;
+    wakeup_.notifyAll();
+    notFull_.notifyAll();
+  }
+  for (auto &thr : threads_)
+  {
+    thr->join();
+  }
+  // 和ThreadPool一样，没开始的任务丢掉；worker都退出了，可以在这里pop它们的deque
+  for (auto &worker : workers_)
+  {
+    while (Task *task = worker->deque.pop())
+    {
+      delete task;
+    }
+  }
+  MutexGuard lock(injectMutex_);
+  for (Task *task : injected_)
+  {
+    delete task;
+  }
+  injected_.clear();
+  injectedSize_.store(0, std::memory_order_relaxed);
+  queued_.store(0, std::memory_order_relaxed);
+}
+
+void WorkStealingThreadPool::run(Task task)
+{
+  if (threads_.empty())
+  {
+    task();  // 单线程直接运行
+    return;
+  }
+  if (maxQueueSize_ > 0)
+  {
+    MutexGuard lock(parkMutex_);
+    while (queued_.load(std::memory_order_relaxed) >= maxQueueSize_ && running_)
+    {
+      notFull_.wait();
+    }
+    if (!running_)
+    {
+      return;
+    }
+    queued_.fetch_add(1, std::memory_order_relaxed);
+  }
+  else
+  {
+    if (!running_)
+    {
+      return;
+    }
+    queued_.fetch_add(1, std::memory_order_relaxed);
+  }
+  Task *t = new Task(std::move(task));
+  Worker *self = static_cast<Worker *>(t_worker);
+  if (self == NULL || self->pool != this || !self->deque.push(t))
+  {
+    MutexGuard lock(injectMutex_);
+    injected_.push_back(t);
+    injectedSize_.store(injected_.size(), std::memory_order_relaxed);
+  }
+  // 和park()里的fence配对：要么这里看到有人睡了，要么睡之前的检查看到这个任务
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (parked_.load(std::memory_order_relaxed) > 0)
+  {
+    wakeOne();
+  }
+}
+
+WorkStealingThreadPool::Task *WorkStealingThreadPool::take(Worker *self)
+{
+  Task *task = self->deque.pop();
+  if (task == NULL)
+  {
+    task = takeInjected(self);
+  }
+  if (task == NULL)
+  {
+    task = steal(self);
+  }
+  return task;
+}
+
+WorkStealingThreadPool::Task *WorkStealingThreadPool::takeInjected(Worker *self)
+{
+  if (injectedSize_.load(std::memory_order_relaxed) == 0)
+  {
+    return NULL;
+  }
+  MutexGuard lock(injectMutex_);
+  if (injected_.empty())
+  {
+    return NULL;
+  }
+  Task *task = injected_.front();
+  injected_.pop_front();
+  // 多拿一些放到自己的deque里，少抢几次锁；按worker数均分，其他人也有得偷
+  size_t batch = std::min(kInjectBatch, injected_.size() / workers_.size());
+  while (batch > 0 && self->deque.push(injected_.front()))
+  {
+    injected_.pop_front();
+    --batch;
+  }
+  injectedSize_.store(injected_.size(), std::memory_order_relaxed);
+  return task;
+}
+
+WorkStealingThreadPool::Task *WorkStealingThreadPool::steal(Worker *self)
+{
+  const size_t n = workers_.size();
+  for (size_t i = 0; i < n; ++i)
+  {
+    const size_t victim = (self->victim + i) % n;
+    Worker *other = workers_[victim].get();
+    if (other == self)
+    {
+      continue;
+    }
+    Task *task = other->deque.steal();
+    if (task != NULL)
+    {
+      self->victim = victim;
+      steals_.fetch_add(1, std::memory_order_relaxed);
+      return task;
+    }
+  }
+  return NULL;
+}
+
+void WorkStealingThreadPool::park(Worker *self)
+{
+  int64_t seen = 0;
+  {
+    MutexGuard lock(parkMutex_);
+    seen = epoch_;
+  }
+  parked_.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  // 登记以后再看一遍，这之后提交的会来叫醒
+  bool empty = injectedSize_.load(std::memory_order_relaxed) == 0;
+  for (size_t i = 0; empty && i < workers_.size(); ++i)
+  {
+    empty = workers_[i]->deque.size() == 0;
+  }
+  if (empty)
+  {
+    parks_.fetch_add(1, std::memory_order_relaxed);
+    MutexGuard lock(parkMutex_);
+    while (epoch_ == seen && running_)
+    {
+      wakeup_.wait();
+    }
+  }
+  parked_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void WorkStealingThreadPool::wakeOne()
+{
+  MutexGuard lock(parkMutex_);
+  ++epoch_;
+  wakeup_.notify();
+}
+
+void WorkStealingThreadPool::taken()
+{
+  queued_.fetch_sub(1, std::memory_order_relaxed);
+  if (maxQueueSize_ > 0)
+  {
+    MutexGuard lock(parkMutex_);
+    notFull_.notify();
+  }
+}
+
+void WorkStealingThreadPool::runInThread(size_t index)
+{
+  Worker *self = workers_[index].get();
+  t_worker = self;
+  try
+  {
+    if (threadInitCallback_)
+    {
+      threadInitCallback_();
+    }
+    int idle = 0;
+    while (running_)
+    {
+      std::unique_ptr<Task> task(take(self));
+      if (task)
+      {
+        idle = 0;
+        taken();
+        (*task)();
+      }
+      else if (++idle < kSpinsBeforePark)
+      {
+        ::sched_yield();
+      }
+      else
+      {
+        idle = 0;
+        park(self);
+      }
+    }
+  }
+  catch (const Exception &ex)
+  {
+    fprintf(stderr, "exception caught in WorkStealingThreadPool %s\n", name_.c_str());
+    fprintf(stderr, "reason: %s\n", ex.what());
+    fprintf(stderr, "stack trace: %s\n", ex.stackTrace());
+    abort();
+  }
+  catch (const std::exception &ex)
+  {
+    fprintf(stderr, "exception caught in WorkStealingThreadPool %s\n", name_.c_str());
+    fprintf(stderr, "reason: %s\n", ex.what());
+    abort();
+  }
+  catch (...)
+  {
+    fprintf(stderr, "unknown exception caught in WorkStealingThreadPool %s\n", name_.c_str());
+    throw;  // rethrow
+  }
+  t_worker = NULL;
+}
@@ -0,0 +1,90 @@
+#ifndef MUDUO_BASE_WORKSTEALINGTHREADPOOL_H
+#define MUDUO_BASE_WORKSTEALINGTHREADPOOL_H
+
+#include "muduo/base/ChaseLevDeque.h"
+#include "muduo/base/Condition.h"
+#include "muduo/base/Mutex.h"
+#include "muduo/base/Thread.h"
+
+#include <atomic>
+#include <deque>
+#include <memory>  // unique_ptr
+#include <vector>
+
+namespace muduo
+{
+///
+/// Drop-in replacement of ThreadPool for many workers running short tasks.
+///
+/// Each worker has its own ChaseLevDeque, run() from a worker pushes there
+/// without a lock, run() from other threads goes to one shared injection queue
+/// that workers take from in batches. A worker with nothing to do steals from
+/// the others before parking, and run() only takes the parking lock
+/// when some worker is parked.
+///
+/// Like ThreadPool, stop() drops the tasks not started yet, and
+/// run() blocks while maxQueueSize tasks are queued if that is set.
+///
+class WorkStealingThreadPool : public noncopyable
+{
+ public:
+  typedef std::function<void()> Task;
+
+  explicit WorkStealingThreadPool(const string &nameArg = string("WorkStealingThreadPool"));
+  ~WorkStealingThreadPool();
+
+  void setMaxQueueSize(int maxSize) { maxQueueSize_ = maxSize; }
+  void setThreadInitCallback(const Task &cb) { threadInitCallback_ = cb; }
+
+  void start(int numThreads);
+  void stop();
+
+  const string &name() const { return name_; }
+
+  size_t queueSize() const { return queued_.load(std::memory_order_relaxed); }
+
+  // Could block if maxQueueSize > 0
+  // Call after stop() will return immediately.
+  void run(Task f);
+
+  /// Tasks taken from another worker's deque, and times a worker parked.
+  int64_t steals() const { return steals_.load(std::memory_order_relaxed); }
+  int64_t parks() const { return parks_.load(std::memory_order_relaxed); }
+
+ private:
+  struct Worker;
+
+  void runInThread(size_t index);
+  Task *take(Worker *self);
+  Task *takeInjected(Worker *self);
+  Task *steal(Worker *self);
+  void park(Worker *self);
+  void wakeOne();
+  void taken();
+
+  string name_;
+  Task threadInitCallback_;
+  std::vector<std::unique_ptr<muduo::Thread>> threads_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  size_t maxQueueSize_;
+  std::atomic<bool> running_;
+
+  // 外面线程提交的任务
+  Mutex injectMutex_;
+  std::deque<Task *> injected_;
+  std::atomic<size_t> injectedSize_;  // 不加锁看一眼是不是空的
+
+  // 没活干的worker在这里睡
+  Mutex parkMutex_;
+  Condition wakeup_;
+  Condition notFull_;
+  int64_t epoch_;  // 每次唤醒加一，睡之前记下，变了就不睡
+  std::atomic<int> parked_;
+  std::atomic<size_t> queued_;
+
+  std::atomic<int64_t> steals_;
+  std::atomic<int64_t> parks_;
+};
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_WORKSTEALINGTHREADPOOL_H
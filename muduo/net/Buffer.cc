@@ -8,8 +8,6 @@
 using namespace muduo;
 using namespace muduo::net;
 
-const char Buffer::kCRLF[] = "\r\n";
-
 const size_t Buffer::kCheapPrepend;
 const size_t Buffer::kInitialSize;
 
@@ -26,7 +24,13 @@ ssize_t Buffer::readFd(int fd, int *savedErrno)
   // when there is enough space in this buffer, don't read into extrabuf.
   // when extrabuf is used, we read 128k-1 bytes at most.
   // 堆上buffer手动分配的内存可能不够用，这里利用栈内存，先读出来
-  const int iovcnt = (writable < sizeof extrabuf) ? 2 : 1;
+  int iovcnt = (writable < sizeof extrabuf) ? 2 : 1;
+  if (writable == 0)
+  {
+    // 没有内存(或者已满)时只读进extrabuf，读到数据再按实际大小分配，空读不占内存
+    vec[0] = vec[1];
+    iovcnt = 1;
+  }
   const ssize_t n = sockets::readv(fd, vec, iovcnt);
   if (n < 0)
   {
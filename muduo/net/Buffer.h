@@ -1,10 +1,12 @@
 #ifndef MUDUO_NET_BUFFER_H
 #define MUDUO_NET_BUFFER_H
 
+#include "muduo/base/ByteSearch.h"
 #include "muduo/base/StringPiece.h"
 #include "muduo/base/Types.h"
 #include "muduo/base/copyable.h"
 
+#include "muduo/net/BufferPool.h"
 #include "muduo/net/Endian.h"
 
 #include <algorithm>
@@ -28,17 +30,36 @@ namespace net
 /// |                   |                  |                  |
 /// 0      <=      readerIndex   <=   writerIndex    <=     size
 /// @endcode
+///
+/// A Buffer constructed with initialSize 0, or after releaseStorage(),
+/// holds no memory at all, the first append allocates it.
 class Buffer : public muduo::copyable
 {
  public:
   static const size_t kCheapPrepend = 8;
   static const size_t kInitialSize = 1024;
 
-  explicit Buffer(size_t initialSize = kInitialSize) : buffer_(kCheapPrepend + initialSize), readerIndex_(kCheapPrepend), writerIndex_(kCheapPrepend)
+  explicit Buffer(size_t initialSize = kInitialSize)
+      : buffer_(initialSize > 0 ? kCheapPrepend + initialSize : 0),
+        readerIndex_(initialSize > 0 ? kCheapPrepend : 0),
+        writerIndex_(readerIndex_)
   {
     assert(readableBytes() == 0);
     assert(writableBytes() == initialSize);
-    assert(prependableBytes() == kCheapPrepend);
+    assert(initialSize == 0 || prependableBytes() == kCheapPrepend);
+  }
+
+  /// Draws storage from pool, a NULL pool means plain operator new.
+  /// With a pool the initial size is rounded up to the block size.
+  explicit Buffer(const BufferPoolPtr &pool, size_t initialSize = kInitialSize)
+      : buffer_(BufferPoolAllocator<char>(pool)), readerIndex_(0), writerIndex_(0)
+  {
+    if (initialSize > 0)
+    {
+      allocateStorage(initialSize);
+    }
+    assert(readableBytes() == 0);
+    assert(writableBytes() >= initialSize);
   }
 
   // implicit copy-ctor, move-ctor, dtor and assignment are fine
@@ -59,36 +80,28 @@ class Buffer : public muduo::copyable
 
   const char *peek() const { return begin() + readerIndex_; }
 
-  const char *findCRLF() const
-  {
-    // FIXME: replace with memmem()?
-    // std::search在区间里面查找区间
-    const char *crlf = std::search(peek(), beginWrite(), kCRLF, kCRLF + 2);
-    return crlf == beginWrite() ? NULL : crlf;
-  }
+  const char *findCRLF() const { return ByteSearch::findCRLF(peek(), beginWrite()); }
 
   const char *findCRLF(const char *start) const
   {
     assert(peek() <= start);
     assert(start <= beginWrite());
-    // FIXME: replace with memmem()?
-    const char *crlf = std::search(start, beginWrite(), kCRLF, kCRLF + 2);
-    return crlf == beginWrite() ? NULL : crlf;
+    return ByteSearch::findCRLF(start, beginWrite());
   }
 
-  const char *findEOL() const
-  {
-    // memchr 找到第一个'\n'的位置
-    const void *eol = memchr(peek(), '\n', readableBytes());
-    return static_cast<const char *>(eol);
-  }
+  const char *findEOL() const { return ByteSearch::findByte(peek(), beginWrite(), '\n'); }
 
   const char *findEOL(const char *start) const
   {
     assert(peek() <= start);
     assert(start <= beginWrite());
-    const void *eol = memchr(start, '\n', beginWrite() - start);
-    return static_cast<const char *>(eol);
+    return ByteSearch::findByte(start, beginWrite(), '\n');
+  }
+
+  /// Finds a short delimiter, eg. "\r\n\r\n".
+  const char *find(const StringPiece &delimiter) const
+  {
+    return ByteSearch::find(peek(), beginWrite(), delimiter.data(), delimiter.size());
   }
 
   // retrieve returns void, to prevent
@@ -124,8 +137,9 @@ class Buffer : public muduo::copyable
 
   void retrieveAll()
   {
-    readerIndex_ = kCheapPrepend;
-    writerIndex_ = kCheapPrepend;
+    // 没有内存的时候下标保持为0
+    readerIndex_ = hasStorage() ? kCheapPrepend : 0;
+    writerIndex_ = readerIndex_;
   }
 
   string retrieveAllAsString() { return retrieveAsString(readableBytes()); }
@@ -305,6 +319,10 @@ class Buffer : public muduo::copyable
 
   void prepend(const void * /*restrict*/ data, size_t len)
   {
+    if (!hasStorage())
+    {
+      allocateStorage(kInitialSize);
+    }
     assert(len <= prependableBytes());
     readerIndex_ -= len;
     const char *d = static_cast<const char *>(data);
@@ -313,13 +331,28 @@ class Buffer : public muduo::copyable
 
   void shrink(size_t reserve)
   {
-    // FIXME: use vector::shrink_to_fit() in C++ 11 if possible.
-    Buffer other;
-    other.ensureWritableBytes(readableBytes() + reserve);
+    if (readableBytes() == 0 && reserve == 0)
+    {
+      releaseStorage();
+      return;
+    }
+    Buffer other(buffer_.get_allocator().pool(), readableBytes() + reserve);
     other.append(toStringPiece());
     swap(other);
   }
 
+  /// Gives all memory back, the Buffer must be empty.
+  /// The next append or readFd allocates again.
+  void releaseStorage()
+  {
+    assert(readableBytes() == 0);
+    std::vector<char, BufferPoolAllocator<char>>(buffer_.get_allocator()).swap(buffer_);
+    readerIndex_ = 0;
+    writerIndex_ = 0;
+  }
+
+  bool hasStorage() const { return !buffer_.empty(); }
+
   size_t internalCapacity() const { return buffer_.capacity(); }
 
   /// Read data directly into buffer.
@@ -329,13 +362,28 @@ class Buffer : public muduo::copyable
   ssize_t readFd(int fd, int *savedErrno);
 
  private:
-  char *begin() { return &*buffer_.begin(); }
+  char *begin() { return buffer_.data(); }
 
-  const char *begin() const { return &*buffer_.begin(); }
+  const char *begin() const { return buffer_.data(); }
+
+  void allocateStorage(size_t len)
+  {
+    assert(!hasStorage());
+    size_t size = kCheapPrepend + len;
+    // get_allocator()返回的是拷贝
+    const bool pooled = static_cast<bool>(buffer_.get_allocator().pool());
+    buffer_.resize(pooled ? BufferPool::roundUp(size) : size);
+    readerIndex_ = kCheapPrepend;
+    writerIndex_ = kCheapPrepend;
+  }
 
   void makeSpace(size_t len)
   {
-    if (writableBytes() + prependableBytes() < len + kCheapPrepend)
+    if (!hasStorage())
+    {
+      allocateStorage(std::max(len, kInitialSize));
+    }
+    else if (writableBytes() + prependableBytes() < len + kCheapPrepend)
     {
       // FIXME: move readable data
       buffer_.resize(writerIndex_ + len);
@@ -353,11 +401,9 @@ class Buffer : public muduo::copyable
   }
 
  private:
-  std::vector<char> buffer_;
+  std::vector<char, BufferPoolAllocator<char>> buffer_;
   size_t readerIndex_;
   size_t writerIndex_;
-
-  static const char kCRLF[];
 };
 
 }  // namespace net
@@ -0,0 +1,194 @@
+#include "muduo/net/BufferPool.h"
+
+#include "muduo/base/CurrentThread.h"
+#include "muduo/base/Mutex.h"
+
+#include <new>  // bad_alloc
+#include <set>
+
+#include <assert.h>
+#include <inttypes.h>  // PRId64
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t BufferPool::kMinBlockSize;
+const int BufferPool::kNumClasses;
+const size_t BufferPool::kMaxBlockSize;
+const size_t BufferPool::kDefaultMaxCachedBytes;
+
+namespace
+{
+// 所有存活的pool，只给Inspector用，创建和销毁都很少见
+Mutex &registryMutex()
+{
+  static Mutex mutex;
+  return mutex;
+}
+
+std::set<BufferPool *> &registry()
+{
+  static std::set<BufferPool *> pools;
+  return pools;
+}
+
+// 只有owner线程会写，不需要read-modify-write原子操作
+inline void bump(std::atomic<int64_t> &counter, int64_t delta)
+{
+  counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+// 和默认的allocator一样，分配失败抛bad_alloc，不把NULL交给vector和ChainBuffer
+char *mallocOrThrow(size_t size)
+{
+  void *p = ::malloc(size);
+  if (p == NULL)
+  {
+    throw std::bad_alloc();
+  }
+  return static_cast<char *>(p);
+}
+
+}  // namespace
+
+BufferPool::BufferPool(size_t maxCachedBytes)
+    : threadId_(CurrentThread::tid()),
+      maxCachedBytes_(maxCachedBytes),
+      hits_(0),
+      misses_(0),
+      releases_(0),
+      frees_(0),
+      foreignReleases_(0),
+      cachedBytes_(0)
+{
+  MutexGuard lock(registryMutex());
+  registry().insert(this);
+}
+
+BufferPool::~BufferPool()
+{
+  {
+    MutexGuard lock(registryMutex());
+    registry().erase(this);
+  }
+  for (int i = 0; i < kNumClasses; ++i)
+  {
+    for (char *block : freeLists_[i])
+    {
+      ::free(block);
+    }
+  }
+}
+
+int BufferPool::sizeClass(size_t size)
+{
+  assert(size <= kMaxBlockSize);
+  int cls = 0;
+  size_t blockSize = kMinBlockSize;
+  while (blockSize < size)
+  {
+    blockSize <<= 1;
+    ++cls;
+  }
+  return cls;
+}
+
+size_t BufferPool::roundUp(size_t size)
+{
+  return size > kMaxBlockSize ? size : kMinBlockSize << sizeClass(size);
+}
+
+bool BufferPool::isInOwnerThread() const
+{
+  return threadId_ == CurrentThread::tid();
+}
+
+char *BufferPool::allocate(size_t size)
+{
+  if (size > kMaxBlockSize)
+  {
+    bump(misses_, 1);
+    return mallocOrThrow(size);
+  }
+  int cls = sizeClass(size);
+  if (isInOwnerThread())
+  {
+    std::vector<char *> &freeList = freeLists_[cls];
+    if (!freeList.empty())
+    {
+      char *block = freeList.back();
+      freeList.pop_back();
+      bump(hits_, 1);
+      bump(cachedBytes_, -static_cast<int64_t>(kMinBlockSize << cls));
+      return block;
+    }
+    bump(misses_, 1);
+  }
+  // 非owner线程不碰free list，直接走malloc
+  return mallocOrThrow(kMinBlockSize << cls);
+}
+
+void BufferPool::deallocate(char *block, size_t size)
+{
+  if (block == NULL)
+  {
+    return;
+  }
+  if (!isInOwnerThread())
+  {
+    // 比如TcpConnection最后在别的线程析构
+    foreignReleases_.fetch_add(1, std::memory_order_relaxed);
+    ::free(block);
+    return;
+  }
+  if (size > kMaxBlockSize)
+  {
+    bump(frees_, 1);
+    ::free(block);
+    return;
+  }
+  int cls = sizeClass(size);
+  size_t blockSize = kMinBlockSize << cls;
+  if (implicit_cast<size_t>(cachedBytes_.load(std::memory_order_relaxed)) + blockSize > maxCachedBytes_)
+  {
+    bump(frees_, 1);
+    ::free(block);
+    return;
+  }
+  freeLists_[cls].push_back(block);
+  bump(releases_, 1);
+  bump(cachedBytes_, static_cast<int64_t>(blockSize));
+}
+
+BufferPool::Stats BufferPool::stats() const
+{
+  Stats s;
+  s.hits = hits_.load(std::memory_order_relaxed);
+  s.misses = misses_.load(std::memory_order_relaxed);
+  s.releases = releases_.load(std::memory_order_relaxed);
+  s.frees = frees_.load(std::memory_order_relaxed);
+  s.foreignReleases = foreignReleases_.load(std::memory_order_relaxed);
+  s.cachedBytes = cachedBytes_.load(std::memory_order_relaxed);
+  return s;
+}
+
+string BufferPool::allStatsString()
+{
+  string result;
+  MutexGuard lock(registryMutex());
+  for (const BufferPool *pool : registry())
+  {
+    Stats s = pool->stats();
+    int64_t total = s.hits + s.misses;
+    double hitRatio = total > 0 ? 100.0 * static_cast<double>(s.hits) / static_cast<double>(total) : 0.0;
+    char buf[256];
+    snprintf(buf, sizeof buf,
+             "tid=%d hits=%" PRId64 " misses=%" PRId64 " hit_ratio=%.2f%% releases=%" PRId64 " frees=%" PRId64 " foreign_releases=%" PRId64
+             " cached_bytes=%" PRId64 "\n",
+             pool->threadId_, s.hits, s.misses, hitRatio, s.releases, s.frees, s.foreignReleases, s.cachedBytes);
+    result += buf;
+  }
+  return result;
+}
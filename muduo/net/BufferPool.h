@@ -0,0 +1,140 @@
+#ifndef MUDUO_NET_BUFFERPOOL_H
+#define MUDUO_NET_BUFFERPOOL_H
+
+#include "muduo/base/Types.h"
+#include "muduo/base/noncopyable.h"
+
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace muduo
+{
+namespace net
+{
+///
+/// Size-classed free lists of memory blocks, owned by one EventLoop.
+///
+/// Only the loop thread takes blocks from and gives them back to the free lists,
+/// so there is no lock. A block allocated or released in another thread
+/// bypasses the free lists and goes to malloc(3) directly.
+class BufferPool : noncopyable
+{
+ public:
+  static const size_t kMinBlockSize = 1024;
+  static const int kNumClasses = 7;  // 1K, 2K, ..., 64K
+  static const size_t kMaxBlockSize = kMinBlockSize << (kNumClasses - 1);
+  static const size_t kDefaultMaxCachedBytes = 4 * 1024 * 1024;
+
+  struct Stats
+  {
+    int64_t hits;             // served from a free list
+    int64_t misses;           // served by malloc
+    int64_t releases;         // given back to a free list
+    int64_t frees;            // given back to malloc, free list full or too big
+    int64_t foreignReleases;  // given back from another thread
+    int64_t cachedBytes;      // bytes sitting in the free lists
+  };
+
+  explicit BufferPool(size_t maxCachedBytes = kDefaultMaxCachedBytes);
+  ~BufferPool();
+
+  /// Size of the block actually handed out for @c size bytes.
+  static size_t roundUp(size_t size);
+
+  /// Throws std::bad_alloc if malloc(3) fails, like the default allocator.
+  char *allocate(size_t size);
+  void deallocate(char *block, size_t size);
+
+  Stats stats() const;
+
+  /// One line per live pool, for the Inspector.
+  static string allStatsString();
+
+ private:
+  static int sizeClass(size_t size);
+
+  bool isInOwnerThread() const;
+
+  const pid_t threadId_;
+  const size_t maxCachedBytes_;
+  std::vector<char *> freeLists_[kNumClasses];
+
+  // written by the owner thread only, except foreignReleases_
+  std::atomic<int64_t> hits_;
+  std::atomic<int64_t> misses_;
+  std::atomic<int64_t> releases_;
+  std::atomic<int64_t> frees_;
+  std::atomic<int64_t> foreignReleases_;
+  std::atomic<int64_t> cachedBytes_;
+};
+
+typedef std::shared_ptr<BufferPool> BufferPoolPtr;
+
+///
+/// Allocator drawing from a BufferPool, falls back to operator new without one.
+///
+template <typename T>
+class BufferPoolAllocator
+{
+ public:
+  typedef T value_type;
+  typedef std::true_type propagate_on_container_copy_assignment;
+  typedef std::true_type propagate_on_container_move_assignment;
+  typedef std::true_type propagate_on_container_swap;
+
+  BufferPoolAllocator() {}
+
+  explicit BufferPoolAllocator(const BufferPoolPtr &pool) : pool_(pool) {}
+
+  template <typename U>
+  BufferPoolAllocator(const BufferPoolAllocator<U> &other) : pool_(other.pool())
+  {
+  }
+
+  T *allocate(size_t n)
+  {
+    if (pool_)
+    {
+      return static_cast<T *>(static_cast<void *>(pool_->allocate(n * sizeof(T))));
+    }
+    return static_cast<T *>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T *p, size_t n)
+  {
+    if (pool_)
+    {
+      pool_->deallocate(static_cast<char *>(static_cast<void *>(p)), n * sizeof(T));
+    }
+    else
+    {
+      ::operator delete(p);
+    }
+  }
+
+  const BufferPoolPtr &pool() const { return pool_; }
+
+ private:
+  BufferPoolPtr pool_;
+};
+
+template <typename T, typename U>
+inline bool operator==(const BufferPoolAllocator<T> &lhs, const BufferPoolAllocator<U> &rhs)
+{
+  return lhs.pool() == rhs.pool();
+}
+
+template <typename T, typename U>
+inline bool operator!=(const BufferPoolAllocator<T> &lhs, const BufferPoolAllocator<U> &rhs)
+{
+  return !(lhs == rhs);
+}
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_BUFFERPOOL_H
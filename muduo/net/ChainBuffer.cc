@@ -0,0 +1,234 @@
+#include "muduo/net/ChainBuffer.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/SocketsOps.h"
+
+#include <algorithm>
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t ChainBuffer::kBlockSize;
+const int ChainBuffer::kMaxIovec;
+const size_t ChainBuffer::kSmallPayload;
+
+ChainBuffer::ChainBuffer(const BufferPoolPtr &pool) : pool_(pool), readableBytes_(0) {}
+
+ChainBuffer::~ChainBuffer() = default;
+
+ChainBuffer::FileRegion::~FileRegion()
+{
+  sockets::close(fd);
+}
+
+void ChainBuffer::append(const char * /*restrict*/ data, size_t len)
+{
+  while (len > 0)
+  {
+    if (blocks_.empty() || blocks_.back().writableBytes() == 0)
+    {
+      if (spare_)
+      {
+        blocks_.push_back(std::move(*spare_));
+        spare_.reset();
+      }
+      else
+      {
+        blocks_.push_back(Block(pool_.get()));
+      }
+    }
+    Block &back = blocks_.back();
+    size_t n = std::min(len, back.writableBytes());
+    ::memcpy(back.storage.get() + back.writeIndex, data, n);
+    back.writeIndex += n;
+    readableBytes_ += n;
+    data += n;
+    len -= n;
+  }
+}
+
+void ChainBuffer::append(const SharedPayload &payload, size_t offset)
+{
+  assert(offset <= payload.size());
+  size_t len = payload.size() - offset;
+  if (len == 0)
+  {
+    return;
+  }
+  if (len < kSmallPayload && !blocks_.empty() && blocks_.back().writableBytes() >= len)
+  {
+    // 很短的payload直接拷贝，比多占一个iovec划算
+    append(payload.data() + offset, len);
+    return;
+  }
+  // 只增加引用计数，不拷贝数据
+  blocks_.push_back(Block(payload, offset));
+  readableBytes_ += len;
+}
+
+bool ChainBuffer::appendFile(int fd, off_t offset, size_t len)
+{
+  if (len == 0)
+  {
+    return true;
+  }
+  // 复制一份fd，调用者可以马上close，不用等到发送完
+  int dupFd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+  if (dupFd < 0)
+  {
+    return false;
+  }
+  blocks_.push_back(Block(dupFd, offset, len));
+  readableBytes_ += len;
+  return true;
+}
+
+void ChainBuffer::retrieve(size_t len)
+{
+  assert(len <= readableBytes_);
+  while (len > 0)
+  {
+    Block &front = blocks_.front();
+    size_t n = std::min(len, front.readableBytes());
+    front.readIndex += n;
+    if (front.file)
+    {
+      front.file->offset += static_cast<off_t>(n);
+    }
+    readableBytes_ -= n;
+    len -= n;
+    if (front.readableBytes() == 0)
+    {
+      popFront();
+    }
+  }
+}
+
+void ChainBuffer::retrieveAll()
+{
+  while (!blocks_.empty())
+  {
+    popFront();
+  }
+  readableBytes_ = 0;
+}
+
+void ChainBuffer::releaseStorage()
+{
+  assert(readableBytes_ == 0);
+  spare_.reset();
+  // deque空了也会留着内部的chunk
+  std::deque<Block>().swap(blocks_);
+}
+
+void ChainBuffer::popFront()
+{
+  assert(!blocks_.empty());
+  if (!spare_ && blocks_.front().storage)
+  {
+    // 腾空的block留一个备用，下次append不用再分配内存
+    spare_.reset(new Block(std::move(blocks_.front())));
+    spare_->readIndex = 0;
+    spare_->writeIndex = 0;
+  }
+  blocks_.pop_front();
+}
+
+int ChainBuffer::peekIovec(struct iovec *iov, int maxIov) const
+{
+  int iovcnt = 0;
+  for (std::deque<Block>::const_iterator it = blocks_.begin(); it != blocks_.end() && iovcnt < maxIov; ++it)
+  {
+    if (it->file)
+    {
+      break;
+    }
+    if (it->readableBytes() > 0)
+    {
+      iov[iovcnt].iov_base = const_cast<char *>(it->base + it->readIndex);
+      iov[iovcnt].iov_len = it->readableBytes();
+      ++iovcnt;
+    }
+  }
+  return iovcnt;
+}
+
+ssize_t ChainBuffer::writeFd(int fd, int *savedErrno)
+{
+  if (!blocks_.empty() && blocks_.front().file)
+  {
+    return sendFileFront(fd, savedErrno);
+  }
+  // 一次writev把多个block的数据写入内核，不需要先拼成一块连续内存
+  struct iovec vec[kMaxIovec];
+  const int iovcnt = peekIovec(vec, kMaxIovec);
+  const ssize_t n = sockets::writev(fd, vec, iovcnt);
+  if (n < 0)
+  {
+    *savedErrno = errno;
+  }
+  else
+  {
+    retrieve(implicit_cast<size_t>(n));
+  }
+  return n;
+}
+
+ssize_t ChainBuffer::writeFdZeroCopy(int fd, size_t threshold, SharedPayload *pinned, int *savedErrno)
+{
+  if (!blocks_.empty())
+  {
+    Block &front = blocks_.front();
+    if (!front.storage && !front.file && front.readableBytes() >= threshold)
+    {
+      // 内核直接引用payload的内存，发送完成之前payload不能释放
+      const ssize_t n = sockets::sendZeroCopy(fd, front.base + front.readIndex, front.readableBytes());
+      if (n > 0)
+      {
+        *pinned = front.payload;
+        retrieve(implicit_cast<size_t>(n));
+        return n;
+      }
+      if (n < 0 && errno != ENOBUFS)
+      {
+        *savedErrno = errno;
+        return n;
+      }
+      // ENOBUFS是超过了optmem_max，这次退回拷贝
+    }
+  }
+  return writeFd(fd, savedErrno);
+}
+
+ssize_t ChainBuffer::sendFileFront(int fd, int *savedErrno)
+{
+  Block &front = blocks_.front();
+  // 数据从page cache直接到socket，不经过用户态
+  off_t offset = front.file->offset;
+  const size_t count = std::min(front.readableBytes(), implicit_cast<size_t>(1) << 30);
+  const ssize_t n = sockets::sendfile(fd, front.file->fd, &offset, count);
+  if (n < 0)
+  {
+    *savedErrno = errno;
+  }
+  else if (n == 0)
+  {
+    // 文件被截断了，这个区间再也发不完
+    LOG_ERROR << "ChainBuffer::sendFileFront file shorter than region, " << front.readableBytes() << " bytes dropped";
+    retrieve(front.readableBytes());
+    *savedErrno = EIO;
+    return -1;
+  }
+  else
+  {
+    retrieve(implicit_cast<size_t>(n));
+  }
+  return n;
+}
@@ -0,0 +1,163 @@
+#ifndef MUDUO_NET_CHAINBUFFER_H
+#define MUDUO_NET_CHAINBUFFER_H
+
+#include "muduo/base/StringPiece.h"
+#include "muduo/base/Types.h"
+#include "muduo/base/noncopyable.h"
+#include "muduo/net/BufferPool.h"
+#include "muduo/net/SharedPayload.h"
+
+#include <deque>
+#include <memory>
+
+#include <sys/types.h>
+
+struct iovec;
+
+namespace muduo
+{
+namespace net
+{
+/// A chained output buffer made of fixed-size blocks.
+///
+/// Appending never moves the bytes already queued, a big message is spread
+/// over as many blocks as it needs instead of one contiguous vector,
+/// and the whole chain is flushed with a single writev(2).
+/// A SharedPayload is linked into the chain by reference, not copied,
+/// and a file region is queued by fd and sent with sendfile(2).
+///
+/// @code
+///      front block              middle blocks              back block
+/// +--------+-----------+    +-----------------+    +-----------+----------+
+/// |  sent  |  readable | -> |    readable     | -> |  readable | writable |
+/// +--------+-----------+    +-----------------+    +-----------+----------+
+/// @endcode
+class ChainBuffer : noncopyable
+{
+ public:
+  static const size_t kBlockSize = 16 * 1024;
+  static const int kMaxIovec = 64;
+  static const size_t kSmallPayload = 256;
+
+  /// Draws blocks from pool, a NULL pool means plain operator new.
+  explicit ChainBuffer(const BufferPoolPtr &pool = BufferPoolPtr());
+  ~ChainBuffer();
+
+  size_t readableBytes() const { return readableBytes_; }
+
+  size_t numBlocks() const { return blocks_.size(); }
+
+  void append(const StringPiece &str) { append(str.data(), str.size()); }
+
+  void append(const char * /*restrict*/ data, size_t len);
+
+  void append(const void * /*restrict*/ data, size_t len) { append(static_cast<const char *>(data), len); }
+
+  /// Links the bytes of payload from @c offset on, holding a reference until they are retrieved.
+  /// Payloads shorter than kSmallPayload are copied into the back block if they fit.
+  void append(const SharedPayload &payload, size_t offset = 0);
+
+  /// Queues @c len bytes of file fd from @c offset, fd is dup(2)ed so the caller may close it.
+  /// The bytes are read by sendfile(2) when they reach the front of the chain.
+  /// @return false if dup(2) failed, @c errno is set
+  bool appendFile(int fd, off_t offset, size_t len);
+
+  void retrieve(size_t len);
+
+  void retrieveAll();
+
+  /// Gives the spare block back, the chain must be drained.
+  void releaseStorage();
+
+  bool hasStorage() const { return spare_ || !blocks_.empty(); }
+
+  /// Fills at most @c maxIov iovecs with the readable bytes, in order,
+  /// stops at the first file region.
+  /// @return number of iovecs filled
+  int peekIovec(struct iovec *iov, int maxIov) const;
+
+  /// Write the readable bytes to fd with writev(2), or sendfile(2) if a file region is in front,
+  /// and retrieve what's written.
+  /// A file shorter than its region fails with EIO and drops the region.
+  /// @return result of writev(2) or sendfile(2), @c errno is saved
+  ssize_t writeFd(int fd, int *savedErrno);
+
+  /// Like writeFd, but a SharedPayload of at least @c threshold bytes in front is sent alone
+  /// with MSG_ZEROCOPY and assigned to *pinned, which must be kept until the kernel reports completion.
+  ssize_t writeFdZeroCopy(int fd, size_t threshold, SharedPayload *pinned, int *savedErrno);
+
+ private:
+  struct BlockDeleter
+  {
+    BlockDeleter() : pool(NULL) {}
+    explicit BlockDeleter(BufferPool *p) : pool(p) {}
+
+    void operator()(char *block) const
+    {
+      if (pool)
+      {
+        pool->deallocate(block, kBlockSize);
+      }
+      else
+      {
+        delete[] block;
+      }
+    }
+
+    BufferPool *pool;
+  };
+
+  struct FileRegion : noncopyable
+  {
+    FileRegion(int f, off_t off) : fd(f), offset(off) {}
+    ~FileRegion();
+
+    int fd;  // dup(2)ed, owned
+    off_t offset;
+  };
+
+  struct Block
+  {
+    explicit Block(BufferPool *pool)
+        : storage(pool ? pool->allocate(kBlockSize) : new char[kBlockSize], BlockDeleter(pool)),
+          base(storage.get()),
+          readIndex(0),
+          writeIndex(0),
+          capacity(kBlockSize)
+    {
+    }
+
+    Block(const SharedPayload &p, size_t offset)
+        : payload(p), base(p.data()), readIndex(offset), writeIndex(p.size()), capacity(p.size())
+    {
+    }
+
+    Block(int fd, off_t offset, size_t len) : file(new FileRegion(fd, offset)), base(NULL), readIndex(0), writeIndex(len), capacity(len) {}
+
+    size_t readableBytes() const { return writeIndex - readIndex; }
+    size_t writableBytes() const { return capacity - writeIndex; }
+
+    std::unique_ptr<char[], BlockDeleter> storage;  // 自己分配的内存，共享payload时为空
+    SharedPayload payload;            // 共享的只读数据，不可写
+    std::unique_ptr<FileRegion> file;  // 文件区间，base为空
+    const char *base;
+    size_t readIndex;
+    size_t writeIndex;
+    size_t capacity;
+  };
+
+  void popFront();
+  ssize_t sendFileFront(int fd, int *savedErrno);
+
+  // must outlive the blocks
+  BufferPoolPtr pool_;
+  std::deque<Block> blocks_;
+  // keep one drained block around, most connections only ever need one
+  std::unique_ptr<Block> spare_;
+  size_t readableBytes_;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_CHAINBUFFER_H
@@ -0,0 +1,72 @@
+#ifndef MUDUO_NET_CHANNELTABLE_H
+#define MUDUO_NET_CHANNELTABLE_H
+
+#include <vector>
+
+#include <assert.h>
+#include <stddef.h>
+
+namespace muduo
+{
+namespace net
+{
+class Channel;
+
+///
+/// The Channels registered in a Poller, indexed by fd.
+///
+/// The kernel hands out the lowest free fd, so fds of one process stay dense
+/// and a flat array indexed by fd is both smaller and faster than a tree:
+/// a lookup is one load instead of a walk of log(n) scattered nodes.
+/// It grows to the highest fd seen and never shrinks.
+///
+class ChannelTable
+{
+ public:
+  ChannelTable() : size_(0) {}
+
+  /// @return NULL if no Channel of fd is registered
+  Channel *find(int fd) const
+  {
+    assert(fd >= 0);
+    return static_cast<size_t>(fd) < table_.size() ? table_[fd] : NULL;
+  }
+
+  void insert(int fd, Channel *channel)
+  {
+    assert(fd >= 0);
+    assert(channel != NULL);
+    if (static_cast<size_t>(fd) >= table_.size())
+    {
+      // 按倍数扩，fd一个个变大的时候不用每次都搬
+      size_t n = table_.size() * 2;
+      table_.resize(n > static_cast<size_t>(fd) ? n : static_cast<size_t>(fd) + 1, NULL);
+    }
+    assert(table_[fd] == NULL);
+    table_[fd] = channel;
+    ++size_;
+  }
+
+  /// @return number of Channels removed, 0 or 1
+  size_t erase(int fd)
+  {
+    if (find(fd) == NULL)
+    {
+      return 0;
+    }
+    table_[fd] = NULL;
+    --size_;
+    return 1;
+  }
+
+  size_t size() const { return size_; }
+
+ private:
+  std::vector<Channel *> table_;
+  size_t size_;  // 不为NULL的项数
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_CHANNELTABLE_H
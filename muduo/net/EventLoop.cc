@@ -1,15 +1,22 @@
 #include "muduo/net/EventLoop.h"
 
+#include "muduo/base/Clock.h"
 #include "muduo/base/Logging.h"
+#include "muduo/base/MpmcQueue.h"
 #include "muduo/base/Mutex.h"
 #include "muduo/net/Channel.h"
 #include "muduo/net/Poller.h"
 #include "muduo/net/SocketsOps.h"
+#include "muduo/net/TimeoutWheel.h"
 #include "muduo/net/TimerQueue.h"
+#include "muduo/net/poller/IoUringPoller.h"
 
 #include <algorithm>
+#include <set>
 
+#include <inttypes.h>
 #include <signal.h>
+#include <stdio.h>
 #include <sys/eventfd.h>
 #include <unistd.h>
 
@@ -22,6 +29,19 @@ __thread EventLoop *t_loopInThisThread = 0;  // 线程局部变量，用于指
 
 const int kPollTimeMs = 10000;  // 超时时间10s
 
+// 所有活着的EventLoop，给Inspector用
+Mutex &registryMutex()
+{
+  static Mutex mutex;
+  return mutex;
+}
+
+std::set<EventLoop *> &registry()
+{
+  static std::set<EventLoop *> loops;
+  return loops;
+}
+
 int createEventfd()
 {
   int evtfd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);  // eventfd为非阻塞，子进程不可继承
@@ -56,8 +76,65 @@ class IgnoreSigPipe
 #pragma GCC diagnostic error "-Wold-style-cast"
 
 IgnoreSigPipe initObj;
+
+class FunctorCall final : public muduo::net::detail::PendingCall
+{
+ public:
+  explicit FunctorCall(EventLoop::Functor &&cb) : cb_(std::move(cb)) {}
+
+  void run() override { cb_(); }
+  void release() override { delete this; }
+
+ private:
+  ~FunctorCall() {}
+
+  EventLoop::Functor cb_;
+};
 }  // namespace
 
+const size_t net::detail::CallNodePool::kNodeSize;
+const size_t net::detail::CallNodePool::kMaxCached;
+
+net::detail::CallNodePool::CallNodePool() : free_(new MpmcQueue<void *>(kMaxCached)), refs_(1) {}
+
+net::detail::CallNodePool::~CallNodePool()
+{
+  void *node = NULL;
+  while (free_->tryTake(&node))
+  {
+    ::operator delete(node);
+  }
+}
+
+void *net::detail::CallNodePool::allocate()
+{
+  void *node = NULL;
+  if (!free_->tryTake(&node))
+  {
+    node = ::operator new(kNodeSize);
+  }
+  refs_.fetch_add(1, std::memory_order_relaxed);
+  return node;
+}
+
+void net::detail::CallNodePool::deallocate(void *node)
+{
+  // 攒满了就还给malloc
+  if (!free_->tryPut(node))
+  {
+    ::operator delete(node);
+  }
+  unref();
+}
+
+void net::detail::CallNodePool::unref()
+{
+  if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+  {
+    delete this;
+  }
+}
+
 EventLoop *EventLoop::getEventLoopOfCurrentThread()
 {
   return t_loopInThisThread;
@@ -71,10 +148,24 @@ EventLoop::EventLoop()
       iteration_(0),
       threadId_(CurrentThread::tid()),
       poller_(Poller::newDefaultPoller(this)),
-      timerQueue_(new TimerQueue(this)),
+      ioUringPoller_(dynamic_cast<IoUringPoller *>(get_pointer(poller_))),
+      timerQueue_(TimerQueue::newDefaultTimerQueue(this)),
       wakeupFd_(createEventfd()),
       wakeupChannel_(new Channel(this, wakeupFd_)),
-      currentActiveChannel_(NULL)
+      currentActiveChannel_(NULL),
+      callsQueued_(0),
+      callsRun_(0),
+      callPool_(new net::detail::CallNodePool),
+      coalescedSends_(0),
+      coalescedFlushes_(0),
+      wakeupPending_(false),
+      wakeupsIssued_(0),
+      wakeupsSuppressed_(0),
+      busyPoll_(0),
+      socketBusyPoll_(0),
+      busyPollSince_(0),
+      spinMicroseconds_(0),
+      cachedClock_(false)
 {
   LOG_DEBUG << "EventLoop created " << this << " in thread " << threadId_;
   if (t_loopInThisThread)
@@ -90,17 +181,29 @@ EventLoop::EventLoop()
   wakeupChannel_->setReadCallback(std::bind(&EventLoop::handleRead, this));
   // we are always reading the wakeupfd
   wakeupChannel_->enableReading();
+  MutexGuard lock(registryMutex());
+  registry().insert(this);
 }
 
 EventLoop::~EventLoop()
 {
   LOG_DEBUG << "EventLoop " << this << " of thread " << threadId_ << " destructs in thread " << CurrentThread::tid();
+  {
+    MutexGuard lock(registryMutex());
+    registry().erase(this);
+  }
   // 这里关闭用于唤醒当前线程的eventfd
   // 为何不关闭channel？
   wakeupChannel_->disableAll();
   wakeupChannel_->remove();
   ::close(wakeupFd_);
   t_loopInThisThread = NULL;
+  // 没来得及执行的调用，submit()的Future会得到异常
+  while (MpscNode *node = pendingCalls_.pop())
+  {
+    static_cast<detail::PendingCall *>(node)->release();
+  }
+  callPool_->unref();
 }
 
 void EventLoop::loop()
@@ -114,7 +217,9 @@ void EventLoop::loop()
   while (!quit_)
   {
     activeChannels_.clear();
-    pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
+    pollReturnTime_ = poll();
+    // 这一轮里Clock::loopTime()不用再读时钟
+    Clock::setLoopTime(pollReturnTime_);
     ++iteration_;
     if (Logger::logLevel() <= Logger::TRACE)
     {
@@ -133,9 +238,52 @@ void EventLoop::loop()
   }
 
   LOG_TRACE << "EventLoop " << this << " stop looping";
+  Clock::setLoopTime(Timestamp::invalid());
   looping_ = false;
 }
 
+Timestamp EventLoop::poll()
+{
+  if (busyPoll_ > 0)
+  {
+    // 先用0超时空转一段时间，有事件马上返回，空转超时了才阻塞
+    const Timestamp start(Timestamp::now());
+    const int64_t deadline = start.microSecondsSinceEpoch() + busyPoll_;
+    Timestamp now = start;
+    while (activeChannels_.empty() && !quit_ && now.microSecondsSinceEpoch() < deadline)
+    {
+      now = poller_->poll(0, &activeChannels_);
+    }
+    spinMicroseconds_.fetch_add(now.microSecondsSinceEpoch() - start.microSecondsSinceEpoch(), std::memory_order_relaxed);
+    if (!activeChannels_.empty() || quit_)
+    {
+      return now;
+    }
+  }
+  return poller_->poll(kPollTimeMs, &activeChannels_);
+}
+
+void EventLoop::setBusyPoll(int spinMicroseconds, int socketBusyPollMicroseconds)
+{
+  assert(!looping_ || isInLoopThread());
+  busyPoll_ = spinMicroseconds;
+  socketBusyPoll_ = socketBusyPollMicroseconds;
+  spinMicroseconds_.store(0, std::memory_order_relaxed);
+  busyPollSince_.store(spinMicroseconds > 0 ? Timestamp::now().microSecondsSinceEpoch() : 0, std::memory_order_relaxed);
+}
+
+double EventLoop::spinRatio() const
+{
+  const int64_t since = busyPollSince_.load(std::memory_order_relaxed);
+  if (since == 0)
+  {
+    return 0.0;
+  }
+  const int64_t elapsed = Timestamp::now().microSecondsSinceEpoch() - since;
+  const int64_t spin = spinMicroseconds_.load(std::memory_order_relaxed);
+  return elapsed > 0 ? std::min(1.0, static_cast<double>(spin) / static_cast<double>(elapsed)) : 0.0;
+}
+
 void EventLoop::quit()
 {
   quit_ = true;
@@ -164,10 +312,13 @@ void EventLoop::runInLoop(Functor cb)
 
 void EventLoop::queueInLoop(Functor cb)
 {
-  {
-    MutexGuard lock(mutex_);
-    pendingFunctors_.push_back(std::move(cb));
-  }
+  queueCall(new FunctorCall(std::move(cb)));
+}
+
+void EventLoop::queueCall(detail::PendingCall *call)
+{
+  callsQueued_.fetch_add(1, std::memory_order_relaxed);
+  pendingCalls_.push(call);
 
   // 调用者不在当前loop归属的线程，需要唤醒loop归属的线程以便快速执行cb
   // loop归属的线程在执行callingPendingFunctors时，后续可能会被挂起
@@ -178,27 +329,50 @@ void EventLoop::queueInLoop(Functor cb)
   }
 }
 
+void EventLoop::queueFlush(Functor cb)
+{
+  assertInLoopThread();
+  flushFunctors_.push_back(std::move(cb));
+}
+
 size_t EventLoop::queueSize() const
 {
-  MutexGuard lock(mutex_);
-  return pendingFunctors_.size();
+  const size_t run = callsRun_.load(std::memory_order_relaxed);
+  const size_t queued = callsQueued_.load(std::memory_order_relaxed);
+  return queued > run ? queued - run : 0;
 }
 
-TimerId EventLoop::runAt(Timestamp time, TimerCallback cb)
+TimerId EventLoop::runAt(Timestamp time, TimerCallback cb, double slack)
 {
-  return timerQueue_->addTimer(std::move(cb), time, 0.0);
+  return timerQueue_->addTimer(std::move(cb), time, 0.0, slack);
 }
 
-TimerId EventLoop::runAfter(double delay, TimerCallback cb)
+Timestamp EventLoop::timerNow() const
 {
-  Timestamp time(addTime(Timestamp::now(), delay));
-  return runAt(time, std::move(cb));
+  // loop()之外pollReturnTime_是旧的
+  return cachedClock_ && looping_ && isInLoopThread() ? pollReturnTime_ : Timestamp::now();
 }
 
-TimerId EventLoop::runEvery(double interval, TimerCallback cb)
+TimerId EventLoop::runAfter(double delay, TimerCallback cb, double slack)
 {
-  Timestamp time(addTime(Timestamp::now(), interval));
-  return timerQueue_->addTimer(std::move(cb), time, interval);
+  Timestamp time(addTime(timerNow(), delay));
+  return runAt(time, std::move(cb), slack);
+}
+
+TimerId EventLoop::runEvery(double interval, TimerCallback cb, double slack)
+{
+  Timestamp time(addTime(timerNow(), interval));
+  return timerQueue_->addTimer(std::move(cb), time, interval, slack);
+}
+
+int64_t EventLoop::timerfdResets() const
+{
+  return timerQueue_->timerfdResets();
+}
+
+int64_t EventLoop::timerfdResetsSaved() const
+{
+  return timerQueue_->timerfdResetsSaved();
 }
 
 void EventLoop::cancel(TimerId timerId)
@@ -206,6 +380,36 @@ void EventLoop::cancel(TimerId timerId)
   return timerQueue_->cancel(timerId);
 }
 
+void EventLoop::enableBufferPool(size_t maxCachedBytes)
+{
+  assertInLoopThread();
+  if (!bufferPool_)
+  {
+    bufferPool_.reset(new BufferPool(maxCachedBytes));
+  }
+}
+
+TimeoutWheel *EventLoop::timeoutWheel(double tickSeconds)
+{
+  assertInLoopThread();
+  // 精度不同的超时各用各的轮子，tick取整到2的幂毫秒，轮子最多十来个
+  int64_t tickMs = 1000;
+  if (tickSeconds < 1.0)
+  {
+    tickMs = 1;
+    while (static_cast<double>(tickMs * 2) <= tickSeconds * 1000)
+    {
+      tickMs *= 2;
+    }
+  }
+  std::unique_ptr<TimeoutWheel> &wheel = timeoutWheels_[tickMs];
+  if (!wheel)
+  {
+    wheel.reset(new TimeoutWheel(this, static_cast<double>(tickMs) / 1000));
+  }
+  return get_pointer(wheel);
+}
+
 void EventLoop::updateChannel(Channel *channel)
 {
   assert(channel->ownerLoop() == this);
@@ -240,6 +444,13 @@ void EventLoop::abortNotInLoopThread()
 
 void EventLoop::wakeup()
 {
+  // 上一次写的还没被loop读走，loop肯定会醒来，不用再写
+  if (wakeupPending_.exchange(true, std::memory_order_acq_rel))
+  {
+    wakeupsSuppressed_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  wakeupsIssued_.fetch_add(1, std::memory_order_relaxed);
   // 往loop的wakeupFd_写入8字节，以便唤醒loop归属的线程
   uint64_t one = 1;
   ssize_t n = sockets::write(wakeupFd_, &one, sizeof one);
@@ -258,25 +469,72 @@ void EventLoop::handleRead()
   {
     LOG_ERROR << "EventLoop::handleRead() reads " << n << " bytes instead of 8";
   }
+  // 必须先读eventfd再清标志，之后才执行doPendingFunctors，
+  // 清标志之后的生产者会重新写eventfd，清标志之前push的在这一轮能取到
+  wakeupPending_.exchange(false, std::memory_order_acq_rel);
 }
 
 void EventLoop::doPendingFunctors()
 {
-  std::vector<Functor> functors;
+  std::vector<detail::PendingCall *> &calls = runningCalls_;
   callingPendingFunctors_ = true;
 
+  // 先把已经入队的取出来再执行，执行过程中新加的留到下一轮，和原来swap的语义一样
+  // 正在push还没接上的那个也留到下一轮，生产者push之后会wakeup
+  while (MpscNode *node = pendingCalls_.pop())
+  {
+    calls.push_back(static_cast<detail::PendingCall *>(node));
+  }
+  callsRun_.store(callsRun_.load(std::memory_order_relaxed) + calls.size(), std::memory_order_relaxed);
+
+  for (detail::PendingCall *call : calls)
   {
-    MutexGuard lock(mutex_);
-    functors.swap(pendingFunctors_);
+    call->run();
+    call->release();
   }
+  calls.clear();
+
+  std::vector<Functor> &functors = runningFunctors_;
 
-  for (const Functor &functor : functors)
+  // 这一轮攒下的写，统一在最后flush，仍在callingPendingFunctors_里，flush中queueInLoop会唤醒
+  while (!flushFunctors_.empty())
   {
-    functor();
+    functors.swap(flushFunctors_);
+    for (const Functor &f : functors)
+    {
+      f();
+    }
+    functors.clear();
   }
   callingPendingFunctors_ = false;
 }
 
+string EventLoop::allStatsString()
+{
+  string result;
+  MutexGuard lock(registryMutex());
+  for (const EventLoop *loop : registry())
+  {
+    const int64_t issued = loop->wakeupsIssued();
+    const int64_t suppressed = loop->wakeupsSuppressed();
+    const int64_t wakeups = issued + suppressed;
+    const int64_t sends = loop->coalescedSends();
+    const int64_t flushes = loop->coalescedFlushes();
+    char buf[320];
+    snprintf(buf, sizeof buf,
+             "tid=%d pending=%zu wakeups_issued=%" PRId64 " wakeups_suppressed=%" PRId64 " suppressed_ratio=%.2f%%"
+             " coalesced_sends=%" PRId64 " coalesced_flushes=%" PRId64 " sends_per_flush=%.2f"
+             " busy_poll=%s spin_ratio=%.2f%% timerfd_settime=%" PRId64 " timerfd_settime_saved=%" PRId64 "\n",
+             loop->threadId_, loop->queueSize(), issued, suppressed,
+             wakeups > 0 ? 100.0 * static_cast<double>(suppressed) / static_cast<double>(wakeups) : 0.0, sends, flushes,
+             flushes > 0 ? static_cast<double>(sends) / static_cast<double>(flushes) : 0.0,
+             loop->busyPollSince_.load(std::memory_order_relaxed) != 0 ? "on" : "off", 100.0 * loop->spinRatio(),
+             loop->timerfdResets(), loop->timerfdResetsSaved());
+    result += buf;
+  }
+  return result;
+}
+
 void EventLoop::printActiveChannels() const
 {
   for (const Channel *channel : activeChannels_)
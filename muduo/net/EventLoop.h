@@ -3,23 +3,77 @@
 
 #include <atomic>
 #include <functional>
+#include <map>
+#include <utility>
 #include <vector>
 
 #include <boost/any.hpp>
 
 #include "muduo/base/CurrentThread.h"
+#include "muduo/base/MpscQueue.h"
 #include "muduo/base/Mutex.h"
 #include "muduo/base/Timestamp.h"
+#include "muduo/net/BufferPool.h"
 #include "muduo/net/Callbacks.h"
 #include "muduo/net/TimerId.h"
 
 namespace muduo
 {
+template <typename T>
+class MpmcQueue;
+
 namespace net
 {
 class Channel;
+class IoUringPoller;
 class Poller;
+class TimeoutWheel;
 class TimerQueue;
+template <typename T>
+class Future;
+
+namespace detail
+{
+/// One queued call, runInLoop() functors and submit() calls share one FIFO.
+class PendingCall : public MpscNode
+{
+ public:
+  /// In the loop thread.
+  virtual void run() = 0;
+  /// After run(), or instead of it when the loop is destroyed first.
+  virtual void release() = 0;
+
+ protected:
+  ~PendingCall() {}
+};
+
+///
+/// Recycled fixed-size nodes for submit() calls with a small callable,
+/// so a call from another thread doesn't go to malloc once the loop is warm.
+/// Nodes are taken and given back in any thread, through a lock-free MpmcQueue,
+/// and hold a reference, so the pool outlives the loop while Futures are still around.
+///
+class CallNodePool : noncopyable
+{
+ public:
+  static const size_t kNodeSize = 256;
+  static const size_t kMaxCached = 256;
+
+  CallNodePool();
+
+  /// kNodeSize bytes, aligned for any type.
+  void *allocate();
+  void deallocate(void *node);
+  /// The loop's reference.
+  void unref();
+
+ private:
+  ~CallNodePool();
+
+  std::unique_ptr<MpmcQueue<void *>> free_;
+  std::atomic<int> refs_;  // loop一个，每个借出去的节点一个
+};
+}  // namespace detail
 
 ///
 /// Reactor, at most one per thread.
@@ -65,30 +119,106 @@ class EventLoop : noncopyable
 
   size_t queueSize() const;
 
+  /// Runs f() in the loop thread and returns a Future of its result,
+  /// for reading state owned by this loop from other threads without a latch.
+  /// f is stored with the result in one node, taken from a per-loop pool
+  /// when it fits CallNodePool::kNodeSize (a lambda capturing a few pointers), from malloc otherwise.
+  /// In the loop thread it runs right away and the returned Future holds the result without allocating.
+  /// Safe to call from other threads, defined in muduo/net/Future.h.
+  template <typename F>
+  Future<decltype(std::declval<F &>()())> submit(F f);
+
+  /// Runs callback at the end of this iteration, after the pending functors.
+  /// Used to flush the writes gathered during one iteration.
+  /// Must be called in the loop thread.
+  void queueFlush(Functor cb);
+
+  /// Write coalescing counters of this loop, see TcpConnection::setWriteCoalescing.
+  /// Sends gathered, and writev(2) calls that flushed them.
+  int64_t coalescedSends() const { return coalescedSends_.load(std::memory_order_relaxed); }
+  int64_t coalescedFlushes() const { return coalescedFlushes_.load(std::memory_order_relaxed); }
+
+  /// Wakeup counters of this loop, eventfd writes issued,
+  /// and wakeups dropped because one was already pending.
+  int64_t wakeupsIssued() const { return wakeupsIssued_.load(std::memory_order_relaxed); }
+  int64_t wakeupsSuppressed() const { return wakeupsSuppressed_.load(std::memory_order_relaxed); }
+
+  /// Busy polling, for latency critical loops.
+  /// After the last event the loop keeps polling with a zero timeout for up to
+  /// @c spinMicroseconds before it blocks, burning the CPU to skip the sleep/wake path.
+  /// With @c socketBusyPollMicroseconds > 0, connections established afterwards set SO_BUSY_POLL.
+  /// 0 turns either off. Call it in the loop thread, or before loop().
+  void setBusyPoll(int spinMicroseconds, int socketBusyPollMicroseconds = 0);
+  int socketBusyPoll() const { return socketBusyPoll_; }
+  /// Fraction of wall time spent spinning since busy polling was turned on.
+  double spinRatio() const;
+
+  /// Timer counters of this loop, timerfd_settime(2) calls issued,
+  /// and the ones saved by timer slack.
+  int64_t timerfdResets() const;
+  int64_t timerfdResetsSaved() const;
+
+  /// One line of statistics per live EventLoop, for the Inspector.
+  static string allStatsString();
+
   // timers
 
   ///
   /// Runs callback at 'time'.
+  /// With @c slack > 0 the callback may run up to @c slack seconds later,
+  /// so nearby timers share one wakeup and one timerfd_settime(2).
   /// Safe to call from other threads.
   ///
-  TimerId runAt(Timestamp time, TimerCallback cb);
+  TimerId runAt(Timestamp time, TimerCallback cb, double slack = 0.0);
   ///
   /// Runs callback after @c delay seconds.
   /// Safe to call from other threads.
   ///
-  TimerId runAfter(double delay, TimerCallback cb);
+  TimerId runAfter(double delay, TimerCallback cb, double slack = 0.0);
   ///
   /// Runs callback every @c interval seconds.
   /// Safe to call from other threads.
   ///
-  TimerId runEvery(double interval, TimerCallback cb);
+  TimerId runEvery(double interval, TimerCallback cb, double slack = 0.0);
+  ///
+  /// Lets timers use the poll return time instead of reading the clock:
+  /// runAfter/runEvery called in the loop thread count from it,
+  /// and expiry is checked against it, so no timer runs early by the clock
+  /// but those added late in a long iteration may run early by the iteration's age.
+  /// Call it before loop() or in the loop thread.
+  ///
+  void setCachedClock(bool on) { cachedClock_ = on; }
+  bool cachedClock() const { return cachedClock_; }
   ///
   /// Cancels the timer.
   /// Safe to call from other threads.
   ///
   void cancel(TimerId timerId);
 
+  ///
+  /// Lets the Buffers of connections in this loop draw from a loop-local pool.
+  /// Must be called in the loop thread before connections are assigned,
+  /// eg. in the ThreadInitCallback.
+  ///
+  void enableBufferPool(size_t maxCachedBytes = BufferPool::kDefaultMaxCachedBytes);
+
+  /// NULL if the pool is not enabled.
+  const BufferPoolPtr &bufferPool() const { return bufferPool_; }
+
+  ///
+  /// A TimeoutWheel of the loop for coarse per-connection timeouts, whose tick is
+  /// @c tickSeconds rounded down to a power of two milliseconds, or 1s if it's longer.
+  /// Callers asking for the same rounded tick share one wheel, created on first use.
+  /// Must be called in the loop thread.
+  ///
+  TimeoutWheel *timeoutWheel(double tickSeconds = 1.0);
+
+  /// The poller if it's the io_uring one (MUDUO_USE_IOURING), otherwise NULL.
+  IoUringPoller *ioUringPoller() const { return ioUringPoller_; }
+
   // internal usage
+  void countCoalescedSend() { coalescedSends_.store(coalescedSends_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+  void countCoalescedFlush() { coalescedFlushes_.store(coalescedFlushes_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
   void wakeup();
   void updateChannel(Channel *channel);
   void removeChannel(Channel *channel);
@@ -118,8 +248,11 @@ class EventLoop : noncopyable
   void abortNotInLoopThread();
   void handleRead();  // waked up
   void doPendingFunctors();
+  void queueCall(detail::PendingCall *call);
+  Timestamp poll();
 
   void printActiveChannels() const;  // DEBUG
+  Timestamp timerNow() const;
 
   typedef std::vector<Channel *> ChannelList;  // 没有channel的所有权，不管理生命周期
 
@@ -131,19 +264,43 @@ class EventLoop : noncopyable
   const pid_t threadId_;
   Timestamp pollReturnTime_;
   std::unique_ptr<Poller> poller_;
+  IoUringPoller *ioUringPoller_;  // 指向poller_，不是io_uring时为NULL
   std::unique_ptr<TimerQueue> timerQueue_;
   int wakeupFd_;
   // unlike in TimerQueue, which is an internal class,
   // we don't expose Channel to client.
   std::unique_ptr<Channel> wakeupChannel_;
+  BufferPoolPtr bufferPool_;
+  std::map<int64_t, std::unique_ptr<TimeoutWheel>> timeoutWheels_;  // 按tick的毫秒数，在timerQueue_之前析构
   boost::any context_;
 
   // scratch variables
   ChannelList activeChannels_;
   Channel *currentActiveChannel_;
 
-  mutable Mutex mutex_;
-  std::vector<Functor> pendingFunctors_;
+  // 其他线程无锁地push，loop线程取出；节点就是调用本身，submit()的结果也在里面
+  MpscNodeQueue pendingCalls_;
+  alignas(64) std::atomic<size_t> callsQueued_;
+  alignas(64) std::atomic<size_t> callsRun_;
+  std::vector<detail::PendingCall *> runningCalls_;  // scratch，保留容量
+  detail::CallNodePool *callPool_;                   // 有引用计数，Future可能比loop活得久
+  std::vector<Functor> runningFunctors_;             // scratch，保留容量
+
+  std::vector<Functor> flushFunctors_;  // 只在loop线程访问，不用加锁
+  // 只有loop线程写，Inspector等其他线程读
+  std::atomic<int64_t> coalescedSends_;
+  std::atomic<int64_t> coalescedFlushes_;
+
+  // 已经写过eventfd、loop还没读的时候为true，后来的生产者不用再写
+  std::atomic<bool> wakeupPending_;
+  std::atomic<int64_t> wakeupsIssued_;
+  std::atomic<int64_t> wakeupsSuppressed_;
+
+  int busyPoll_;                          // 空转的时长，微秒，0为不空转
+  int socketBusyPoll_;                    // 连接的SO_BUSY_POLL，微秒
+  std::atomic<int64_t> busyPollSince_;    // 打开空转的时间，Inspector会读
+  std::atomic<int64_t> spinMicroseconds_;  // 累计空转的时间
+  bool cachedClock_;                      // timer用pollReturnTime_代替读时钟
 };
 
 }  // namespace net
@@ -0,0 +1,560 @@
+#ifndef MUDUO_NET_FUTURE_H
+#define MUDUO_NET_FUTURE_H
+
+#include "muduo/base/Condition.h"
+#include "muduo/base/Exception.h"
+#include "muduo/base/Mutex.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThreadPool.h"
+
+#include <cstddef>  // max_align_t
+#include <exception>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace muduo
+{
+namespace net
+{
+namespace detail
+{
+/// Value or exception of a finished call.
+template <typename T>
+class Result : noncopyable
+{
+ public:
+  Result() : hasValue_(false) {}
+  Result(Result &&other) : hasValue_(false) { moveFrom(other); }
+  Result &operator=(Result &&other)
+  {
+    if (this != &other)
+    {
+      clear();
+      moveFrom(other);
+    }
+    return *this;
+  }
+  ~Result() { clear(); }
+
+  template <typename F>
+  void setFrom(F &f)
+  {
+    try
+    {
+      new (&storage_) T(f());
+      hasValue_ = true;
+    }
+    catch (...)
+    {
+      exception_ = std::current_exception();
+    }
+  }
+  void setValue(T &&value)
+  {
+    new (&storage_) T(std::move(value));
+    hasValue_ = true;
+  }
+  void setException(std::exception_ptr e) { exception_ = e; }
+
+  bool empty() const { return !hasValue_ && !exception_; }
+
+  T take()
+  {
+    if (exception_)
+    {
+      std::exception_ptr e = exception_;
+      exception_ = std::exception_ptr();
+      std::rethrow_exception(e);
+    }
+    assert(hasValue_);
+    T value(std::move(*ptr()));
+    clear();
+    return value;
+  }
+
+ private:
+  T *ptr() { return static_cast<T *>(static_cast<void *>(&storage_)); }
+
+  void moveFrom(Result &other)
+  {
+    if (other.hasValue_)
+    {
+      setValue(std::move(*other.ptr()));
+    }
+    exception_ = other.exception_;
+    other.clear();
+  }
+
+  void clear()
+  {
+    if (hasValue_)
+    {
+      ptr()->~T();
+      hasValue_ = false;
+    }
+    exception_ = std::exception_ptr();
+  }
+
+  typename std::aligned_storage<sizeof(T), alignof(T)>::type storage_;
+  bool hasValue_;
+  std::exception_ptr exception_;
+};
+
+template <>
+class Result<void> : noncopyable
+{
+ public:
+  Result() : hasValue_(false) {}
+  Result(Result &&other) : hasValue_(other.hasValue_), exception_(other.exception_) { other.clear(); }
+  Result &operator=(Result &&other)
+  {
+    if (this != &other)
+    {
+      hasValue_ = other.hasValue_;
+      exception_ = other.exception_;
+      other.clear();
+    }
+    return *this;
+  }
+
+  template <typename F>
+  void setFrom(F &f)
+  {
+    try
+    {
+      f();
+      hasValue_ = true;
+    }
+    catch (...)
+    {
+      exception_ = std::current_exception();
+    }
+  }
+  void setValue() { hasValue_ = true; }
+  void setException(std::exception_ptr e) { exception_ = e; }
+
+  bool empty() const { return !hasValue_ && !exception_; }
+
+  void take()
+  {
+    std::exception_ptr e = exception_;
+    clear();
+    if (e)
+    {
+      std::rethrow_exception(e);
+    }
+  }
+
+ private:
+  void clear()
+  {
+    hasValue_ = false;
+    exception_ = std::exception_ptr();
+  }
+
+  bool hasValue_;
+  std::exception_ptr exception_;
+};
+
+///
+/// Shared by a Future and whoever produces its result, counted by hand
+/// so that a submit() call is the queue node, the callable and the result in one allocation.
+///
+template <typename T>
+class FutureState : noncopyable
+{
+ public:
+  explicit FutureState(int refs) : refs_(refs), done_(false), cond_(mutex_), continuationLoop_(NULL) {}
+  virtual ~FutureState() {}
+
+  void unref()
+  {
+    if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+      destroy();
+    }
+  }
+
+  /// Written by the producer before finish(), read by the Future after ready().
+  Result<T> &result() { return result_; }
+
+  /// Producer only, once.
+  void finish()
+  {
+    std::function<void()> continuation;
+    EventLoop *loop = NULL;
+    {
+      MutexGuard lock(mutex_);
+      assert(!done_.load(std::memory_order_relaxed));
+      done_.store(true, std::memory_order_release);
+      continuation.swap(continuation_);
+      loop = continuationLoop_;
+      cond_.notifyAll();
+    }
+    if (continuation)
+    {
+      dispatch(loop, continuation);
+    }
+  }
+
+  bool ready() const { return done_.load(std::memory_order_acquire); }
+
+  void wait()
+  {
+    if (ready())
+    {
+      return;
+    }
+    MutexGuard lock(mutex_);
+    while (!done_.load(std::memory_order_relaxed))
+    {
+      cond_.wait();
+    }
+  }
+
+  void setContinuation(EventLoop *loop, std::function<void()> &&cb)
+  {
+    {
+      MutexGuard lock(mutex_);
+      if (!done_.load(std::memory_order_relaxed))
+      {
+        continuation_ = std::move(cb);
+        continuationLoop_ = loop;
+        return;
+      }
+    }
+    dispatch(loop, cb);
+  }
+
+ private:
+  // 最后一个引用没了的时候调，SubmitCall可能在CallNodePool的节点里
+  virtual void destroy() { delete this; }
+
+  static void dispatch(EventLoop *loop, std::function<void()> &cb)
+  {
+    if (loop)
+    {
+      loop->runInLoop(std::move(cb));
+    }
+    else
+    {
+      cb();
+    }
+  }
+
+  std::atomic<int> refs_;
+  std::atomic<bool> done_;  // 在锁里改，ready()不加锁读
+  Mutex mutex_;
+  Condition cond_;
+  Result<T> result_;
+  std::function<void()> continuation_;
+  EventLoop *continuationLoop_;  // NULL表示在完成的线程里直接调
+};
+
+/// The node EventLoop::submit() queues, f runs in the loop and the result stays here.
+template <typename T, typename F>
+class SubmitCall : public PendingCall, public FutureState<T>
+{
+ public:
+  // 一个引用给loop，一个给Future；pool为NULL表示是new出来的
+  SubmitCall(F &&f, CallNodePool *pool) : FutureState<T>(2), f_(std::move(f)), pool_(pool) {}
+
+  void run() override
+  {
+    this->result().setFrom(f_);
+    this->finish();
+  }
+
+  void release() override
+  {
+    if (!this->ready())
+    {
+      this->result().setException(std::make_exception_ptr(Exception("EventLoop destroyed before running the call")));
+      this->finish();
+    }
+    this->unref();
+  }
+
+ private:
+  void destroy() override
+  {
+    CallNodePool *pool = pool_;
+    if (pool == NULL)
+    {
+      delete this;
+    }
+    else
+    {
+      this->~SubmitCall();
+      pool->deallocate(this);
+    }
+  }
+
+  F f_;
+  CallNodePool *pool_;
+};
+
+}  // namespace detail
+
+///
+/// Result of a call submitted to an EventLoop, see EventLoop::submit().
+///
+/// Either block on get() in a thread without a loop, or continue with then()
+/// onto a loop, or co_await it with muduo/net/coro/Awaitables.h.
+/// Move-only, get() and then() consume it.
+///
+template <typename T>
+class Future : noncopyable
+{
+ public:
+  typedef detail::FutureState<T> State;
+
+  Future() : state_(NULL) {}
+  Future(Future &&other) : state_(other.state_), result_(std::move(other.result_)) { other.state_ = NULL; }
+  Future &operator=(Future &&other)
+  {
+    if (this != &other)
+    {
+      reset();
+      state_ = other.state_;
+      other.state_ = NULL;
+      result_ = std::move(other.result_);
+    }
+    return *this;
+  }
+  ~Future() { reset(); }
+
+  /// Internal use only, adopts one reference of @c state.
+  explicit Future(State *state) : state_(state) {}
+  /// Internal use only, a result that was there right away.
+  explicit Future(detail::Result<T> &&result) : state_(NULL), result_(std::move(result)) {}
+
+  /// False once get() or then() took the result.
+  bool valid() const { return state_ != NULL || !result_.empty(); }
+  bool ready() const { return state_ != NULL ? state_->ready() : !result_.empty(); }
+
+  /// Blocks until the call finishes, returns what it returned or rethrows what it threw.
+  /// Never call it in the thread of the loop running the call, that loop would wait for itself.
+  T get()
+  {
+    assert(valid());
+    if (state_ != NULL)
+    {
+      state_->wait();
+      result_ = std::move(state_->result());
+      reset();
+    }
+    return result_.take();
+  }
+
+  ///
+  /// Calls @c cb with the ready Future in the thread of @c loop once the call finishes,
+  /// right away through runInLoop() if it already has.
+  /// A NULL @c loop calls it in the thread that finishes the call, keep it short.
+  ///
+  void then(EventLoop *loop, std::function<void(Future)> cb)
+  {
+    assert(valid());
+    State *state = state_;
+    state_ = NULL;
+    if (state == NULL)
+    {
+      state = new State(1);
+      state->result() = std::move(result_);
+      state->finish();
+    }
+    // 续调可能随loop一起被丢掉，持有Future才不会漏掉引用
+    std::shared_ptr<Future> ready(std::make_shared<Future>(state));
+    state->setContinuation(loop, [ready, cb]() { cb(std::move(*ready)); });
+  }
+
+ private:
+  void reset()
+  {
+    if (state_ != NULL)
+    {
+      state_->unref();
+      state_ = NULL;
+    }
+  }
+
+  State *state_;
+  detail::Result<T> result_;  // 在loop线程里submit()直接得到的结果，或者get()取回来的
+};
+
+template <typename F>
+Future<decltype(std::declval<F &>()())> EventLoop::submit(F f)
+{
+  typedef decltype(std::declval<F &>()()) T;
+  if (isInLoopThread())
+  {
+    detail::Result<T> result;
+    result.setFrom(f);
+    return Future<T>(std::move(result));
+  }
+  typedef detail::SubmitCall<T, F> Call;
+  Call *call = NULL;
+  if (sizeof(Call) <= detail::CallNodePool::kNodeSize && alignof(Call) <= alignof(std::max_align_t))
+  {
+    void *node = callPool_->allocate();
+    try
+    {
+      call = new (node) Call(std::move(f), callPool_);
+    }
+    catch (...)
+    {
+      callPool_->deallocate(node);
+      throw;
+    }
+  }
+  else
+  {
+    call = new Call(std::move(f), NULL);
+  }
+  queueCall(call);
+  return Future<T>(static_cast<detail::FutureState<T> *>(call));
+}
+
+namespace detail
+{
+template <typename T>
+class WhenAllState : public FutureState<std::vector<T>>
+{
+ public:
+  // 一个引用给合起来的Future，一个等最后一个结果
+  explicit WhenAllState(size_t n) : FutureState<std::vector<T>>(2), values_(n), remaining_(n) { finishIfDone(0); }
+
+  void set(size_t i, Future<T> &f)
+  {
+    try
+    {
+      values_[i] = f.get();
+    }
+    catch (...)
+    {
+      MutexGuard lock(mutex_);
+      if (!exception_)
+      {
+        exception_ = std::current_exception();
+      }
+    }
+    finishIfDone(1);
+  }
+
+ private:
+  void finishIfDone(size_t arrived)
+  {
+    if (remaining_.fetch_sub(arrived, std::memory_order_acq_rel) == arrived)
+    {
+      if (exception_)
+      {
+        this->result().setException(exception_);
+      }
+      else
+      {
+        this->result().setValue(std::move(values_));
+      }
+      this->finish();
+      this->unref();
+    }
+  }
+
+  std::vector<T> values_;
+  std::atomic<size_t> remaining_;
+  Mutex mutex_;
+  std::exception_ptr exception_;  // 第一个异常
+};
+
+template <>
+class WhenAllState<void> : public FutureState<void>
+{
+ public:
+  explicit WhenAllState(size_t n) : FutureState<void>(2), remaining_(n) { finishIfDone(0); }
+
+  void set(size_t, Future<void> &f)
+  {
+    try
+    {
+      f.get();
+    }
+    catch (...)
+    {
+      MutexGuard lock(mutex_);
+      if (!exception_)
+      {
+        exception_ = std::current_exception();
+      }
+    }
+    finishIfDone(1);
+  }
+
+ private:
+  void finishIfDone(size_t arrived)
+  {
+    if (remaining_.fetch_sub(arrived, std::memory_order_acq_rel) == arrived)
+    {
+      if (exception_)
+      {
+        result().setException(exception_);
+      }
+      else
+      {
+        result().setValue();
+      }
+      finish();
+      unref();
+    }
+  }
+
+  std::atomic<size_t> remaining_;
+  Mutex mutex_;
+  std::exception_ptr exception_;
+};
+
+template <typename T>
+struct WhenAllOf
+{
+  typedef std::vector<T> type;
+};
+
+template <>
+struct WhenAllOf<void>
+{
+  typedef void type;
+};
+
+}  // namespace detail
+
+///
+/// Submits a copy of @c f to every loop in @c loops, the Future gives all the results
+/// in the order of @c loops (void if f returns void), or the first exception.
+/// f's result type must be default constructible.
+///
+template <typename F>
+Future<typename detail::WhenAllOf<decltype(std::declval<F &>()())>::type> whenAll(const std::vector<EventLoop *> &loops, F f)
+{
+  typedef decltype(std::declval<F &>()()) T;
+  typedef typename detail::WhenAllOf<T>::type R;
+  static_assert(!std::is_same<T, bool>::value, "results are written concurrently, vector<bool> would share bytes");
+  detail::WhenAllState<T> *state = new detail::WhenAllState<T>(loops.size());
+  for (size_t i = 0; i < loops.size(); ++i)
+  {
+    // 每个结果都会到，哪怕loop先析构了，state在最后一个到的时候才释放
+    loops[i]->submit(f).then(NULL, [state, i](Future<T> result) { state->set(i, result); });
+  }
+  return Future<R>(static_cast<detail::FutureState<R> *>(state));
+}
+
+/// whenAll() over every loop of @c pool, the base loop if it has no threads.
+/// Call it in the base loop thread, and then() the result rather than get() it there.
+template <typename F>
+Future<typename detail::WhenAllOf<decltype(std::declval<F &>()())>::type> whenAll(EventLoopThreadPool *pool, F f)
+{
+  return whenAll(pool->getAllLoops(), std::move(f));
+}
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_FUTURE_H
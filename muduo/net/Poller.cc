@@ -12,6 +12,5 @@ Poller::~Poller() = default;
 bool Poller::hasChannel(Channel *channel) const
 {
   assertInLoopThread();
-  ChannelMap::const_iterator it = channels_.find(channel->fd());
-  return it != channels_.end() && it->second == channel;
+  return channels_.find(channel->fd()) == channel;
 }
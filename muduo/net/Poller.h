@@ -1,10 +1,10 @@
 #ifndef MUDUO_NET_POLLER_H
 #define MUDUO_NET_POLLER_H
 
-#include <map>
 #include <vector>
 
 #include "muduo/base/Timestamp.h"
+#include "muduo/net/ChannelTable.h"
 #include "muduo/net/EventLoop.h"
 
 namespace muduo
@@ -44,8 +44,7 @@ class Poller : noncopyable
   void assertInLoopThread() const { ownerLoop_->assertInLoopThread(); }
 
  protected:
-  typedef std::map<int, Channel *> ChannelMap;
-  ChannelMap channels_;
+  ChannelTable channels_;
 
  private:
   EventLoop *ownerLoop_;
@@ -0,0 +1,52 @@
+#ifndef MUDUO_NET_SHAREDPAYLOAD_H
+#define MUDUO_NET_SHAREDPAYLOAD_H
+
+#include "muduo/base/StringPiece.h"
+#include "muduo/base/Types.h"
+#include "muduo/base/copyable.h"
+#include "muduo/net/Buffer.h"
+
+#include <memory>
+
+namespace muduo
+{
+namespace net
+{
+///
+/// An immutable, reference counted byte string.
+///
+/// Copying a SharedPayload only bumps the reference count, so one frame
+/// can be queued on the output path of many connections without copying it,
+/// the bytes are freed when the last connection has written them.
+class SharedPayload : public muduo::copyable
+{
+ public:
+  SharedPayload() {}
+
+  explicit SharedPayload(const StringPiece &data) : data_(std::make_shared<const string>(data.data(), data.size())) {}
+
+  explicit SharedPayload(string &&data) : data_(std::make_shared<const string>(std::move(data))) {}
+
+  /// Takes all readable bytes of buf.
+  explicit SharedPayload(Buffer *buf) : data_(std::make_shared<const string>(buf->retrieveAllAsString())) {}
+
+  // default copy-ctor, dtor and assignment are okay
+
+  const char *data() const { return data_ ? data_->data() : NULL; }
+
+  size_t size() const { return data_ ? data_->size() : 0; }
+
+  bool empty() const { return size() == 0; }
+
+  StringPiece toStringPiece() const { return StringPiece(data(), static_cast<int>(size())); }
+
+  long useCount() const { return data_.use_count(); }
+
+ private:
+  std::shared_ptr<const string> data_;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_SHAREDPAYLOAD_H
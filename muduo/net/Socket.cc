@@ -106,6 +106,40 @@ void Socket::setReusePort(bool on)
 #endif
 }
 
+bool Socket::setZeroCopy(bool on)
+{
+#ifdef SO_ZEROCOPY
+  int optval = on ? 1 : 0;
+  int ret = ::setsockopt(sockfd_, SOL_SOCKET, SO_ZEROCOPY, &optval, static_cast<socklen_t>(sizeof optval));
+  if (ret < 0 && on)
+  {
+    LOG_SYSERR << "SO_ZEROCOPY failed.";
+  }
+  return ret == 0;
+#else
+  if (on)
+  {
+    LOG_ERROR << "SO_ZEROCOPY is not supported.";
+  }
+  return !on;
+#endif
+}
+
+bool Socket::setBusyPoll(int usec)
+{
+#ifdef SO_BUSY_POLL
+  int ret = ::setsockopt(sockfd_, SOL_SOCKET, SO_BUSY_POLL, &usec, static_cast<socklen_t>(sizeof usec));
+  if (ret < 0)
+  {
+    LOG_SYSERR << "SO_BUSY_POLL failed.";
+  }
+  return ret == 0;
+#else
+  LOG_ERROR << "SO_BUSY_POLL is not supported.";
+  return false;
+#endif
+}
+
 void Socket::setKeepAlive(bool on)
 {
   int optval = on ? 1 : 0;
@@ -66,6 +66,17 @@ class Socket : noncopyable
   ///
   void setKeepAlive(bool on);
 
+  ///
+  /// Enable/disable SO_ZEROCOPY, return false if the kernel doesn't support it
+  ///
+  bool setZeroCopy(bool on);
+
+  ///
+  /// Set SO_BUSY_POLL, blocking reads busy poll the device queue for @c usec,
+  /// return false if not permitted (raising it needs CAP_NET_ADMIN) or not supported
+  ///
+  bool setBusyPoll(int usec);
+
  private:
   const int sockfd_;
 };
@@ -7,10 +7,13 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>  // snprintf
+#include <sys/sendfile.h>
 #include <sys/socket.h>
-#include <sys/uio.h>  // readv
+#include <sys/uio.h>  // readv, writev
 #include <unistd.h>
 
+#include <linux/errqueue.h>
+
 using namespace muduo;
 using namespace muduo::net;
 
@@ -165,6 +168,60 @@ ssize_t sockets::write(int sockfd, const void *buf, size_t count)
   return ::write(sockfd, buf, count);
 }
 
+ssize_t sockets::writev(int sockfd, const struct iovec *iov, int iovcnt)
+{
+  return ::writev(sockfd, iov, iovcnt);
+}
+
+ssize_t sockets::sendfile(int sockfd, int inFd, off_t *offset, size_t count)
+{
+  return ::sendfile(sockfd, inFd, offset, count);
+}
+
+ssize_t sockets::sendZeroCopy(int sockfd, const void *buf, size_t count)
+{
+  return ::send(sockfd, buf, count, MSG_ZEROCOPY);
+}
+
+bool sockets::readZeroCopyCompletion(int sockfd, uint32_t *lo, uint32_t *hi, bool *copied)
+{
+  char control[128];
+  struct msghdr msg;
+  memZero(&msg, sizeof msg);
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof control;
+  while (::recvmsg(sockfd, &msg, MSG_ERRQUEUE) >= 0)
+  {
+    for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != NULL; cm = CMSG_NXTHDR(&msg, cm))
+    {
+      // IPv4是IP_RECVERR，IPv6是IPV6_RECVERR，两者的载荷一样
+      if ((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) || (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))
+      {
+        const struct sock_extended_err *serr = reinterpret_cast<const struct sock_extended_err *>(CMSG_DATA(cm));
+        if (serr->ee_errno == 0 && serr->ee_origin == SO_EE_ORIGIN_ZEROCOPY)
+        {
+          *lo = serr->ee_info;
+          *hi = serr->ee_data;
+          *copied = (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0;
+          return true;
+        }
+      }
+    }
+    // 不是zerocopy的通知，继续读下一个
+    msg.msg_controllen = sizeof control;
+  }
+  if (errno != EAGAIN)
+  {
+    LOG_SYSERR << "sockets::readZeroCopyCompletion";
+  }
+  return false;
+}
+
+ssize_t sockets::splice(int fdIn, int fdOut, size_t len)
+{
+  return ::splice(fdIn, NULL, fdOut, NULL, len, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+}
+
 void sockets::close(int sockfd)
 {
   if (::close(sockfd) < 0)
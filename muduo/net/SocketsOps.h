@@ -21,6 +21,17 @@ int accept(int sockfd, struct sockaddr_in6 *addr);
 ssize_t read(int sockfd, void *buf, size_t count);
 ssize_t readv(int sockfd, const struct iovec *iov, int iovcnt);
 ssize_t write(int sockfd, const void *buf, size_t count);
+ssize_t writev(int sockfd, const struct iovec *iov, int iovcnt);
+// sends count bytes of inFd from *offset, *offset is advanced
+ssize_t sendfile(int sockfd, int inFd, off_t *offset, size_t count);
+// send(2) with MSG_ZEROCOPY, buf must stay untouched until the completion is read from the error queue
+ssize_t sendZeroCopy(int sockfd, const void *buf, size_t count);
+// reads one zero-copy completion from the error queue, it covers the sends numbered [*lo, *hi],
+// *copied is set if the kernel fell back to copying
+// @return false if there is none
+bool readZeroCopyCompletion(int sockfd, uint32_t *lo, uint32_t *hi, bool *copied);
+// moves at most len bytes from fdIn to fdOut, one of them must be a pipe
+ssize_t splice(int fdIn, int fdOut, size_t len);
 void close(int sockfd);
 void shutdownWrite(int sockfd);
 
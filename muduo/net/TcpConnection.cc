@@ -6,12 +6,29 @@
 #include "muduo/net/EventLoop.h"
 #include "muduo/net/Socket.h"
 #include "muduo/net/SocketsOps.h"
+#include "muduo/net/TimeoutWheel.h"
+#include "muduo/net/poller/IoUringPoller.h"
+
+#include <algorithm>
 
 #include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
+namespace
+{
+// proactor模式下提交给io_uring的操作
+const uint8_t kRecvOp = 1;
+const uint8_t kSendOp = 2;
+const uint8_t kWritableOp = 3;  // 文件区间在最前面时，等可写再sendfile
+
+}  // namespace
+
 void muduo::net::defaultConnectionCallback(const TcpConnectionPtr &conn)
 {
   LOG_TRACE << conn->localAddress().toIpPort() << " -> " << conn->peerAddress().toIpPort() << " is " << (conn->connected() ? "UP" : "DOWN");
@@ -23,6 +40,59 @@ void muduo::net::defaultMessageCallback(const TcpConnectionPtr &, Buffer *buf, T
   buf->retrieveAll();
 }
 
+struct TcpConnection::ProactorIo : noncopyable
+{
+  explicit ProactorIo(IoUringPoller *p)
+      : poller(p), id(0), registered(false), recvArmed(false), sending(false), sendQueued(false), sendOp(0)
+  {
+    memZero(&msg, sizeof msg);
+  }
+
+  IoUringPoller *poller;
+  uint32_t id;
+  bool registered;         // poller里的handler持有这个连接，内核还在用msg和outputBuffer_的时候不能析构
+  bool recvArmed;          // recv在内核里
+  bool sending;            // SENDMSG或者等可写的POLL_ADD在内核里
+  bool sendQueued;         // 等这一轮结束时提交
+  uint8_t sendOp;          // 在内核里的是kSendOp还是kWritableOp
+  struct msghdr msg;
+  struct iovec iov[ChainBuffer::kMaxIovec];
+};
+
+struct TcpConnection::Timeouts : noncopyable
+{
+  Timeouts(TcpConnection *conn, double idleSeconds, double readSeconds, double writeSeconds)
+      : wheel(NULL),
+        entry(std::bind(&TcpConnection::handleTimeout, conn, _1)),
+        idle(idleSeconds),
+        read(readSeconds),
+        write(writeSeconds)
+  {
+  }
+
+  // 最短的超时，决定第一次检查的时间和轮子的tick
+  double shortest() const
+  {
+    double result = 0.0;
+    for (double t : {idle, read, write})
+    {
+      if (t > 0.0 && (result == 0.0 || t < result))
+      {
+        result = t;
+      }
+    }
+    return result;
+  }
+
+  TimeoutWheel *wheel;
+  TimeoutWheel::Entry entry;  // 连接断开时从轮子上摘下来，回调里直接用裸指针
+  const double idle;
+  const double read;
+  const double write;
+  Timestamp lastRead;   // 最后一次收到数据
+  Timestamp lastWrite;  // 对端最后一次收走数据
+};
+
 TcpConnection::TcpConnection(EventLoop *loop, const string &nameArg, int sockfd, const InetAddress &localAddr, const InetAddress &peerAddr)
     : loop_(CHECK_NOTNULL(loop)),
       name_(nameArg),
@@ -32,7 +102,16 @@ TcpConnection::TcpConnection(EventLoop *loop, const string &nameArg, int sockfd,
       channel_(new Channel(loop, sockfd)),
       localAddr_(localAddr),
       peerAddr_(peerAddr),
-      highWaterMark_(64 * 1024 * 1024)
+      highWaterMark_(64 * 1024 * 1024),
+      inputBuffer_(loop->bufferPool()),
+      outputBuffer_(loop->bufferPool()),
+      idleBufferRelease_(-1.0),
+      idleBufferTimerArmed_(false),
+      zeroCopyThreshold_(0),
+      zeroCopySeq_(0),
+      writeCoalescing_(false),
+      coalescedFlushQueued_(false),
+      proactorRequested_(false)
 {
   // 设置当前连接的回调函数
   channel_->setReadCallback(std::bind(&TcpConnection::handleRead, this, _1));
@@ -49,6 +128,19 @@ TcpConnection::~TcpConnection()
   assert(state_ == kDisconnected);
 }
 
+void TcpConnection::setTimeouts(double idleSeconds, double readSeconds, double writeSeconds)
+{
+  assert(state_ == kConnecting);
+  if (idleSeconds > 0.0 || readSeconds > 0.0 || writeSeconds > 0.0)
+  {
+    timeouts_.reset(new Timeouts(this, idleSeconds, readSeconds, writeSeconds));
+  }
+  else
+  {
+    timeouts_.reset();
+  }
+}
+
 bool TcpConnection::getTcpInfo(struct tcp_info *tcpi) const
 {
   return socket_->getTcpInfo(tcpi);
@@ -90,6 +182,48 @@ void TcpConnection::send(const StringPiece &message)
   }
 }
 
+void TcpConnection::send(const SharedPayload &payload)
+{
+  if (state_ == kConnected)
+  {
+    if (loop_->isInLoopThread())
+    {
+      sendPayloadInLoop(payload);
+    }
+    else
+    {
+      // 跨线程只拷贝payload的引用，不拷贝数据
+      loop_->runInLoop(std::bind(&TcpConnection::sendPayloadInLoop,
+                                 this,  // FIXME
+                                 payload));
+    }
+  }
+}
+
+void TcpConnection::sendFile(int fd, off_t offset, size_t length)
+{
+  if (state_ == kConnected)
+  {
+    if (loop_->isInLoopThread())
+    {
+      sendFileInLoop(fd, offset, length);
+    }
+    else
+    {
+      // 跨线程的话，fd可能在loop执行之前被调用者close，所以先dup一份
+      int dupFd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+      if (dupFd < 0)
+      {
+        LOG_SYSERR << "TcpConnection::sendFile";
+        return;
+      }
+      loop_->runInLoop(std::bind(&TcpConnection::sendDupFileInLoop,
+                                 this,  // FIXME
+                                 dupFd, offset, length));
+    }
+  }
+}
+
 // FIXME efficiency!!!
 void TcpConnection::send(Buffer *buf)
 {
@@ -119,24 +253,185 @@ void TcpConnection::sendInLoop(const StringPiece &message)
 void TcpConnection::sendInLoop(const void *data, size_t len)
 {
   loop_->assertInLoopThread();
-  ssize_t nwrote = 0;
-  size_t remaining = len;
+  if (state_ == kDisconnected)
+  {
+    LOG_WARN << "disconnected, give up writing";
+    return;
+  }
+  startWriteTimeout();
+  if (proactor_)
+  {
+    checkHighWaterMark(len);
+    outputBuffer_.append(data, len);
+    scheduleSend();
+    return;
+  }
+  if (writeCoalescing_)
+  {
+    checkHighWaterMark(len);
+    outputBuffer_.append(data, len);
+    coalesceWrite();
+    return;
+  }
+  bool faultError = false;
+  size_t nwrote = writeDirectly(data, len, &faultError);
+  size_t remaining = len - nwrote;
+  // 如果数据没发送完，那么必须先加入到应用层的发送缓冲区，目的是为了有序发送
+  if (!faultError && remaining > 0)
+  {
+    checkHighWaterMark(remaining);
+    // 把未发送完的数据保存到应用层写缓冲区
+    outputBuffer_.append(static_cast<const char *>(data) + nwrote, remaining);
+    if (!channel_->isWriting())  // 关注内核socket可写事件，可写事件把应用层数据写到内核
+    {
+      channel_->enableWriting();
+    }
+  }
+}
+
+void TcpConnection::sendPayloadInLoop(const SharedPayload &payload)
+{
+  loop_->assertInLoopThread();
+  if (state_ == kDisconnected)
+  {
+    LOG_WARN << "disconnected, give up writing";
+    return;
+  }
+  startWriteTimeout();
+  if (proactor_)
+  {
+    checkHighWaterMark(payload.size());
+    outputBuffer_.append(payload);
+    scheduleSend();
+    return;
+  }
+  if (writeCoalescing_)
+  {
+    checkHighWaterMark(payload.size());
+    outputBuffer_.append(payload);
+    coalesceWrite();
+    return;
+  }
   bool faultError = false;
+  const bool zeroCopy = zeroCopyThreshold_ > 0 && payload.size() >= zeroCopyThreshold_;
+  size_t nwrote = writeDirectly(payload.data(), payload.size(), &faultError, zeroCopy ? &payload : NULL);
+  size_t remaining = payload.size() - nwrote;
+  if (!faultError && remaining > 0)
+  {
+    checkHighWaterMark(remaining);
+    // 没写完的部分只引用payload，不拷贝
+    outputBuffer_.append(payload, nwrote);
+    if (!channel_->isWriting())
+    {
+      channel_->enableWriting();
+    }
+  }
+}
+
+void TcpConnection::sendFileInLoop(int fd, off_t offset, size_t length)
+{
+  loop_->assertInLoopThread();
   if (state_ == kDisconnected)
   {
     LOG_WARN << "disconnected, give up writing";
     return;
   }
+  startWriteTimeout();
+  bool faultError = false;
+  size_t nwrote = 0;
+  if (proactor_)
+  {
+    // 排在outputBuffer_里，轮到它的时候等可写再sendfile
+  }
+  else if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
+  {
+    // 前面没有排队的数据，直接sendfile
+    ssize_t n = sockets::sendfile(channel_->fd(), fd, &offset, length);
+    if (n >= 0)
+    {
+      nwrote = implicit_cast<size_t>(n);
+      if (nwrote == length && writeCompleteCallback_)
+      {
+        loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+      }
+    }
+    else
+    {
+      faultError = handleWriteError("TcpConnection::sendFileInLoop");
+    }
+  }
+  size_t remaining = length - nwrote;
+  if (!faultError && remaining > 0)
+  {
+    checkHighWaterMark(remaining);
+    // 文件区间只记录fd和偏移，可写时由handleWrite用sendfile发送
+    if (!outputBuffer_.appendFile(fd, offset, remaining))
+    {
+      LOG_SYSERR << "TcpConnection::sendFileInLoop";
+      forceCloseInLoop();
+      return;
+    }
+    if (proactor_)
+    {
+      scheduleSend();
+    }
+    else if (!channel_->isWriting())
+    {
+      channel_->enableWriting();
+    }
+  }
+}
+
+void TcpConnection::sendDupFileInLoop(int dupFd, off_t offset, size_t length)
+{
+  sendFileInLoop(dupFd, offset, length);
+  sockets::close(dupFd);
+}
+
+bool TcpConnection::handleWriteError(const char *where)
+{
+  if (errno != EWOULDBLOCK)
+  {
+    LOG_SYSERR << where;
+    if (errno == EPIPE || errno == ECONNRESET)  // FIXME: any others?
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t TcpConnection::writeDirectly(const void *data, size_t len, bool *faultError, const SharedPayload *zeroCopy)
+{
+  ssize_t nwrote = 0;
   // if no thing in output queue, try writing directly
   // 应用层发送缓冲区如果为空，channel就不会关注可写事件
   if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
   {
     // 应用层发送缓冲区为空，就直接写入内核
-    nwrote = sockets::write(channel_->fd(), data, len);
+    if (zeroCopy)
+    {
+      nwrote = sockets::sendZeroCopy(channel_->fd(), data, len);
+      if (nwrote > 0)
+      {
+        pinZeroCopy(*zeroCopy);
+      }
+      else if (nwrote < 0 && errno == ENOBUFS)
+      {
+        nwrote = sockets::write(channel_->fd(), data, len);
+      }
+    }
+    else
+    {
+      nwrote = sockets::write(channel_->fd(), data, len);
+    }
     if (nwrote >= 0)
     {
-      remaining = len - nwrote;
-      if (remaining == 0 && writeCompleteCallback_)
+      if (nwrote > 0 && timeouts_)
+      {
+        timeouts_->lastWrite = loop_->pollReturnTime();
+      }
+      if (implicit_cast<size_t>(nwrote) == len && writeCompleteCallback_)
       {
         loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
       }
@@ -144,33 +439,20 @@ void TcpConnection::sendInLoop(const void *data, size_t len)
     else  // nwrote < 0
     {
       nwrote = 0;
-      if (errno != EWOULDBLOCK)
-      {
-        LOG_SYSERR << "TcpConnection::sendInLoop";
-        if (errno == EPIPE || errno == ECONNRESET)  // FIXME: any others?
-        {
-          faultError = true;
-        }
-      }
+      *faultError = handleWriteError("TcpConnection::sendInLoop");
     }
   }
+  assert(implicit_cast<size_t>(nwrote) <= len);
+  return implicit_cast<size_t>(nwrote);
+}
 
-  // 如果数据没发送完，那么必须先加入到应用层的发送缓冲区，目的是为了有序发送
-  assert(remaining <= len);
-  if (!faultError && remaining > 0)
+void TcpConnection::checkHighWaterMark(size_t remaining)
+{
+  size_t oldLen = outputBuffer_.readableBytes();
+  if (oldLen + remaining >= highWaterMark_ && oldLen < highWaterMark_ && highWaterMarkCallback_)
   {
-    size_t oldLen = outputBuffer_.readableBytes();
-    if (oldLen + remaining >= highWaterMark_ && oldLen < highWaterMark_ && highWaterMarkCallback_)
-    {
-      // 应用层写缓冲区超过高水位
-      loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
-    }
-    // 把未发送完的数据保存到应用层写缓冲区
-    outputBuffer_.append(static_cast<const char *>(data) + nwrote, remaining);
-    if (!channel_->isWriting())  // 关注内核socket可写事件，可写事件把应用层数据写到内核
-    {
-      channel_->enableWriting();
-    }
+    // 应用层写缓冲区超过高水位
+    loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
   }
 }
 
@@ -188,7 +470,8 @@ void TcpConnection::shutdown()
 void TcpConnection::shutdownInLoop()
 {
   loop_->assertInLoopThread();
-  if (!channel_->isWriting())
+  // 打开了写合并的话，outputBuffer_里可能还有等着flush的数据
+  if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
   {
     // we are not writing
     socket_->shutdownWrite();
@@ -283,6 +566,12 @@ void TcpConnection::startRead()
 void TcpConnection::startReadInLoop()
 {
   loop_->assertInLoopThread();
+  if (proactor_)
+  {
+    reading_ = true;
+    armRecv();
+    return;
+  }
   if (!reading_ || !channel_->isReading())
   {
     channel_->enableReading();
@@ -298,6 +587,16 @@ void TcpConnection::stopRead()
 void TcpConnection::stopReadInLoop()
 {
   loop_->assertInLoopThread();
+  if (proactor_)
+  {
+    if (reading_ && proactor_->recvArmed)
+    {
+      // 取消之前已经收到的数据还是会交给MessageCallback
+      proactor_->poller->cancelOp(proactor_->id, kRecvOp);
+    }
+    reading_ = false;
+    return;
+  }
   if (reading_ || channel_->isReading())
   {
     channel_->disableReading();  // 不关注socket的可读事件
@@ -311,7 +610,27 @@ void TcpConnection::connectEstablished()
   assert(state_ == kConnecting);
   setState(kConnected);
   channel_->tie(shared_from_this());  // 保留一份数据
-  channel_->enableReading();          // 这个时候分配的ioloop会把channel加入，并关注可读事件
+  if (!proactorRequested_ || !startProactor())
+  {
+    channel_->enableReading();  // 这个时候分配的ioloop会把channel加入，并关注可读事件
+  }
+  if (loop_->socketBusyPoll() > 0)
+  {
+    socket_->setBusyPoll(loop_->socketBusyPoll());
+  }
+  if (idleBufferRelease_ >= 0)
+  {
+    // 数据到达之前不占用缓冲区内存
+    releaseIdleBuffers();
+  }
+  if (timeouts_)
+  {
+    const double shortest = timeouts_->shortest();
+    timeouts_->wheel = loop_->timeoutWheel(std::min(1.0, std::max(0.001, shortest / 8)));
+    const Timestamp now(Timestamp::now());
+    timeouts_->lastRead = timeouts_->lastWrite = now;
+    timeouts_->wheel->schedule(&timeouts_->entry, addTime(now, shortest));
+  }
 
   connectionCallback_(shared_from_this());
 }
@@ -323,91 +642,774 @@ void TcpConnection::connectDestroyed()
   {
     setState(kDisconnected);
     channel_->disableAll();  // 不关注任何事件
+    if (proactor_)
+    {
+      cancelProactorOps();
+    }
+    removeTimeouts();
 
     connectionCallback_(shared_from_this());
   }
   channel_->remove();  // 从归属的loop中删除channel的裸指针，loop没有channel的所有权
+  if (proactor_)
+  {
+    releaseProactor();
+  }
 }
 
-void TcpConnection::handleRead(Timestamp receiveTime)
+namespace
+{
+const size_t kSpliceChunk = 64 * 1024;  // 管道的默认容量
+
+}  // namespace
+
+struct TcpConnection::SplicePipe : noncopyable
+{
+  SplicePipe(int r, int w, const TcpConnectionPtr &src) : readFd(r), writeFd(w), pending(0), source(src) {}
+
+  ~SplicePipe()
+  {
+    sockets::close(readFd);
+    sockets::close(writeFd);
+  }
+
+  const int readFd;
+  const int writeFd;
+  size_t pending;  // 管道里的字节数
+  std::weak_ptr<TcpConnection> source;
+};
+
+bool TcpConnection::spliceTo(const TcpConnectionPtr &peer)
 {
   loop_->assertInLoopThread();
-  int savedErrno = 0;
-  // 把数据读入到应用层输入缓冲区
-  ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+  if (proactor_ || peer->proactor_)
+  {
+    LOG_ERROR << "TcpConnection::spliceTo [" << name_ << "] - not available in proactor mode";
+    return false;
+  }
+  assert(peer->getLoop() == loop_);
+  assert(!spliceOut_ && !peer->spliceIn_);
+  int fds[2];
+  if (::pipe2(fds, O_NONBLOCK | O_CLOEXEC) < 0)
+  {
+    LOG_SYSERR << "TcpConnection::spliceTo";
+    return false;
+  }
+  // 管道由两端共享，源连接先关闭的话，对端还能把管道里剩下的数据写完
+  spliceOut_.reset(new SplicePipe(fds[0], fds[1], shared_from_this()));
+  splicePeer_ = peer;
+  peer->spliceIn_ = spliceOut_;
+  if (inputBuffer_.readableBytes() > 0)
+  {
+    // 已经读进应用层的数据先转发过去
+    peer->send(&inputBuffer_);
+  }
+  return true;
+}
+
+void TcpConnection::handleSpliceRead()
+{
+  SplicePipe *pipe = get_pointer(spliceOut_);
+  // 管道是空的才会读，所以最多读一个管道的容量
+  ssize_t n = sockets::splice(channel_->fd(), pipe->writeFd, kSpliceChunk);
   if (n > 0)
   {
-    // 正常读出数据
-    messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+    pipe->pending += n;
+    if (timeouts_)
+    {
+      timeouts_->lastRead = loop_->pollReturnTime();
+    }
+    TcpConnectionPtr peer(splicePeer_.lock());
+    if (!peer || peer->disconnected())
+    {
+      // 没人会再清空管道，也就没人startRead，停读的话这个连接就永远挂着
+      forceClose();
+      return;
+    }
+    peer->flushSplice();
+    if (pipe->pending > 0)
+    {
+      // 对端写不动了，先不读，等管道清空再由对端startRead
+      stopReadInLoop();
+    }
   }
   else if (n == 0)
   {
-    // read返回为0，说明对方关闭了连接
     handleClose();
   }
-  else
+  else if (errno != EAGAIN)
   {
-    errno = savedErrno;
-    LOG_SYSERR << "TcpConnection::handleRead";
+    LOG_SYSERR << "TcpConnection::handleSpliceRead";
     handleError();
   }
 }
 
-void TcpConnection::handleWrite()
+void TcpConnection::flushSplice()
 {
   loop_->assertInLoopThread();
-  if (channel_->isWriting())  // channel可写
+  if (state_ == kDisconnected)
   {
-    ssize_t n = sockets::write(channel_->fd(), outputBuffer_.peek(), outputBuffer_.readableBytes());
+    return;
+  }
+  startWriteTimeout();
+  SplicePipe *pipe = get_pointer(spliceIn_);
+  // 应用层缓冲区里的数据先写，保证顺序
+  if (pipe->pending > 0 && outputBuffer_.readableBytes() == 0)
+  {
+    ssize_t n = sockets::splice(pipe->readFd, channel_->fd(), pipe->pending);
     if (n > 0)
     {
-      outputBuffer_.retrieve(n);
-      if (outputBuffer_.readableBytes() == 0)
+      pipe->pending -= n;
+      if (timeouts_)
       {
-        channel_->disableWriting();  // 应用层无数据可写，不关注可写事件
-        if (writeCompleteCallback_)
-        {
-          loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
-        }
-        if (state_ == kDisconnecting)  // 应用层数据写完了，并主动调用了shutdown的话
-        {
-          // 关闭写，TCP处于半关闭状态
-          shutdownInLoop();
-        }
+        timeouts_->lastWrite = loop_->pollReturnTime();
       }
     }
-    else
+    else if (n < 0 && errno != EAGAIN)
+    {
+      // 连接断了的话会有handleClose
+      LOG_SYSERR << "TcpConnection::flushSplice";
+    }
+  }
+  if (pipe->pending > 0 || outputBuffer_.readableBytes() > 0)
+  {
+    if (!channel_->isWriting())
     {
-      LOG_SYSERR << "TcpConnection::handleWrite";
-      // if (state_ == kDisconnecting)
-      // {
-      //   shutdownInLoop();
-      // }
+      channel_->enableWriting();
     }
   }
   else
   {
-    LOG_TRACE << "Connection fd = " << channel_->fd() << " is down, no more writing";
+    if (channel_->isWriting())
+    {
+      channel_->disableWriting();
+      if (state_ == kDisconnecting)
+      {
+        shutdownInLoop();
+      }
+    }
+    TcpConnectionPtr source(pipe->source.lock());
+    if (source && source->state_ != kDisconnected)
+    {
+      source->startReadInLoop();
+    }
   }
 }
 
-void TcpConnection::handleClose()
+void TcpConnection::handleRead(Timestamp receiveTime)
 {
   loop_->assertInLoopThread();
-  LOG_TRACE << "fd = " << channel_->fd() << " state = " << stateToString();
-  assert(state_ == kConnected || state_ == kDisconnecting);
-  // we don't close fd, leave it to dtor, so we can find leaks easily.
-  setState(kDisconnected);
-  channel_->disableAll();
-
-  TcpConnectionPtr guardThis(shared_from_this());
-  connectionCallback_(guardThis);
-  // must be the last line
+  if (spliceOut_)
+  {
+    handleSpliceRead();
+    return;
+  }
+  int savedErrno = 0;
+  // 把数据读入到应用层输入缓冲区
+  ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+  if (n > 0)
+  {
+    // 正常读出数据
+    if (timeouts_)
+    {
+      timeouts_->lastRead = receiveTime;
+    }
+    messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+    if (idleBufferRelease_ >= 0)
+    {
+      bufferActivity(receiveTime);
+    }
+  }
+  else if (n == 0)
+  {
+    // read返回为0，说明对方关闭了连接
+    handleClose();
+  }
+  else
+  {
+    errno = savedErrno;
+    LOG_SYSERR << "TcpConnection::handleRead";
+    handleError();
+  }
+}
+
+void TcpConnection::handleWrite()
+{
+  loop_->assertInLoopThread();
+  if (channel_->isWriting())  // channel可写
+  {
+    writeOutput();
+  }
+  else
+  {
+    LOG_TRACE << "Connection fd = " << channel_->fd() << " is down, no more writing";
+  }
+}
+
+void TcpConnection::writeOutput()
+{
+  if (spliceIn_ && outputBuffer_.readableBytes() == 0)
+  {
+    flushSplice();
+    return;
+  }
+  int savedErrno = 0;
+  // 用writev一次把输出缓冲区的多个block写入内核，写入的数据已经在writeFd里retrieve了
+  ssize_t n = 0;
+  if (zeroCopyThreshold_ > 0)
+  {
+    SharedPayload pinned;
+    n = outputBuffer_.writeFdZeroCopy(channel_->fd(), zeroCopyThreshold_, &pinned, &savedErrno);
+    if (!pinned.empty())
+    {
+      pinZeroCopy(pinned);
+    }
+  }
+  else
+  {
+    n = outputBuffer_.writeFd(channel_->fd(), &savedErrno);
+  }
+  if (n > 0)
+  {
+    if (timeouts_)
+    {
+      timeouts_->lastWrite = loop_->pollReturnTime();
+    }
+    if (outputBuffer_.readableBytes() == 0 && spliceIn_)
+    {
+      if (writeCompleteCallback_)
+      {
+        loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+      }
+      // 接着写管道里的数据，写完了flushSplice会处理shutdown
+      flushSplice();
+    }
+    else if (outputBuffer_.readableBytes() == 0)
+    {
+      if (channel_->isWriting())
+      {
+        channel_->disableWriting();  // 应用层无数据可写，不关注可写事件
+      }
+      if (writeCompleteCallback_)
+      {
+        loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+      }
+      if (state_ == kDisconnecting)  // 应用层数据写完了，并主动调用了shutdown的话
+      {
+        // 关闭写，TCP处于半关闭状态
+        shutdownInLoop();
+      }
+    }
+    else if (!channel_->isWriting())
+    {
+      // flushCoalesced没写完，剩下的等可写事件
+      channel_->enableWriting();
+    }
+    if (idleBufferRelease_ >= 0)
+    {
+      bufferActivity(Timestamp::now());
+    }
+  }
+  else if (savedErrno == EWOULDBLOCK)
+  {
+    if (!channel_->isWriting())
+    {
+      channel_->enableWriting();
+    }
+  }
+  else
+  {
+    errno = savedErrno;
+    LOG_SYSERR << "TcpConnection::handleWrite";
+    if (savedErrno == EIO)
+    {
+      // 文件区间没发完就被丢掉了，对端收到的字节流已经不完整
+      forceCloseInLoop();
+    }
+    // if (state_ == kDisconnecting)
+    // {
+    //   shutdownInLoop();
+    // }
+  }
+}
+
+void TcpConnection::coalesceWrite()
+{
+  loop_->countCoalescedSend();
+  if (!channel_->isWriting() && !coalescedFlushQueued_)
+  {
+    // 这一轮loop里的send都攒在outputBuffer_里，最后用一次writev发出去
+    coalescedFlushQueued_ = true;
+    loop_->queueFlush(std::bind(&TcpConnection::flushCoalesced, shared_from_this()));
+  }
+}
+
+void TcpConnection::flushCoalesced()
+{
+  coalescedFlushQueued_ = false;
+  // 已经在关注可写事件的话，由handleWrite去写
+  if (state_ == kDisconnected || channel_->isWriting() || outputBuffer_.readableBytes() == 0)
+  {
+    return;
+  }
+  loop_->countCoalescedFlush();
+  writeOutput();
+}
+
+void TcpConnection::bufferActivity(Timestamp now)
+{
+  if (idleBufferRelease_ == 0)
+  {
+    releaseDrainedBuffers();
+  }
+  else
+  {
+    lastBufferActivity_ = now;
+    if (!idleBufferTimerArmed_)
+    {
+      // 每个空闲周期最多一个定时器，释放之后不再检查，直到有新的读写
+      idleBufferTimerArmed_ = true;
+      loop_->runAfter(idleBufferRelease_, makeWeakCallback(shared_from_this(), &TcpConnection::checkIdleBuffers));
+    }
+  }
+}
+
+void TcpConnection::checkIdleBuffers()
+{
+  loop_->assertInLoopThread();
+  idleBufferTimerArmed_ = false;
+  if (state_ == kDisconnected)
+  {
+    return;
+  }
+  double idle = timeDifference(Timestamp::now(), lastBufferActivity_);
+  if (idle < idleBufferRelease_)
+  {
+    idleBufferTimerArmed_ = true;
+    loop_->runAfter(idleBufferRelease_ - idle, makeWeakCallback(shared_from_this(), &TcpConnection::checkIdleBuffers));
+  }
+  else
+  {
+    releaseIdleBuffers();
+  }
+}
+
+void TcpConnection::releaseDrainedBuffers()
+{
+  // 只放掉空的；还有半个消息的不动，热路径上收缩要把积压的数据整个拷一遍
+  if (inputBuffer_.readableBytes() == 0)
+  {
+    inputBuffer_.releaseStorage();
+  }
+  if (outputBuffer_.readableBytes() == 0)
+  {
+    outputBuffer_.releaseStorage();
+  }
+}
+
+void TcpConnection::releaseIdleBuffers()
+{
+  releaseDrainedBuffers();
+  // 空闲了一段时间还有半个消息的，容量比它大很多才收缩到刚好放下它
+  const size_t readable = inputBuffer_.readableBytes();
+  if (readable > 0 && inputBuffer_.internalCapacity() > 4 * (Buffer::kCheapPrepend + readable))
+  {
+    inputBuffer_.shrink(0);
+  }
+}
+
+void TcpConnection::handleTimeout(Timestamp now)
+{
+  loop_->assertInLoopThread();
+  if (state_ != kConnected && state_ != kDisconnecting)
+  {
+    return;
+  }
+  Timeouts *t = get_pointer(timeouts_);
+  // 读写的时候只记时间，到这里才看真正的期限，没到就按最早的期限重新挂上去
+  const char *expired = NULL;
+  Timestamp next;
+  auto check = [&](double timeout, Timestamp since, const char *what) {
+    if (timeout > 0.0 && expired == NULL)
+    {
+      const Timestamp deadline(addTime(since, timeout));
+      if (!(now < deadline))
+      {
+        expired = what;
+      }
+      else if (!next.valid() || deadline < next)
+      {
+        next = deadline;
+      }
+    }
+  };
+  check(t->idle, std::max(t->lastRead, t->lastWrite), "idle");
+  check(t->read, t->lastRead, "read");
+  // 没有要写的数据时，最早也要等一个完整的写超时
+  check(t->write, isWritePending() ? t->lastWrite : now, "write");
+
+  if (expired)
+  {
+    LOG_INFO << "TcpConnection::handleTimeout [" << name_ << "] - " << expired << " timeout";
+    forceClose();
+  }
+  else
+  {
+    t->wheel->schedule(&t->entry, next);
+  }
+}
+
+bool TcpConnection::isWritePending() const
+{
+  return outputBuffer_.readableBytes() > 0 || channel_->isWriting() || (proactor_ && proactor_->sending);
+}
+
+void TcpConnection::startWriteTimeout()
+{
+  // 输出从空变成有数据的时候开始算写超时，不然安静了很久之后第一次写不动就会马上超时
+  if (timeouts_ && !isWritePending())
+  {
+    timeouts_->lastWrite = loop_->pollReturnTime();
+  }
+}
+
+void TcpConnection::removeTimeouts()
+{
+  if (timeouts_ && timeouts_->wheel)
+  {
+    timeouts_->wheel->remove(&timeouts_->entry);
+  }
+}
+
+void TcpConnection::handleClose()
+{
+  loop_->assertInLoopThread();
+  LOG_TRACE << "fd = " << channel_->fd() << " state = " << stateToString();
+  assert(state_ == kConnected || state_ == kDisconnecting);
+  // we don't close fd, leave it to dtor, so we can find leaks easily.
+  setState(kDisconnected);
+  channel_->disableAll();
+  if (proactor_)
+  {
+    cancelProactorOps();
+  }
+  removeTimeouts();
+
+  TcpConnectionPtr guardThis(shared_from_this());
+  connectionCallback_(guardThis);
+  // must be the last line
   closeCallback_(guardThis);
 }
 
 void TcpConnection::handleError()
 {
+  const bool zeroCopyPending = !zeroCopyPins_.empty();
+  if (zeroCopyPending)
+  {
+    // zerocopy的完成通知也是通过POLLERR报告的，不一定是出错了
+    handleZeroCopyCompletions();
+  }
   int err = sockets::getSocketError(channel_->fd());
+  if (zeroCopyPending && err == 0)
+  {
+    return;
+  }
   LOG_ERROR << "TcpConnection::handleError [" << name_ << "] - SO_ERROR = " << err << " " << strerror_tl(err);
 }
+
+bool TcpConnection::setZeroCopy(bool on, size_t threshold)
+{
+  loop_->assertInLoopThread();
+  if (on && proactor_)
+  {
+    LOG_ERROR << "TcpConnection::setZeroCopy [" << name_ << "] - not available in proactor mode";
+    return false;
+  }
+  if (on && !socket_->setZeroCopy(true))
+  {
+    return false;
+  }
+  // 关闭时不清SO_ZEROCOPY，还没完成的通知照样处理
+  zeroCopyThreshold_ = on ? std::max<size_t>(threshold, 1) : 0;
+  return true;
+}
+
+void TcpConnection::pinZeroCopy(const SharedPayload &payload)
+{
+  zeroCopyPins_.push_back(std::make_pair(zeroCopySeq_, payload));
+  ++zeroCopySeq_;
+}
+
+void TcpConnection::handleZeroCopyCompletions()
+{
+  uint32_t lo = 0;
+  uint32_t hi = 0;
+  bool copied = false;
+  while (sockets::readZeroCopyCompletion(channel_->fd(), &lo, &hi, &copied))
+  {
+    // TCP的完成通知是按序的，[lo, hi]以前的发送都已完成
+    while (!zeroCopyPins_.empty() && static_cast<int32_t>(zeroCopyPins_.front().first - hi) <= 0)
+    {
+      zeroCopyPins_.pop_front();
+    }
+    if (copied && zeroCopyThreshold_ > 0)
+    {
+      // 比如loopback或者网卡不支持scatter-gather，内核还是拷贝了，zerocopy只有额外开销
+      LOG_DEBUG << "TcpConnection::handleZeroCopyCompletions [" << name_ << "] - kernel copied, zerocopy disabled";
+      zeroCopyThreshold_ = 0;
+    }
+  }
+}
+
+bool TcpConnection::startProactor()
+{
+  IoUringPoller *poller = loop_->ioUringPoller();
+  if (poller == NULL || !poller->enableProactor())
+  {
+    LOG_WARN << "TcpConnection::startProactor [" << name_ << "] - io_uring is not available, fall back to reactor";
+    return false;
+  }
+  proactor_.reset(new ProactorIo(poller));
+  proactor_->id = poller->addCompletionHandler(std::bind(&TcpConnection::handleCompletion, shared_from_this(), _1));
+  proactor_->registered = true;
+  // 要注册到poller，connectDestroyed才能remove，但不关注任何事件，收发都靠完成事件
+  channel_->disableAll();
+  armRecv();
+  return true;
+}
+
+void TcpConnection::armRecv()
+{
+  ProactorIo *io = get_pointer(proactor_);
+  if (io->recvArmed || !reading_ || state_ == kDisconnected)
+  {
+    return;
+  }
+  // 不指定缓冲区，内核从provided buffer ring里挑一个
+  struct io_uring_sqe *sqe = io->poller->prepareOp(io->id, kRecvOp);
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = channel_->fd();
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = IoUringPoller::kBufferGroup;
+  if (io->poller->multishotRecv())
+  {
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+  }
+  io->recvArmed = true;
+}
+
+void TcpConnection::scheduleSend()
+{
+  ProactorIo *io = get_pointer(proactor_);
+  if (!io->sending && !io->sendQueued)
+  {
+    if (timeouts_)
+    {
+      // 写超时从有数据要发开始算
+      timeouts_->lastWrite = loop_->pollReturnTime();
+    }
+    // 这一轮的send都攒在outputBuffer_里，最后提交一个SENDMSG
+    io->sendQueued = true;
+    loop_->queueFlush(std::bind(&TcpConnection::submitSend, shared_from_this()));
+  }
+}
+
+void TcpConnection::submitSend()
+{
+  ProactorIo *io = get_pointer(proactor_);
+  io->sendQueued = false;
+  if (io->sending || state_ == kDisconnected || outputBuffer_.readableBytes() == 0)
+  {
+    return;
+  }
+  // 发送完成之前不retrieve，block的内存不会动
+  const int iovcnt = outputBuffer_.peekIovec(io->iov, ChainBuffer::kMaxIovec);
+  io->sendOp = iovcnt > 0 ? kSendOp : kWritableOp;
+  struct io_uring_sqe *sqe = io->poller->prepareOp(io->id, io->sendOp);
+  sqe->fd = channel_->fd();
+  if (iovcnt > 0)
+  {
+    io->msg.msg_iov = io->iov;
+    io->msg.msg_iovlen = iovcnt;
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->addr = reinterpret_cast<uintptr_t>(&io->msg);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+  }
+  else
+  {
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->poll32_events = POLLOUT;
+  }
+  io->sending = true;
+}
+
+void TcpConnection::cancelProactorOps()
+{
+  ProactorIo *io = get_pointer(proactor_);
+  if (io->recvArmed)
+  {
+    io->poller->cancelOp(io->id, kRecvOp);
+  }
+  if (io->sending)
+  {
+    io->poller->cancelOp(io->id, io->sendOp);
+  }
+}
+
+void TcpConnection::handleCompletion(const struct io_uring_cqe &cqe)
+{
+  switch (IoUringPoller::opOf(cqe))
+  {
+    case kRecvOp:
+      handleRecvCompletion(cqe);
+      break;
+    case kSendOp:
+    case kWritableOp:
+      handleSendCompletion(cqe);
+      break;
+    default:
+      LOG_ERROR << "TcpConnection::handleCompletion [" << name_ << "] - unexpected op " << IoUringPoller::opOf(cqe);
+      break;
+  }
+  releaseProactor();
+}
+
+void TcpConnection::releaseProactor()
+{
+  ProactorIo *io = get_pointer(proactor_);
+  if (io->registered && state_ == kDisconnected && !io->recvArmed && !io->sending)
+  {
+    // 内核不再引用这个连接了，handler里的引用可能是最后一个，
+    // dispatchCompletions里调用的是handler的拷贝，所以这里析构不了
+    io->registered = false;
+    io->poller->removeCompletionHandler(io->id);
+  }
+}
+
+void TcpConnection::handleRecvCompletion(const struct io_uring_cqe &cqe)
+{
+  ProactorIo *io = get_pointer(proactor_);
+  if (!(cqe.flags & IORING_CQE_F_MORE))
+  {
+    io->recvArmed = false;
+  }
+  const bool live = state_ == kConnected || state_ == kDisconnecting;
+  if (cqe.res > 0)
+  {
+    if (live)
+    {
+      // 拷到inputBuffer_，MessageCallback拿到的还是Buffer*
+      inputBuffer_.append(io->poller->providedBuffer(cqe), static_cast<size_t>(cqe.res));
+    }
+    io->poller->recycleBuffer(cqe);
+    if (live)
+    {
+      const Timestamp receiveTime = loop_->pollReturnTime();
+      if (timeouts_)
+      {
+        timeouts_->lastRead = receiveTime;
+      }
+      messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+      if (idleBufferRelease_ >= 0)
+      {
+        bufferActivity(receiveTime);
+      }
+    }
+  }
+  else if (cqe.res == 0)
+  {
+    if (live)
+    {
+      handleClose();
+    }
+  }
+  else if (cqe.res == -ENOBUFS)
+  {
+    // provided buffer都在用，这一批完成事件处理完就还回去了，下面重新挂上
+    LOG_DEBUG << "TcpConnection::handleRecvCompletion [" << name_ << "] - out of provided buffers";
+  }
+  else if (cqe.res == -EINVAL && io->poller->multishotRecv())
+  {
+    // 内核不支持multishot recv，以后每次收一个
+    LOG_WARN << "TcpConnection::handleRecvCompletion - multishot recv is not supported";
+    io->poller->disableMultishotRecv();
+  }
+  else if (cqe.res != -ECANCELED)
+  {
+    errno = -cqe.res;
+    LOG_SYSERR << "TcpConnection::handleRecvCompletion [" << name_ << "]";
+    if (live)
+    {
+      handleClose();
+    }
+  }
+  if (!io->recvArmed && (state_ == kConnected || state_ == kDisconnecting))
+  {
+    armRecv();
+  }
+}
+
+void TcpConnection::handleSendCompletion(const struct io_uring_cqe &cqe)
+{
+  ProactorIo *io = get_pointer(proactor_);
+  io->sending = false;
+  ssize_t n = cqe.res;
+  if (IoUringPoller::opOf(cqe) == kWritableOp)
+  {
+    if (n >= 0 && state_ != kDisconnected)
+    {
+      // 可写了，最前面的文件区间用sendfile发
+      int savedErrno = 0;
+      n = outputBuffer_.writeFd(channel_->fd(), &savedErrno);
+      if (n < 0)
+      {
+        n = -savedErrno;
+      }
+    }
+  }
+  else if (n > 0)
+  {
+    outputBuffer_.retrieve(static_cast<size_t>(n));
+  }
+
+  if (n > 0)
+  {
+    if (timeouts_)
+    {
+      timeouts_->lastWrite = loop_->pollReturnTime();
+    }
+    if (idleBufferRelease_ >= 0)
+    {
+      bufferActivity(loop_->pollReturnTime());
+    }
+    if (outputBuffer_.readableBytes() == 0)
+    {
+      if (writeCompleteCallback_)
+      {
+        loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+      }
+      if (state_ == kDisconnecting)
+      {
+        shutdownInLoop();
+      }
+      return;
+    }
+  }
+  else if (n == -ECANCELED || state_ == kDisconnected)
+  {
+    return;
+  }
+  else if (n != -EAGAIN)
+  {
+    errno = static_cast<int>(-n);
+    LOG_SYSERR << "TcpConnection::handleSendCompletion [" << name_ << "]";
+    if (n == -EIO)
+    {
+      // 文件被截断了，后面的数据对不上，只能断开
+      forceCloseInLoop();
+    }
+    return;
+  }
+  submitSend();
+}
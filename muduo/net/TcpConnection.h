@@ -6,14 +6,21 @@
 #include "muduo/base/noncopyable.h"
 #include "muduo/net/Buffer.h"
 #include "muduo/net/Callbacks.h"
+#include "muduo/net/ChainBuffer.h"
 #include "muduo/net/InetAddress.h"
+#include "muduo/net/SharedPayload.h"
 
+#include <deque>
 #include <memory>
+#include <utility>
 
 #include <boost/any.hpp>
 
+#include <sys/types.h>
+
 // struct tcp_info is in <netinet/tcp.h>
 struct tcp_info;
+struct io_uring_cqe;
 
 namespace muduo
 {
@@ -49,18 +56,49 @@ class TcpConnection : noncopyable, public std::enable_shared_from_this<TcpConnec
   // void send(string&& message); // C++11
   void send(const void *message, int len);
   void send(const StringPiece &message);
+  // the payload is queued by reference, never copied
+  void send(const SharedPayload &payload);
   // void send(Buffer&& message); // C++11
   void send(Buffer *message);  // this one will swap data
+  // sends length bytes of file fd from offset with sendfile(2), in order with other sends,
+  // fd is dup(2)ed so it can be closed right away
+  void sendFile(int fd, off_t offset, size_t length);
   void shutdown();             // NOT thread safe, no simultaneous calling
   // void shutdownAndForceCloseAfter(double seconds); // NOT thread safe, no simultaneous calling
   void forceClose();
   void forceCloseWithDelay(double seconds);
   void setTcpNoDelay(bool on);
+  /// Sends SharedPayloads of at least @c threshold bytes with MSG_ZEROCOPY,
+  /// each one stays referenced until its completion is read from the error queue.
+  /// Smaller sends use plain writes, and so does everything once the kernel reports it copied anyway.
+  /// Must be called in the loop thread.
+  /// @return false if SO_ZEROCOPY is not supported
+  bool setZeroCopy(bool on, size_t threshold = 64 * 1024);
+  /// Gathers all sends made during one loop iteration and flushes them with a single writev(2)
+  /// after the pending functors, counted by EventLoop::coalescedSends/coalescedFlushes.
+  /// NOT thread safe, call it in the loop thread or before connectEstablished().
+  void setWriteCoalescing(bool on) { writeCoalescing_ = on; }
+  /// Completion-based I/O on the loop's io_uring (MUDUO_USE_IOURING):
+  /// recv and send are submitted to the ring, received bytes land in provided buffers,
+  /// and are copied into the input buffer before MessageCallback, so the callbacks work as usual.
+  /// Falls back to the reactor if the loop or the kernel can't.
+  /// spliceTo and setZeroCopy are not available in this mode.
+  /// Must be called before connectEstablished().
+  void setProactor(bool on) { proactorRequested_ = on; }
+  bool isProactor() const { return proactor_ != NULL; }
   // reading or not
   void startRead();
   void stopRead();
   bool isReading() const { return reading_; };  // NOT thread safe, may race with start/stopReadInLoop
 
+  /// Forwards everything read from now on to peer through a pipe with splice(2),
+  /// the bytes never enter user space and MessageCallback is no longer called.
+  /// Reading stops while the pipe holds bytes peer can't take, and resumes once it drains.
+  /// Both connections must belong to the same loop, call it in that loop.
+  /// For a two-way tunnel call it on both connections.
+  /// @return false if the pipe can't be created
+  bool spliceTo(const TcpConnectionPtr &peer);
+
   void setContext(const boost::any &context) { context_ = context; }
 
   const boost::any &getContext() const { return context_; }
@@ -79,10 +117,30 @@ class TcpConnection : noncopyable, public std::enable_shared_from_this<TcpConnec
     highWaterMark_ = highWaterMark;
   }
 
+  /// Gives the buffer memory back while the connection is idle.
+  /// Buffers hold no memory from connectEstablished() until data arrives,
+  /// with 0 they are released as soon as they drain, otherwise after
+  /// @c seconds without I/O, when an input buffer holding part of a message
+  /// is also shrunk if it is much bigger than that. Negative (the default) disables it.
+  /// Must be called before connectEstablished().
+  void setIdleBufferRelease(double seconds) { idleBufferRelease_ = seconds; }
+
+  /// Closes the connection with forceClose() after @c idleSeconds without receiving or sending,
+  /// after @c readSeconds without receiving, or after @c writeSeconds with output pending
+  /// and none of it taken by the peer. 0 disables each one.
+  /// The deadlines live in a TimeoutWheel of the loop, whose tick is at most 1/8 of the shortest timeout
+  /// (see EventLoop::timeoutWheel), connections with a shorter timeout get a finer wheel.
+  /// I/O only stores a timestamp and the deadline is checked again when it comes.
+  /// Must be called before connectEstablished().
+  void setTimeouts(double idleSeconds, double readSeconds, double writeSeconds);
+
   /// Advanced interface
   Buffer *inputBuffer() { return &inputBuffer_; }
 
-  Buffer *outputBuffer() { return &outputBuffer_; }
+  /// Incompatible with older muduo, which returned Buffer*:
+  /// the output is a chain of blocks, so there is no contiguous peek() or prepend().
+  /// Use readableBytes(), peekIovec() or append() instead.
+  ChainBuffer *outputBuffer() { return &outputBuffer_; }
 
   /// Internal use only.
   void setCloseCallback(const CloseCallback &cb) { closeCallback_ = cb; }
@@ -100,13 +158,30 @@ class TcpConnection : noncopyable, public std::enable_shared_from_this<TcpConnec
     kConnected,
     kDisconnecting
   };
+  struct SplicePipe;
+  struct ProactorIo;
+  struct Timeouts;
+
   void handleRead(Timestamp receiveTime);
+  void handleSpliceRead();
+  void flushSplice();
   void handleWrite();
+  void writeOutput();
+  void coalesceWrite();
+  void flushCoalesced();
   void handleClose();
   void handleError();
   // void sendInLoop(string&& message);
   void sendInLoop(const StringPiece &message);
   void sendInLoop(const void *message, size_t len);
+  void sendPayloadInLoop(const SharedPayload &payload);
+  void sendFileInLoop(int fd, off_t offset, size_t length);
+  void sendDupFileInLoop(int dupFd, off_t offset, size_t length);
+  bool handleWriteError(const char *where);
+  size_t writeDirectly(const void *data, size_t len, bool *faultError, const SharedPayload *zeroCopy = NULL);
+  void pinZeroCopy(const SharedPayload &payload);
+  void handleZeroCopyCompletions();
+  void checkHighWaterMark(size_t remaining);
   void shutdownInLoop();
   // void shutdownAndForceCloseInLoop(double seconds);
   void forceCloseInLoop();
@@ -114,6 +189,23 @@ class TcpConnection : noncopyable, public std::enable_shared_from_this<TcpConnec
   const char *stateToString() const;
   void startReadInLoop();
   void stopReadInLoop();
+  void bufferActivity(Timestamp now);
+  void checkIdleBuffers();
+  void releaseDrainedBuffers();
+  void releaseIdleBuffers();
+  void handleTimeout(Timestamp now);
+  bool isWritePending() const;
+  void startWriteTimeout();
+  void removeTimeouts();
+  bool startProactor();
+  void armRecv();
+  void scheduleSend();
+  void submitSend();
+  void cancelProactorOps();
+  void releaseProactor();
+  void handleCompletion(const struct io_uring_cqe &cqe);
+  void handleRecvCompletion(const struct io_uring_cqe &cqe);
+  void handleSendCompletion(const struct io_uring_cqe &cqe);
 
   EventLoop *loop_;    // 分配的loop
   const string name_;  // 连接名
@@ -131,8 +223,22 @@ class TcpConnection : noncopyable, public std::enable_shared_from_this<TcpConnec
   CloseCallback closeCallback_;                  // 连接关闭回调
   size_t highWaterMark_;                         // 缓冲区高水位大小
   Buffer inputBuffer_;                           // 应用层输入缓冲区
-  Buffer outputBuffer_;                          // FIXME: use list<Buffer> as output buffer.
+  ChainBuffer outputBuffer_;                     // 应用层输出缓冲区，由多个block串成
   boost::any context_;                           // 上下文
+  double idleBufferRelease_;                     // 空闲多久释放缓冲区内存，负数表示不释放
+  Timestamp lastBufferActivity_;                 // 最后一次读写的时间
+  bool idleBufferTimerArmed_;                    // 是否有定时器在检查空闲
+  std::shared_ptr<SplicePipe> spliceOut_;        // 读到的数据经过这个管道转发给splicePeer_
+  std::weak_ptr<TcpConnection> splicePeer_;
+  std::shared_ptr<SplicePipe> spliceIn_;         // 别的连接转发过来、等着写出去的数据
+  size_t zeroCopyThreshold_;                     // 0表示不用MSG_ZEROCOPY
+  uint32_t zeroCopySeq_;                         // 下一次zerocopy发送的序号，和内核的计数一致
+  std::deque<std::pair<uint32_t, SharedPayload>> zeroCopyPins_;  // 内核还在引用的payload
+  bool writeCoalescing_;                         // send只追加到outputBuffer_，每轮loop最后flush一次
+  bool coalescedFlushQueued_;
+  bool proactorRequested_;
+  std::unique_ptr<ProactorIo> proactor_;         // 不为空表示收发走io_uring的完成事件
+  std::unique_ptr<Timeouts> timeouts_;           // 不为空表示有空闲/读/写超时
   // FIXME: creationTime_, lastReceiveTime_
   //        bytesReceived_, bytesSent_
 };
@@ -11,6 +11,18 @@
 using namespace muduo;
 using namespace muduo::net;
 
+namespace
+{
+void sendToConnections(const std::vector<TcpConnectionPtr> &conns, const SharedPayload &payload)
+{
+  for (const TcpConnectionPtr &conn : conns)
+  {
+    conn->send(payload);
+  }
+}
+
+}  // namespace
+
 TcpServer::TcpServer(EventLoop *loop, const InetAddress &listenAddr, const string &nameArg, Option option)
     : loop_(CHECK_NOTNULL(loop)),
       ipPort_(listenAddr.toIpPort()),
@@ -19,6 +31,13 @@ TcpServer::TcpServer(EventLoop *loop, const InetAddress &listenAddr, const strin
       threadPool_(new EventLoopThreadPool(loop, name_)),
       connectionCallback_(defaultConnectionCallback),
       messageCallback_(defaultMessageCallback),
+      bufferPoolBytes_(0),
+      idleBufferRelease_(-1.0),
+      writeCoalescing_(false),
+      proactor_(false),
+      idleTimeout_(0.0),
+      readTimeout_(0.0),
+      writeTimeout_(0.0),
       nextConnId_(1)
 {
   acceptor_->setNewConnectionCallback(std::bind(&TcpServer::newConnection, this, _1, _2));
@@ -48,13 +67,26 @@ void TcpServer::start()
 {
   if (started_.getAndSet(1) == 0)
   {
-    threadPool_->start(threadInitCallback_);
+    threadPool_->start(std::bind(&TcpServer::initIoLoop, this, _1));
 
     assert(!acceptor_->listening());
     loop_->runInLoop(std::bind(&Acceptor::listen, get_pointer(acceptor_)));
   }
 }
 
+void TcpServer::initIoLoop(EventLoop *ioLoop)
+{
+  // 在ioLoop开始loop之前启用pool，之后newConnection读bufferPool()不会有race condition
+  if (bufferPoolBytes_ > 0)
+  {
+    ioLoop->enableBufferPool(bufferPoolBytes_);
+  }
+  if (threadInitCallback_)
+  {
+    threadInitCallback_(ioLoop);
+  }
+}
+
 void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
 {
   loop_->assertInLoopThread();
@@ -74,6 +106,10 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
   conn->setConnectionCallback(connectionCallback_);
   conn->setMessageCallback(messageCallback_);
   conn->setWriteCompleteCallback(writeCompleteCallback_);
+  conn->setIdleBufferRelease(idleBufferRelease_);
+  conn->setWriteCoalescing(writeCoalescing_);
+  conn->setProactor(proactor_);
+  conn->setTimeouts(idleTimeout_, readTimeout_, writeTimeout_);
   // TcpConnection被关闭的时候会回调这个函数，用的是shared_from_this()的引用
   // TcpServer和TcpConnection是在不同的线程上，TcpServer如果先析构了，this指针就不安全了
   conn->setCloseCallback(std::bind(&TcpServer::removeConnection, this, _1));  // FIXME: unsafe
@@ -100,3 +136,23 @@ void TcpServer::removeConnectionInLoop(const TcpConnectionPtr &conn)
   EventLoop *ioLoop = conn->getLoop();
   ioLoop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
 }
+
+void TcpServer::broadcast(const SharedPayload &payload)
+{
+  loop_->runInLoop(std::bind(&TcpServer::broadcastInLoop, this, payload));
+}
+
+void TcpServer::broadcastInLoop(const SharedPayload &payload)
+{
+  loop_->assertInLoopThread();
+  // 按ioLoop把连接分组，每个ioLoop只投递一个functor，而不是每个连接一个
+  std::map<EventLoop *, std::vector<TcpConnectionPtr>> connsByLoop;
+  for (const auto &item : connections_)
+  {
+    connsByLoop[item.second->getLoop()].push_back(item.second);
+  }
+  for (auto &item : connsByLoop)
+  {
+    item.first->runInLoop(std::bind(sendToConnections, std::move(item.second), payload));
+  }
+}
@@ -49,6 +49,25 @@ class TcpServer : noncopyable
   ///   are assigned on a round-robin basis.
   void setThreadNum(int numThreads);
   void setThreadInitCallback(const ThreadInitCallback &cb) { threadInitCallback_ = cb; }
+  /// Enables the loop-local BufferPool of every I/O loop.
+  /// Must be called before @c start
+  void enableBufferPool(size_t maxCachedBytes = BufferPool::kDefaultMaxCachedBytes) { bufferPoolBytes_ = maxCachedBytes; }
+  /// See TcpConnection::setIdleBufferRelease.
+  /// Not thread safe, affects connections accepted afterwards.
+  void setIdleBufferRelease(double seconds) { idleBufferRelease_ = seconds; }
+  /// See TcpConnection::setWriteCoalescing.
+  /// Not thread safe, affects connections accepted afterwards.
+  void setWriteCoalescing(bool on) { writeCoalescing_ = on; }
+  /// Closes connections idle, not receiving, or stuck writing for that many seconds,
+  /// see TcpConnection::setTimeouts. 0 (the default) disables each one.
+  /// Each I/O loop keeps the deadlines in TimeoutWheels, one per tick, shared by all servers on it.
+  /// Not thread safe, affects connections accepted afterwards.
+  void setIdleTimeout(double seconds) { idleTimeout_ = seconds; }
+  void setReadTimeout(double seconds) { readTimeout_ = seconds; }
+  void setWriteTimeout(double seconds) { writeTimeout_ = seconds; }
+  /// See TcpConnection::setProactor.
+  /// Not thread safe, affects connections accepted afterwards.
+  void setProactor(bool on) { proactor_ = on; }
   /// valid after calling start()
   std::shared_ptr<EventLoopThreadPool> threadPool() { return threadPool_; }
 
@@ -70,6 +89,11 @@ class TcpServer : noncopyable
   /// Not thread safe.
   void setWriteCompleteCallback(const WriteCompleteCallback &cb) { writeCompleteCallback_ = cb; }
 
+  /// Sends payload to every connected connection, without copying it.
+  /// Each I/O loop gets one functor for all its connections.
+  /// Thread safe.
+  void broadcast(const SharedPayload &payload);
+
  private:
   /// Not thread safe, but in loop
   void newConnection(int sockfd, const InetAddress &peerAddr);
@@ -77,6 +101,10 @@ class TcpServer : noncopyable
   void removeConnection(const TcpConnectionPtr &conn);
   /// Not thread safe, but in loop
   void removeConnectionInLoop(const TcpConnectionPtr &conn);
+  /// Not thread safe, but in loop
+  void broadcastInLoop(const SharedPayload &payload);
+  /// Called in each I/O loop thread before it loops
+  void initIoLoop(EventLoop *ioLoop);
 
   typedef std::map<string, TcpConnectionPtr> ConnectionMap;
 
@@ -89,6 +117,13 @@ class TcpServer : noncopyable
   MessageCallback messageCallback_;              // 消息到达回调
   WriteCompleteCallback writeCompleteCallback_;  // 数据可写回调
   ThreadInitCallback threadInitCallback_;
+  size_t bufferPoolBytes_;    // 0 means no BufferPool
+  double idleBufferRelease_;  // negative means never release
+  bool writeCoalescing_;
+  bool proactor_;
+  double idleTimeout_;   // 0表示不检查
+  double readTimeout_;
+  double writeTimeout_;
   AtomicInt32 started_;  // 启动了多少次
   // always in loop thread
   int nextConnId_;             // 连接数，自增
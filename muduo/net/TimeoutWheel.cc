@@ -0,0 +1,148 @@
+#include "muduo/net/TimeoutWheel.h"
+#include "muduo/net/EventLoop.h"
+
+#include <algorithm>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+int64_t roundUpPowerOfTwo(int n)
+{
+  int64_t result = 1;
+  while (result < n)
+  {
+    result <<= 1;
+  }
+  return result;
+}
+
+}  // namespace
+
+TimeoutWheel::TimeoutWheel(EventLoop *loop, double tickSeconds, int buckets)
+    : loop_(loop),
+      tickMicroseconds_(std::max(static_cast<int64_t>(1), static_cast<int64_t>(tickSeconds * Timestamp::kMicroSecondsPerSecond))),
+      mask_(roundUpPowerOfTwo(buckets) - 1),
+      currentTick_(0),
+      size_(0),
+      expiredCount_(0),
+      timerRunning_(false)
+{
+  buckets_.resize(static_cast<size_t>(mask_ + 1));
+  for (Link &head : buckets_)
+  {
+    head.prev = head.next = &head;
+  }
+}
+
+TimeoutWheel::~TimeoutWheel()
+{
+  // 主人还在的entry不再挂在轮子上
+  for (Link &head : buckets_)
+  {
+    while (head.next != &head)
+    {
+      unlink(static_cast<Entry *>(head.next));
+    }
+  }
+  if (timerRunning_)
+  {
+    loop_->cancel(timer_);
+  }
+}
+
+void TimeoutWheel::schedule(Entry *entry, Timestamp deadline)
+{
+  loop_->assertInLoopThread();
+  if (entry->scheduled())
+  {
+    unlink(entry);
+  }
+  else
+  {
+    if (size_ == 0 && !timerRunning_)
+    {
+      // 停了一段时间，从现在开始转
+      currentTick_ = Timestamp::now().microSecondsSinceEpoch() / tickMicroseconds_;
+      timerRunning_ = true;
+      // 轮子本来就是粗粒度的，和别的timer一起醒来
+      timer_ = loop_->runEvery(tickSeconds(), std::bind(&TimeoutWheel::onTick, this), tickSeconds() / 2);
+    }
+    ++size_;
+  }
+  // 向上取整，不会提前到期；已经过了的放到下一个要处理的bucket
+  entry->tick_ = std::max((deadline.microSecondsSinceEpoch() + tickMicroseconds_ - 1) / tickMicroseconds_, currentTick_);
+  link(&buckets_[static_cast<size_t>(entry->tick_ & mask_)], entry);
+}
+
+void TimeoutWheel::remove(Entry *entry)
+{
+  loop_->assertInLoopThread();
+  if (entry->scheduled())
+  {
+    unlink(entry);
+    --size_;
+  }
+}
+
+void TimeoutWheel::link(Link *head, Entry *entry)
+{
+  entry->prev = head->prev;
+  entry->next = head;
+  head->prev->next = entry;
+  head->prev = entry;
+}
+
+void TimeoutWheel::unlink(Entry *entry)
+{
+  entry->prev->next = entry->next;
+  entry->next->prev = entry->prev;
+  entry->prev = entry->next = NULL;
+}
+
+void TimeoutWheel::onTick()
+{
+  const Timestamp now(Timestamp::now());
+  const int64_t target = now.microSecondsSinceEpoch() / tickMicroseconds_;
+  // 落后超过一圈的话，每个bucket也只看一次
+  for (int64_t tick = std::max(currentTick_, target - mask_); tick <= target; ++tick)
+  {
+    // 先把整个bucket摘下来，回调里schedule和remove别的entry都不影响遍历
+    Link &head = buckets_[static_cast<size_t>(tick & mask_)];
+    if (head.next == &head)
+    {
+      continue;
+    }
+    Link pending;
+    pending.prev = head.prev;
+    pending.next = head.next;
+    pending.prev->next = &pending;
+    pending.next->prev = &pending;
+    head.prev = head.next = &head;
+
+    while (pending.next != &pending)
+    {
+      Entry *entry = static_cast<Entry *>(pending.next);
+      unlink(entry);
+      if (entry->tick_ <= target)
+      {
+        --size_;
+        ++expiredCount_;
+        entry->callback_(now);
+      }
+      else
+      {
+        // 要再转几圈
+        link(&head, entry);
+      }
+    }
+  }
+  currentTick_ = target + 1;
+
+  if (size_ == 0)
+  {
+    timerRunning_ = false;
+    loop_->cancel(timer_);
+  }
+}
@@ -0,0 +1,91 @@
+#ifndef MUDUO_NET_TIMEOUTWHEEL_H
+#define MUDUO_NET_TIMEOUTWHEEL_H
+
+#include "muduo/base/Timestamp.h"
+#include "muduo/base/noncopyable.h"
+#include "muduo/net/TimerId.h"
+
+#include <functional>
+#include <vector>
+
+#include <assert.h>
+
+namespace muduo
+{
+namespace net
+{
+class EventLoop;
+
+///
+/// Coarse timeouts for many objects of one loop, eg. idle connections.
+///
+/// Entries hang in a ring of buckets, one bucket per tick, and the wheel
+/// runs a single repeating timer while it has entries, instead of one timer each.
+/// Scheduling and removing are O(1) list operations and never allocate,
+/// the entries belong to their owners.
+/// Deadlines are rounded up to ticks, so an entry expires up to one tick late but never early.
+/// Deadlines farther than one turn wait in their bucket for later turns.
+///
+/// Loop thread only.
+///
+class TimeoutWheel : noncopyable
+{
+ private:
+  struct Link
+  {
+    Link *prev;
+    Link *next;
+  };
+
+ public:
+  typedef std::function<void(Timestamp)> ExpireCallback;
+
+  class Entry : private Link, noncopyable
+  {
+   public:
+    /// @c cb is called with the wheel's time when the deadline passes,
+    /// the entry is no longer scheduled by then.
+    explicit Entry(ExpireCallback cb) : tick_(0), callback_(std::move(cb)) { prev = next = NULL; }
+    ~Entry() { assert(!scheduled()); }
+
+    bool scheduled() const { return prev != NULL; }
+
+   private:
+    friend class TimeoutWheel;
+    int64_t tick_;  // 到期的tick，向上取整
+    ExpireCallback callback_;
+  };
+
+  /// @c buckets is rounded up to a power of two.
+  TimeoutWheel(EventLoop *loop, double tickSeconds, int buckets = 512);
+  ~TimeoutWheel();
+
+  /// (Re)schedules @c entry to expire at @c deadline.
+  void schedule(Entry *entry, Timestamp deadline);
+  /// Harmless if @c entry is not scheduled.
+  void remove(Entry *entry);
+
+  double tickSeconds() const { return static_cast<double>(tickMicroseconds_) / Timestamp::kMicroSecondsPerSecond; }
+  size_t size() const { return size_; }
+  int64_t expiredCount() const { return expiredCount_; }
+
+ private:
+  static void link(Link *head, Entry *entry);
+  static void unlink(Entry *entry);
+  void onTick();
+
+  EventLoop *loop_;
+  const int64_t tickMicroseconds_;
+  const int64_t mask_;
+  int64_t currentTick_;  // 下一个要处理的tick
+  size_t size_;
+  int64_t expiredCount_;
+  std::vector<Link> buckets_;  // 每个bucket是一个带头结点的双向循环链表
+  TimerId timer_;
+  bool timerRunning_;  // 没有entry的时候不让loop醒来
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_TIMEOUTWHEEL_H
@@ -16,3 +16,13 @@ void Timer::restart(Timestamp now)
     expiration_ = Timestamp::invalid();
   }
 }
+
+void Timer::reset(TimerCallback cb, Timestamp when, double interval, double slack)
+{
+  callback_ = std::move(cb);
+  expiration_ = when;
+  interval_ = interval;
+  slack_ = slack;
+  repeat_ = interval > 0.0;
+  sequence_ = s_numCreated_.incrementAndGet();
+}
@@ -15,27 +15,40 @@ namespace net
 class Timer : noncopyable
 {
  public:
-  Timer(TimerCallback cb, Timestamp when, double interval)
-      : callback_(std::move(cb)), expiration_(when), interval_(interval), repeat_(interval > 0.0), sequence_(s_numCreated_.incrementAndGet())
+  Timer(TimerCallback cb, Timestamp when, double interval, double slack = 0.0)
+      : callback_(std::move(cb)),
+        expiration_(when),
+        interval_(interval),
+        slack_(slack),
+        repeat_(interval > 0.0),
+        sequence_(s_numCreated_.incrementAndGet())
   {
   }
 
   void run() const { callback_(); }
 
   Timestamp expiration() const { return expiration_; }
+  /// Latest acceptable run time, the queue may delay the timer until then
+  /// to run it together with others.
+  Timestamp latest() const { return slack_ > 0.0 ? addTime(expiration_, slack_) : expiration_; }
   bool repeat() const { return repeat_; }
   int64_t sequence() const { return sequence_; }
 
   void restart(Timestamp now);
 
+  /// Reuses this Timer for another callback, it gets a new sequence
+  /// so TimerIds of the previous use no longer match.
+  void reset(TimerCallback cb, Timestamp when, double interval, double slack = 0.0);
+
   static int64_t numCreated() { return s_numCreated_.get(); }
 
  private:
-  const TimerCallback callback_;  // 回调函数
-  Timestamp expiration_;          // 超时时间戳
-  const double interval_;         // 定时器间隔
-  const bool repeat_;             // 是否重复
-  const int64_t sequence_;        // 定时器的序列号
+  TimerCallback callback_;  // 回调函数
+  Timestamp expiration_;    // 超时时间戳
+  double interval_;         // 定时器间隔
+  double slack_;            // 允许推迟的秒数
+  bool repeat_;             // 是否重复
+  int64_t sequence_;        // 定时器的序列号
 
   static AtomicInt64 s_numCreated_;  // 用于生成定时器的序列号，自增
 };
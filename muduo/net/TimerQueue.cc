@@ -1,12 +1,6 @@
-#ifndef __STDC_LIMIT_MACROS
-#define __STDC_LIMIT_MACROS
-#endif
-
 #include "muduo/net/TimerQueue.h"
 #include "muduo/base/Logging.h"
 #include "muduo/net/EventLoop.h"
-#include "muduo/net/Timer.h"
-#include "muduo/net/TimerId.h"
 
 #include <sys/timerfd.h>
 #include <unistd.h>
@@ -74,9 +68,9 @@ void resetTimerfd(int timerfd, Timestamp expiration)
 
 using namespace muduo;
 using namespace muduo::net;
-using namespace muduo::net::detail;
 
-TimerQueue::TimerQueue(EventLoop *loop) : loop_(loop), timerfd_(createTimerfd()), timerfdChannel_(loop, timerfd_), timers_(), callingExpiredTimers_(false)
+TimerQueue::TimerQueue(EventLoop *loop)
+    : loop_(loop), timerfd_(detail::createTimerfd()), timerfdChannel_(loop, timerfd_), timerfdResets_(0), timerfdResetsSaved_(0)
 {
   // time channel的可读回调函数设置为当前TimeQueue的成员函数
   // 由于time channel是TimeQueue的成员，一定是channel先析构，然后TimeQueue再析构
@@ -90,171 +84,31 @@ TimerQueue::~TimerQueue()
   timerfdChannel_.disableAll();
   timerfdChannel_.remove();
   ::close(timerfd_);
-  // do not remove channel, since we're in EventLoop::dtor();
-  for (const Entry &timer : timers_)
-  {
-    delete timer.second;
-  }
-}
-
-TimerId TimerQueue::addTimer(TimerCallback cb, Timestamp when, double interval)
-{
-  Timer *timer = new Timer(std::move(cb), when, interval);
-  // runInLoop是线程安全的，addTimer如果被其他线程调用，那么会queueInLoop
-  // 后续运行addTimerLoop的线程一定是TimerQueue归属的EventLoop
-  loop_->runInLoop(std::bind(&TimerQueue::addTimerInLoop, this, timer));
-  return TimerId(timer, timer->sequence());
-}
-
-void TimerQueue::cancel(TimerId timerId)
-{
-  // 线程安全
-  loop_->runInLoop(std::bind(&TimerQueue::cancelInLoop, this, timerId));
-}
-
-void TimerQueue::addTimerInLoop(Timer *timer)
-{
-  loop_->assertInLoopThread();
-  // timer会插入到std::set里面
-  // 如果timer比原来std::set的最小元素小，那么earliestChaned返回true
-  bool earliestChanged = insert(timer);
-
-  if (earliestChanged)
-  {
-    // 最小超时timer改变了，就重新设置timerFd的触发时间间隔
-    resetTimerfd(timerfd_, timer->expiration());
-  }
-}
-
-void TimerQueue::cancelInLoop(TimerId timerId)
-{
-  loop_->assertInLoopThread();
-  assert(timers_.size() == activeTimers_.size());
-  ActiveTimer timer(timerId.timer_, timerId.sequence_);
-  ActiveTimerSet::iterator it = activeTimers_.find(timer);
-  if (it != activeTimers_.end())  // 情况一：待删除的timer在激活队列里
-  {
-    // std::set的erase返回的是删除的元素个数
-    size_t n = timers_.erase(Entry(it->first->expiration(), it->first));
-    assert(n == 1);
-    (void) n;
-    delete it->first;  // FIXME: no delete please
-    activeTimers_.erase(it);
-  }
-  else if (callingExpiredTimers_)  // 情况二：待删除的timer不在激活队列里，但是还没调用回调函数
-  {
-    // 因为有可能是用户的timer function取消当前的timer
-    // 这两个回调function都是在handleEvent阶段处理的
-    cancelingTimers_.insert(timer);
-  }
-  assert(timers_.size() == activeTimers_.size());
-}
-
-void TimerQueue::handleRead()
-{
-  loop_->assertInLoopThread();
-  Timestamp now(Timestamp::now());
-  readTimerfd(timerfd_, now);
-
-  // 获取所有的超时Entry
-  std::vector<Entry> expired = getExpired(now);
-
-  callingExpiredTimers_ = true;
-  cancelingTimers_.clear();
-  // safe to callback outside critical section
-  for (const Entry &it : expired)
-  {
-    // 调用超时的回调函数
-    it.second->run();
-  }
-  callingExpiredTimers_ = false;
-
-  reset(expired, now);
 }
 
-std::vector<TimerQueue::Entry> TimerQueue::getExpired(Timestamp now)
+void TimerQueue::armTimerfd(Timestamp earliest, Timestamp latest)
 {
-  assert(timers_.size() == activeTimers_.size());
-  std::vector<Entry> expired;
-  Entry sentry(now, reinterpret_cast<Timer *>(UINTPTR_MAX));
-  // 从set里面找到第一个 > 当前时间戳的timer的位置
-  TimerList::iterator end = timers_.lower_bound(sentry);
-  assert(end == timers_.end() || now < end->first);
-  // 把超时的timer全部拷贝到expired容器内
-  std::copy(timers_.begin(), end, back_inserter(expired));
-  // 把set的超时时间全部删除
-  timers_.erase(timers_.begin(), end);
-
-  for (const Entry &it : expired)
+  if (armed_.valid() && !(latest < armed_))
   {
-    ActiveTimer timer(it.second, it.second->sequence());
-    size_t n = activeTimers_.erase(timer);
-    assert(n == 1);
-    (void) n;
-  }
-
-  assert(timers_.size() == activeTimers_.size());
-  return expired;
-}
-
-void TimerQueue::reset(const std::vector<Entry> &expired, Timestamp now)
-{
-  Timestamp nextExpire;
-
-  for (const Entry &it : expired)
-  {
-    ActiveTimer timer(it.second, it.second->sequence());
-    // timer是重复触发的，且没有被取消
-    if (it.second->repeat() && cancelingTimers_.find(timer) == cancelingTimers_.end())
-    {
-      it.second->restart(now);  // 重置超时时间
-      insert(it.second);        // 加入激活序列
-    }
-    else  // 说明timer是一次性的，或者被取消了
+    // 已经设置的时间在容许范围内，或者更早，醒来以后会重新设置
+    if (earliest < armed_)
     {
-      // FIXME move to a free list
-      delete it.second;  // FIXME: no delete please
+      timerfdResetsSaved_.fetch_add(1, std::memory_order_relaxed);
     }
+    return;
   }
-
-  if (!timers_.empty())
-  {
-    nextExpire = timers_.begin()->second->expiration();
-  }
-
-  if (nextExpire.valid())  // 第一个timer超时间隔合法
-  {
-    // 重设timerFd的超时间隔
-    resetTimerfd(timerfd_, nextExpire);
-  }
+  // 按一组里最晚的时间设置，后面加进来的timer更可能落在这个范围里
+  armed_ = latest;
+  timerfdResets_.fetch_add(1, std::memory_order_relaxed);
+  detail::resetTimerfd(timerfd_, latest);
 }
 
-bool TimerQueue::insert(Timer *timer)
+void TimerQueue::handleRead()
 {
   loop_->assertInLoopThread();
-  assert(timers_.size() == activeTimers_.size());
-  bool earliestChanged = false;
-  Timestamp when = timer->expiration();
-  TimerList::iterator it = timers_.begin();
-  if (it == timers_.end() || when < it->first)
-  {
-    earliestChanged = true;
-  }
-  {
-    // std::set是基于红黑树的平衡二叉树，元素是唯一的
-    // std::set的insert函数，返回值为std::pair类型
-    // 若插入成功，返回插入位置的迭代器及true
-    // 若插入失败，返回与当前插入元素相同的元素的位置的迭代器及false
-    std::pair<TimerList::iterator, bool> result = timers_.insert(Entry(when, timer));
-    assert(result.second);
-    (void) result;
-  }
-  {
-    std::pair<ActiveTimerSet::iterator, bool> result = activeTimers_.insert(ActiveTimer(timer, timer->sequence()));
-    assert(result.second);
-    (void) result;
-  }
-
-  assert(timers_.size() == activeTimers_.size());
-  return earliestChanged;
+  Timestamp now(loop_->cachedClock() ? loop_->pollReturnTime() : Timestamp::now());
+  detail::readTimerfd(timerfd_, now);
+  // timerfd是一次性的，触发以后就没有设置了
+  armed_ = Timestamp::invalid();
+  handleExpired(now);
 }
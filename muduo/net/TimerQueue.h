@@ -1,13 +1,12 @@
 #ifndef MUDUO_NET_TIMERQUEUE_H
 #define MUDUO_NET_TIMERQUEUE_H
 
-#include <set>
-#include <vector>
-
-#include "muduo/base/Mutex.h"
 #include "muduo/base/Timestamp.h"
 #include "muduo/net/Callbacks.h"
 #include "muduo/net/Channel.h"
+#include "muduo/net/TimerId.h"
+
+#include <atomic>
 
 namespace muduo
 {
@@ -15,56 +14,70 @@ namespace net
 {
 class EventLoop;
 class Timer;
-class TimerId;
 
 ///
+/// Base class for timer queues.
 /// A best efforts timer queue.
 /// No guarantee that the callback will be on time.
 ///
+/// Owns the timerfd, implementations keep the timers and arm it
+/// for the next deadline with armTimerfd().
+///
+/// A timer may carry a slack, it runs somewhere in [when, when + slack].
+/// The timerfd is armed at the latest deadline of a group of nearby timers
+/// and left alone while new timers can still run at that point,
+/// so staggered timeouts cost one timerfd_settime(2) per group instead of one each.
+///
 class TimerQueue : noncopyable
 {
  public:
   explicit TimerQueue(EventLoop *loop);
-  ~TimerQueue();
+  virtual ~TimerQueue();
 
   ///
   /// Schedules the callback to be run at given time,
   /// repeats if @c interval > 0.0.
   ///
+  /// The callback may be delayed by up to @c slack seconds
+  /// to share a wakeup with other timers.
+  ///
   /// Must be thread safe. Usually be called from other threads.
-  TimerId addTimer(TimerCallback cb, Timestamp when, double interval);
+  virtual TimerId addTimer(TimerCallback cb, Timestamp when, double interval, double slack = 0.0) = 0;
 
-  void cancel(TimerId timerId);
+  /// Must be thread safe.
+  virtual void cancel(TimerId timerId) = 0;
 
- private:
-  // FIXME: use unique_ptr<Timer> instead of raw pointers.
-  // This requires heterogeneous comparison lookup (N3465) from C++14
-  // so that we can find an T* in a set<unique_ptr<T>>.
-  typedef std::pair<Timestamp, Timer *> Entry;
-  typedef std::set<Entry> TimerList;
-  typedef std::pair<Timer *, int64_t> ActiveTimer;
-  typedef std::set<ActiveTimer> ActiveTimerSet;
+  /// MUDUO_USE_TIMING_WHEEL selects TimingWheelTimerQueue, SetTimerQueue otherwise.
+  static TimerQueue *newDefaultTimerQueue(EventLoop *loop);
+
+  /// timerfd_settime(2) calls issued, and the ones a timer without slack would have needed
+  /// but were skipped because the timerfd was already armed within its slack.
+  int64_t timerfdResets() const { return timerfdResets_.load(std::memory_order_relaxed); }
+  int64_t timerfdResetsSaved() const { return timerfdResetsSaved_.load(std::memory_order_relaxed); }
 
-  void addTimerInLoop(Timer *timer);
-  void cancelInLoop(TimerId timerId);
+ protected:
+  /// Called in the loop thread when the timerfd fires.
+  virtual void handleExpired(Timestamp now) = 0;
+
+  /// Makes sure the timerfd fires within [earliest, latest],
+  /// keeps the current setting if it is early enough.
+  /// The setting is forgotten when the timerfd fires, before handleExpired().
+  void armTimerfd(Timestamp earliest, Timestamp latest);
+
+  static Timer *timerOf(const TimerId &timerId) { return timerId.timer_; }
+  static int64_t sequenceOf(const TimerId &timerId) { return timerId.sequence_; }
+
+  EventLoop *loop_;  // 时间队列的归属的事件循环
+
+ private:
   // called when timerfd alarms
   void handleRead();
-  // move out all expired timers
-  std::vector<Entry> getExpired(Timestamp now);
-  void reset(const std::vector<Entry> &expired, Timestamp now);
-
-  bool insert(Timer *timer);
 
-  EventLoop *loop_;    // 时间队列的归属的事件循环
   const int timerfd_;  // timer描述符
   Channel timerfdChannel_;
-  // Timer list sorted by expiration
-  TimerList timers_;  // 根据超时时间戳从小到大排序
-
-  // for cancel()
-  ActiveTimerSet activeTimers_;
-  bool callingExpiredTimers_; /* atomic */
-  ActiveTimerSet cancelingTimers_;
+  Timestamp armed_;  // timerfd触发的时间，invalid表示没有设置
+  std::atomic<int64_t> timerfdResets_;
+  std::atomic<int64_t> timerfdResetsSaved_;
 };
 
 }  // namespace net
@@ -0,0 +1,114 @@
+#ifndef MUDUO_NET_CORO_AWAITABLES_H
+#define MUDUO_NET_CORO_AWAITABLES_H
+
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/Future.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/coro/Task.h"
+
+namespace muduo
+{
+namespace net
+{
+namespace coro
+{
+class SleepAwaiter
+{
+ public:
+  SleepAwaiter(EventLoop *loop, double seconds) : loop_(loop), seconds_(seconds) {}
+
+  bool await_ready() const { return seconds_ <= 0; }
+  void await_suspend(std::coroutine_handle<> h)
+  {
+    // 只捕获一个handle，放得进std::function的small buffer，不另外分配
+    loop_->runAfter(seconds_, [h] { h.resume(); });
+  }
+  void await_resume() const {}
+
+ private:
+  EventLoop *loop_;
+  double seconds_;
+};
+
+///
+/// co_await sleep(loop, 0.5) resumes the coroutine from a timer of @c loop.
+/// Call it in the loop thread, the timer's node is the only allocation.
+///
+inline SleepAwaiter sleep(EventLoop *loop, double seconds)
+{
+  return SleepAwaiter(loop, seconds);
+}
+
+class ConnectAwaiter
+{
+ public:
+  explicit ConnectAwaiter(TcpClient *client) : client_(client) {}
+
+  bool await_ready() const { return false; }
+  void await_suspend(std::coroutine_handle<> h)
+  {
+    client_->setConnectionCallback([this, h](const TcpConnectionPtr &conn) {
+      if (conn->connected())
+      {
+        conn_ = conn;
+        client_->setConnectionCallback(defaultConnectionCallback);
+        // 不在连接自己的ConnectionCallback里恢复，协程接着要在这个连接上建Stream换掉回调
+        conn->getLoop()->queueInLoop([h] { h.resume(); });
+      }
+    });
+    client_->connect();
+  }
+  TcpConnectionPtr await_resume() { return std::move(conn_); }
+
+ private:
+  TcpClient *client_;
+  TcpConnectionPtr conn_;
+};
+
+///
+/// co_await connect(client) starts @c client connecting and resumes
+/// in the client's loop with the established connection, put a Stream on it right away.
+/// The client keeps retrying like TcpClient::connect() does, so it only resumes once connected.
+/// Call it in the client's loop thread, it takes over the client's ConnectionCallback meanwhile.
+///
+inline ConnectAwaiter connect(TcpClient &client)
+{
+  return ConnectAwaiter(&client);
+}
+
+template <typename T>
+class FutureAwaiter
+{
+ public:
+  FutureAwaiter(EventLoop *loop, Future<T> &&future) : loop_(loop), future_(std::move(future)) {}
+
+  bool await_ready() const { return future_.ready(); }
+  void await_suspend(std::coroutine_handle<> h)
+  {
+    future_.then(loop_, [this, h](Future<T> ready) {
+      future_ = std::move(ready);
+      h.resume();
+    });
+  }
+  T await_resume() { return future_.get(); }
+
+ private:
+  EventLoop *loop_;
+  Future<T> future_;
+};
+
+///
+/// co_await awaitOn(loop, other->submit(f)) resumes in @c loop with f's result,
+/// eg. to read another loop's state from a session without blocking.
+///
+template <typename T>
+FutureAwaiter<T> awaitOn(EventLoop *loop, Future<T> &&future)
+{
+  return FutureAwaiter<T>(loop, std::move(future));
+}
+
+}  // namespace coro
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_CORO_AWAITABLES_H
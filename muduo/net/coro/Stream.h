@@ -0,0 +1,256 @@
+#ifndef MUDUO_NET_CORO_STREAM_H
+#define MUDUO_NET_CORO_STREAM_H
+
+#include "muduo/net/TcpConnection.h"
+#include "muduo/net/coro/Task.h"
+
+#include <memory>
+
+#include <string.h>
+
+namespace muduo
+{
+namespace net
+{
+namespace coro
+{
+///
+/// Coroutine reads and writes on one TcpConnection.
+///
+/// Takes over the connection's MessageCallback and ConnectionCallback:
+/// data stays in the input buffer until a read wants it,
+/// and the disconnect shows up as a closed read instead of a ConnectionCallback.
+/// Reads resume the coroutine right inside the MessageCallback, on the connection's loop,
+/// the awaiters live in the coroutine frame, so a read allocates nothing but its result.
+/// Once the Stream is gone, later data on the connection is discarded.
+///
+/// Create it in the connection's loop thread before returning to the loop,
+/// eg. first thing in a session spawned from the ConnectionCallback,
+/// and keep it alive across every co_await on it.
+/// One Stream per connection; one coroutine reads at a time, another one may drain() meanwhile.
+///
+class Stream : noncopyable
+{
+ public:
+  class ReadAwaiter
+  {
+   public:
+    bool await_ready() { return stream_->satisfied(*this); }
+    void await_suspend(std::coroutine_handle<> h)
+    {
+      assert(!stream_->reader_);
+      stream_->reader_ = h;
+      stream_->pendingRead_ = this;
+    }
+    /// Empty if the connection closed first, what was read so far stays in buffer().
+    std::optional<string> await_resume() { return stream_->take(*this); }
+
+   private:
+    friend class Stream;
+    enum Kind
+    {
+      kExactly,
+      kUntil,
+      kSome,
+    };
+    ReadAwaiter(Stream *stream, Kind kind, size_t n, StringPiece delimiter)
+        : stream_(stream), kind_(kind), n_(n), delimiter_(delimiter), scanned_(0), found_(0)
+    {
+    }
+
+    Stream *stream_;
+    Kind kind_;
+    size_t n_;
+    StringPiece delimiter_;
+    size_t scanned_;  // readUntil已经找过的字节数，新数据来了只找后面的
+    size_t found_;    // 到分隔符结尾的长度
+  };
+
+  class DrainAwaiter
+  {
+   public:
+    bool await_ready() const { return stream_->closed_ || stream_->conn_->outputBuffer()->readableBytes() == 0; }
+    void await_suspend(std::coroutine_handle<> h)
+    {
+      assert(!stream_->writer_);
+      stream_->writer_ = h;
+    }
+    /// false if the connection closed before the output drained.
+    bool await_resume() const { return !stream_->closed_; }
+
+   private:
+    friend class Stream;
+    explicit DrainAwaiter(Stream *stream) : stream_(stream) {}
+    Stream *stream_;
+  };
+
+  explicit Stream(const TcpConnectionPtr &conn)
+      : conn_(conn), self_(std::make_shared<Stream *>(this)), closed_(!conn->connected()), pendingRead_(NULL), drainHooked_(false)
+  {
+    conn_->getLoop()->assertInLoopThread();
+    // 回调里捕获self_而不是this：Stream可能在回调执行中途析构（协程在里面结束），
+    // 析构时只把*self_清空，不去替换正在执行的回调
+    std::shared_ptr<Stream *> self(self_);
+    conn_->setMessageCallback([self](const TcpConnectionPtr &, Buffer *buf, Timestamp) {
+      if (*self)
+      {
+        (*self)->onMessage();
+      }
+      else
+      {
+        buf->retrieveAll();
+      }
+    });
+    conn_->setConnectionCallback([self](const TcpConnectionPtr &c) {
+      if (*self && !c->connected())
+      {
+        (*self)->onClose();
+      }
+    });
+  }
+
+  ~Stream()
+  {
+    assert(!reader_ && !writer_);
+    // 连接可能比会话活得久，后面的数据就丢掉
+    *self_ = NULL;
+  }
+
+  const TcpConnectionPtr &connection() const { return conn_; }
+  /// Bytes received but not read yet.
+  Buffer *buffer() { return conn_->inputBuffer(); }
+  bool closed() const { return closed_; }
+
+  /// Exactly @c n bytes.
+  ReadAwaiter read(size_t n) { return ReadAwaiter(this, ReadAwaiter::kExactly, n, StringPiece()); }
+  /// Up to and including @c delimiter, which must stay valid until the read returns.
+  ReadAwaiter readUntil(StringPiece delimiter) { return ReadAwaiter(this, ReadAwaiter::kUntil, 0, delimiter); }
+  /// Whatever has arrived, at least one byte.
+  ReadAwaiter readSome() { return ReadAwaiter(this, ReadAwaiter::kSome, 1, StringPiece()); }
+
+  void write(const StringPiece &data) { conn_->send(data); }
+  /// Waits until everything written has gone to the kernel, for flow control.
+  DrainAwaiter drain()
+  {
+    if (!drainHooked_)
+    {
+      // 只在用到的时候设，不然每次写完都要排队调一次
+      drainHooked_ = true;
+      std::shared_ptr<Stream *> self(self_);
+      conn_->setWriteCompleteCallback([self](const TcpConnectionPtr &) {
+        if (*self)
+        {
+          (*self)->onWriteComplete();
+        }
+      });
+    }
+    return DrainAwaiter(this);
+  }
+
+  void shutdown() { conn_->shutdown(); }
+  void forceClose() { conn_->forceClose(); }
+
+ private:
+  // 先看缓冲区里的够不够一次读，连接断了之后已经收到的完整行也要能读出来；
+  // 不够的话断了也算满足，由take()返回空
+  bool satisfied(ReadAwaiter &r) { return available(r) || closed_; }
+
+  bool available(ReadAwaiter &r)
+  {
+    Buffer *buf = buffer();
+    const size_t readable = buf->readableBytes();
+    if (r.kind_ != ReadAwaiter::kUntil)
+    {
+      return readable >= r.n_;
+    }
+    const size_t dlen = r.delimiter_.size();
+    if (readable < dlen)
+    {
+      return false;
+    }
+    const size_t from = r.scanned_ >= dlen ? r.scanned_ - dlen + 1 : 0;
+    const char *begin = buf->peek() + from;
+    const char *end = buf->beginWrite();
+    const char *hit = static_cast<const char *>(::memmem(begin, static_cast<size_t>(end - begin), r.delimiter_.data(), dlen));
+    r.scanned_ = readable;
+    if (hit == NULL)
+    {
+      return false;
+    }
+    r.found_ = static_cast<size_t>(hit - buf->peek()) + dlen;
+    return true;
+  }
+
+  std::optional<string> take(ReadAwaiter &r)
+  {
+    Buffer *buf = buffer();
+    size_t len = 0;
+    switch (r.kind_)
+    {
+    case ReadAwaiter::kExactly:
+      len = r.n_;
+      break;
+    case ReadAwaiter::kUntil:
+      len = r.found_;
+      break;
+    case ReadAwaiter::kSome:
+      len = buf->readableBytes();
+      break;
+    }
+    if (len == 0 || buf->readableBytes() < len)
+    {
+      // 连接断了，不够一次读的
+      return std::nullopt;
+    }
+    return buf->retrieveAsString(len);
+  }
+
+  void onMessage()
+  {
+    if (reader_ && satisfied(*pendingRead_))
+    {
+      pendingRead_ = NULL;
+      // 必须是最后一步，协程结束的话Stream可能已经析构了
+      std::exchange(reader_, nullptr).resume();
+    }
+  }
+
+  void onWriteComplete()
+  {
+    if (writer_)
+    {
+      std::exchange(writer_, nullptr).resume();
+    }
+  }
+
+  void onClose()
+  {
+    closed_ = true;
+    pendingRead_ = NULL;
+    std::coroutine_handle<> reader = std::exchange(reader_, nullptr);
+    std::coroutine_handle<> writer = std::exchange(writer_, nullptr);
+    // 之后不再碰this
+    if (writer)
+    {
+      writer.resume();
+    }
+    if (reader)
+    {
+      reader.resume();
+    }
+  }
+
+  TcpConnectionPtr conn_;
+  std::shared_ptr<Stream *> self_;  // 回调里共享，Stream析构时清空
+  bool closed_;
+  ReadAwaiter *pendingRead_;
+  std::coroutine_handle<> reader_;
+  std::coroutine_handle<> writer_;
+  bool drainHooked_;
+};
+
+}  // namespace coro
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_CORO_STREAM_H
@@ -0,0 +1,177 @@
+#ifndef MUDUO_NET_CORO_TASK_H
+#define MUDUO_NET_CORO_TASK_H
+
+#if __cplusplus < 202002L
+#error "muduo/net/coro needs C++20, build the code that includes it with -std=c++20"
+#endif
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+#include <assert.h>
+
+namespace muduo
+{
+namespace net
+{
+namespace coro
+{
+template <typename T>
+class Task;
+
+namespace detail
+{
+struct PromiseBase
+{
+  // 结束时回到co_await这个Task的协程，spawn出来的没有人等，自己销毁
+  struct FinalAwaiter
+  {
+    bool await_ready() const noexcept { return false; }
+
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+    {
+      PromiseBase &promise = h.promise();
+      if (promise.detached)
+      {
+        h.destroy();
+        return std::noop_coroutine();
+      }
+      return promise.continuation ? promise.continuation : std::noop_coroutine();
+    }
+
+    void await_resume() const noexcept {}
+  };
+
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+  FinalAwaiter final_suspend() const noexcept { return {}; }
+
+  void unhandled_exception()
+  {
+    if (detached)
+    {
+      // 没有人接，和普通回调里抛出的异常一样，传到EventLoop::loop()外面
+      throw;
+    }
+    exception = std::current_exception();
+  }
+
+  std::coroutine_handle<> continuation;
+  std::exception_ptr exception;
+  bool detached = false;
+};
+
+template <typename T>
+struct Promise : PromiseBase
+{
+  Task<T> get_return_object();
+  template <typename U>
+  void return_value(U &&value)
+  {
+    result.emplace(std::forward<U>(value));
+  }
+
+  T take()
+  {
+    if (exception)
+    {
+      std::rethrow_exception(exception);
+    }
+    return std::move(*result);
+  }
+
+  std::optional<T> result;
+};
+
+template <>
+struct Promise<void> : PromiseBase
+{
+  Task<void> get_return_object();
+  void return_void() {}
+
+  void take()
+  {
+    if (exception)
+    {
+      std::rethrow_exception(exception);
+    }
+  }
+};
+
+}  // namespace detail
+
+///
+/// Lazy coroutine, runs when it is co_awaited or spawn()ed.
+///
+/// A session is one Task whose frame is its only allocation,
+/// the awaiters in Stream.h and Awaitables.h live in that frame.
+/// co_await of a sub-task resumes it with symmetric transfer,
+/// its result or exception comes back to the awaiting coroutine.
+///
+template <typename T = void>
+class Task
+{
+ public:
+  typedef detail::Promise<T> promise_type;
+  typedef std::coroutine_handle<promise_type> Handle;
+
+  explicit Task(Handle h) : handle_(h) {}
+  Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+  Task(const Task &) = delete;
+  Task &operator=(const Task &) = delete;
+  ~Task()
+  {
+    if (handle_)
+    {
+      handle_.destroy();
+    }
+  }
+
+  bool await_ready() const noexcept { return false; }
+
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+  {
+    handle_.promise().continuation = awaiting;
+    return handle_;
+  }
+
+  T await_resume() { return handle_.promise().take(); }
+
+ private:
+  template <typename U>
+  friend void spawn(Task<U> task);
+
+  Handle handle_;
+};
+
+template <typename T>
+Task<T> detail::Promise<T>::get_return_object()
+{
+  return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> detail::Promise<void>::get_return_object()
+{
+  return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+///
+/// Starts @c task right away in the calling thread, it runs until its first suspension.
+/// Nobody waits for it, the frame is freed when it finishes.
+/// Start sessions in the thread of the loop they belong to, eg. in the ConnectionCallback.
+///
+template <typename T>
+void spawn(Task<T> task)
+{
+  auto h = std::exchange(task.handle_, nullptr);
+  h.promise().detached = true;
+  h.resume();
+}
+
+}  // namespace coro
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_CORO_TASK_H
@@ -5,6 +5,7 @@
 #include "muduo/net/EventLoop.h"
 #include "muduo/net/http/HttpRequest.h"
 #include "muduo/net/http/HttpResponse.h"
+#include "muduo/net/inspect/NetInspector.h"
 #include "muduo/net/inspect/PerformanceInspector.h"
 #include "muduo/net/inspect/ProcessInspector.h"
 #include "muduo/net/inspect/SystemInspector.h"
@@ -51,7 +52,8 @@ std::vector<string> split(const string &str)
 extern char favicon[1743];
 
 Inspector::Inspector(EventLoop *loop, const InetAddress &httpAddr, const string &name)
-    : server_(loop, httpAddr, "Inspector:" + name), processInspector_(new ProcessInspector), systemInspector_(new SystemInspector)
+    : server_(loop, httpAddr, "Inspector:" + name), processInspector_(new ProcessInspector), systemInspector_(new SystemInspector),
+      netInspector_(new NetInspector)
 {
   assert(CurrentThread::isMainThread());
   assert(g_globalInspector == 0);
@@ -59,6 +61,7 @@ Inspector::Inspector(EventLoop *loop, const InetAddress &httpAddr, const string
   server_.setHttpCallback(std::bind(&Inspector::onRequest, this, _1, _2));
   processInspector_->registerCommands(this);
   systemInspector_->registerCommands(this);
+  netInspector_->registerCommands(this);
 #ifdef HAVE_TCMALLOC
   performanceInspector_.reset(new PerformanceInspector);
   performanceInspector_->registerCommands(this);
@@ -11,6 +11,7 @@ namespace muduo
 {
 namespace net
 {
+class NetInspector;
 class ProcessInspector;
 class PerformanceInspector;
 class SystemInspector;
@@ -40,6 +41,7 @@ class Inspector : noncopyable
   std::unique_ptr<ProcessInspector> processInspector_;
   std::unique_ptr<PerformanceInspector> performanceInspector_;
   std::unique_ptr<SystemInspector> systemInspector_;
+  std::unique_ptr<NetInspector> netInspector_;
   Mutex mutex_;
   std::map<string, CommandList> modules_;
   std::map<string, HelpList> helps_;
@@ -0,0 +1,23 @@
+#include "muduo/net/inspect/NetInspector.h"
+
+#include "muduo/net/BufferPool.h"
+#include "muduo/net/EventLoop.h"
+
+using namespace muduo;
+using namespace muduo::net;
+
+void NetInspector::registerCommands(Inspector *ins)
+{
+  ins->add("net", "bufferpool", NetInspector::bufferPool, "print buffer pool statistics of each EventLoop");
+  ins->add("net", "loops", NetInspector::loops, "print wakeup and write coalescing statistics of each EventLoop");
+}
+
+string NetInspector::bufferPool(HttpRequest::Method, const Inspector::ArgList &)
+{
+  return BufferPool::allStatsString();
+}
+
+string NetInspector::loops(HttpRequest::Method, const Inspector::ArgList &)
+{
+  return EventLoop::allStatsString();
+}
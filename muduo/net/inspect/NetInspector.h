@@ -0,0 +1,22 @@
+#ifndef MUDUO_NET_INSPECT_NETINSPECTOR_H
+#define MUDUO_NET_INSPECT_NETINSPECTOR_H
+
+#include "muduo/net/inspect/Inspector.h"
+
+namespace muduo
+{
+namespace net
+{
+class NetInspector : noncopyable
+{
+ public:
+  void registerCommands(Inspector *ins);
+
+  static string bufferPool(HttpRequest::Method, const Inspector::ArgList &);
+  static string loops(HttpRequest::Method, const Inspector::ArgList &);
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif
@@ -1,5 +1,7 @@
+#include "muduo/base/Logging.h"
 #include "muduo/net/Poller.h"
 #include "muduo/net/poller/EPollPoller.h"
+#include "muduo/net/poller/IoUringPoller.h"
 #include "muduo/net/poller/PollPoller.h"
 
 #include <stdlib.h>
@@ -12,6 +14,18 @@ Poller *Poller::newDefaultPoller(EventLoop *loop)
   {
     return new PollPoller(loop);
   }
+  else if (::getenv("MUDUO_USE_IOURING"))
+  {
+    IoUringPoller *poller = new IoUringPoller(loop);
+    if (poller->valid())
+    {
+      return poller;
+    }
+    // 内核太老或者被seccomp禁掉了
+    LOG_WARN << "io_uring is not available, fall back to epoll";
+    delete poller;
+    return new EPollPoller(loop);
+  }
   else
   {
     return new EPollPoller(loop);
@@ -80,9 +80,7 @@ void EPollPoller::fillActiveChannels(int numEvents, ChannelList *activeChannels)
     Channel *channel = static_cast<Channel *>(events_[i].data.ptr);
 #ifndef NDEBUG
     int fd = channel->fd();
-    ChannelMap::const_iterator it = channels_.find(fd);
-    assert(it != channels_.end());
-    assert(it->second == channel);
+    assert(channels_.find(fd) == channel);
 #endif
     channel->set_revents(events_[i].events);
     activeChannels->push_back(channel);
@@ -100,13 +98,11 @@ void EPollPoller::updateChannel(Channel *channel)
     int fd = channel->fd();
     if (index == kNew)
     {
-      assert(channels_.find(fd) == channels_.end());
-      channels_[fd] = channel;
+      channels_.insert(fd, channel);
     }
     else  // index == kDeleted
     {
-      assert(channels_.find(fd) != channels_.end());
-      assert(channels_[fd] == channel);
+      assert(channels_.find(fd) == channel);
     }
 
     channel->set_index(kAdded);
@@ -117,8 +113,7 @@ void EPollPoller::updateChannel(Channel *channel)
     // update existing one with EPOLL_CTL_MOD/DEL
     int fd = channel->fd();
     (void) fd;
-    assert(channels_.find(fd) != channels_.end());
-    assert(channels_[fd] == channel);
+    assert(channels_.find(fd) == channel);
     assert(index == kAdded);
     if (channel->isNoneEvent())
     {
@@ -137,8 +132,7 @@ void EPollPoller::removeChannel(Channel *channel)
   Poller::assertInLoopThread();
   int fd = channel->fd();
   LOG_TRACE << "fd = " << fd;
-  assert(channels_.find(fd) != channels_.end());
-  assert(channels_[fd] == channel);
+  assert(channels_.find(fd) == channel);
   assert(channel->isNoneEvent());
   int index = channel->index();
   assert(index == kAdded || index == kDeleted);
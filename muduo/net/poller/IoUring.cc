@@ -0,0 +1,195 @@
+#include "muduo/net/poller/IoUring.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/base/Types.h"
+
+#include <algorithm>
+
+#include <assert.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+int ioUringSetup(unsigned entries, struct io_uring_params *params)
+{
+  return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+template <typename T>
+T *ringPointer(void *base, __u32 offset)
+{
+  return static_cast<T *>(static_cast<void *>(static_cast<char *>(base) + offset));
+}
+
+}  // namespace
+
+IoUring::IoUring(unsigned entries)
+    : ringFd_(-1),
+      ringMem_(MAP_FAILED),
+      ringSize_(0),
+      sqes_(NULL),
+      sqesSize_(0),
+      sqHead_(NULL),
+      sqTail_(NULL),
+      sqMask_(0),
+      sqEntries_(0),
+      cqHead_(NULL),
+      cqTail_(NULL),
+      cqMask_(0),
+      cqes_(NULL),
+      sqeHead_(0),
+      sqeTail_(0),
+      enterCount_(0)
+{
+  struct io_uring_params params;
+  memZero(&params, sizeof params);
+  // 提交出错的SQE不影响后面的，task work等到下次进内核再跑，不用IPI打断
+  params.flags = IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+  int fd = ioUringSetup(entries, &params);
+  if (fd < 0 && errno == EINVAL)
+  {
+    // 老内核不认识这些flag
+    memZero(&params, sizeof params);
+    fd = ioUringSetup(entries, &params);
+  }
+  if (fd < 0)
+  {
+    LOG_SYSERR << "io_uring_setup";
+    return;
+  }
+  // 超时要靠EXT_ARG，溢出不丢CQE要靠NODROP，都是5.11以后才有
+  const unsigned required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+  if ((params.features & required) != required)
+  {
+    LOG_WARN << "io_uring lacks required features " << params.features;
+    ::close(fd);
+    return;
+  }
+
+  ringSize_ = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                       params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe));
+  ringMem_ = ::mmap(NULL, ringSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  if (ringMem_ == MAP_FAILED)
+  {
+    LOG_SYSERR << "mmap io_uring rings";
+    ::close(fd);
+    return;
+  }
+  sqesSize_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  void *sqes = ::mmap(NULL, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED)
+  {
+    LOG_SYSERR << "mmap io_uring sqes";
+    ::munmap(ringMem_, ringSize_);
+    ringMem_ = MAP_FAILED;
+    ::close(fd);
+    return;
+  }
+  sqes_ = static_cast<struct io_uring_sqe *>(sqes);
+
+  sqHead_ = ringPointer<unsigned>(ringMem_, params.sq_off.head);
+  sqTail_ = ringPointer<unsigned>(ringMem_, params.sq_off.tail);
+  sqMask_ = *ringPointer<unsigned>(ringMem_, params.sq_off.ring_mask);
+  sqEntries_ = *ringPointer<unsigned>(ringMem_, params.sq_off.ring_entries);
+  cqHead_ = ringPointer<unsigned>(ringMem_, params.cq_off.head);
+  cqTail_ = ringPointer<unsigned>(ringMem_, params.cq_off.tail);
+  cqMask_ = *ringPointer<unsigned>(ringMem_, params.cq_off.ring_mask);
+  cqes_ = ringPointer<struct io_uring_cqe>(ringMem_, params.cq_off.cqes);
+
+  // SQ数组固定一一对应，填SQE的时候就不用再管它了
+  unsigned *array = ringPointer<unsigned>(ringMem_, params.sq_off.array);
+  for (unsigned i = 0; i < sqEntries_; ++i)
+  {
+    array[i] = i;
+  }
+  sqeHead_ = sqeTail_ = *sqTail_;
+  ringFd_ = fd;
+}
+
+IoUring::~IoUring()
+{
+  if (sqes_)
+  {
+    ::munmap(sqes_, sqesSize_);
+  }
+  if (ringMem_ != MAP_FAILED)
+  {
+    ::munmap(ringMem_, ringSize_);
+  }
+  if (ringFd_ >= 0)
+  {
+    ::close(ringFd_);
+  }
+}
+
+struct io_uring_sqe *IoUring::getSqe()
+{
+  assert(valid());
+  if (sqeTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_)
+  {
+    // SQ满了，先把攒下的交给内核
+    if (submit() < 0)
+    {
+      LOG_SYSERR << "IoUring::getSqe submit";
+    }
+    // 内核一个都没取走（比如CQ溢出时的EBUSY），下一个位置上还是没提交的SQE，不能覆盖
+    if (sqeTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_)
+    {
+      return NULL;
+    }
+  }
+  struct io_uring_sqe *sqe = &sqes_[sqeTail_ & sqMask_];
+  memZero(sqe, sizeof *sqe);
+  ++sqeTail_;
+  return sqe;
+}
+
+int IoUring::submitAndWait(int timeoutMs)
+{
+  // 内核看到tail之前，SQE的内容必须已经写好
+  __atomic_store_n(sqTail_, sqeTail_, __ATOMIC_RELEASE);
+  // 按内核还没取走的算，上次enter失败或者只取走一部分剩下的也一起交
+  const unsigned before = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+  const unsigned toSubmit = sqeTail_ - before;
+  int n = 0;
+  if (timeoutMs == 0)
+  {
+    // 不等待，GETEVENTS顺便把task work跑掉，完成的CQE才能看到
+    n = enter(toSubmit, 0, IORING_ENTER_GETEVENTS, -1);
+  }
+  else
+  {
+    n = enter(toSubmit, 1, IORING_ENTER_GETEVENTS, timeoutMs);
+  }
+  // 只往前挪内核真正取走的
+  sqeHead_ = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+  if (n < 0 && (errno == ETIME || errno == EINTR))
+  {
+    // 超时或者被信号打断，SQE已经提交了
+    return static_cast<int>(sqeHead_ - before);
+  }
+  return n;
+}
+
+int IoUring::enter(unsigned toSubmit, unsigned minComplete, unsigned flags, int timeoutMs)
+{
+  ++enterCount_;
+  struct __kernel_timespec ts;
+  struct io_uring_getevents_arg arg;
+  memZero(&arg, sizeof arg);
+  if (timeoutMs >= 0)
+  {
+    ts.tv_sec = timeoutMs / 1000;
+    ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000 * 1000;
+    arg.ts = reinterpret_cast<uintptr_t>(&ts);
+  }
+  return static_cast<int>(::syscall(__NR_io_uring_enter, ringFd_, toSubmit, minComplete, flags | IORING_ENTER_EXT_ARG, &arg,
+                                    sizeof arg));
+}
@@ -0,0 +1,92 @@
+#ifndef MUDUO_NET_POLLER_IOURING_H
+#define MUDUO_NET_POLLER_IOURING_H
+
+#include "muduo/base/noncopyable.h"
+
+#include <linux/io_uring.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace muduo
+{
+namespace net
+{
+///
+/// A bare io_uring(7) instance driven by raw syscalls, no liburing.
+///
+/// SQEs are only queued by getSqe(), nothing reaches the kernel until
+/// submitAndWait(), so a whole loop iteration costs one io_uring_enter(2).
+/// Not thread safe, owned by one loop.
+///
+class IoUring : noncopyable
+{
+ public:
+  /// Sets up a ring of @c entries SQEs, valid() is false if the kernel can't.
+  explicit IoUring(unsigned entries);
+  ~IoUring();
+
+  bool valid() const { return ringFd_ >= 0; }
+
+  int fd() const { return ringFd_; }
+
+  /// Next free SQE, zeroed. Submits the queued ones first if the SQ ring is full,
+  /// NULL if the kernel takes none of them, e.g. EBUSY while the CQ ring overflows,
+  /// consuming CQEs and calling it again may then succeed.
+  struct io_uring_sqe *getSqe();
+
+  /// Submits the queued SQEs and waits up to @c timeoutMs for at least one CQE,
+  /// a negative timeout waits forever, 0 doesn't wait.
+  /// @return number of SQEs submitted, -1 with @c errno, ETIME on timeout is not an error
+  int submitAndWait(int timeoutMs);
+
+  int submit() { return submitAndWait(0); }
+
+  unsigned queuedSqes() const { return sqeTail_ - sqeHead_; }
+
+  /// Calls f(const io_uring_cqe&) for each ready CQE, then marks them consumed.
+  /// @return number of CQEs seen
+  template <typename F>
+  unsigned forEachCqe(F f)
+  {
+    unsigned head = *cqHead_;
+    const unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    const unsigned n = tail - head;
+    for (; head != tail; ++head)
+    {
+      f(cqes_[head & cqMask_]);
+    }
+    __atomic_store_n(cqHead_, tail, __ATOMIC_RELEASE);
+    return n;
+  }
+
+  /// io_uring_enter(2) calls made so far.
+  int64_t enterCount() const { return enterCount_; }
+
+ private:
+  int enter(unsigned toSubmit, unsigned minComplete, unsigned flags, int timeoutMs);
+
+  int ringFd_;
+  void *ringMem_;
+  size_t ringSize_;
+  struct io_uring_sqe *sqes_;
+  size_t sqesSize_;
+
+  // 映射出来的内核共享变量
+  unsigned *sqHead_;
+  unsigned *sqTail_;
+  unsigned sqMask_;
+  unsigned sqEntries_;
+  unsigned *cqHead_;
+  unsigned *cqTail_;
+  unsigned cqMask_;
+  struct io_uring_cqe *cqes_;
+
+  unsigned sqeHead_;  // 内核已经取走的，上次enter之后的sqHead_
+  unsigned sqeTail_;  // 已经填好的
+  int64_t enterCount_;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_POLLER_IOURING_H
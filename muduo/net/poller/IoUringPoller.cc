@@ -0,0 +1,441 @@
+#include "muduo/net/poller/IoUringPoller.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/Channel.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <poll.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// 内核的multishot poll是边沿触发的（隐含EPOLLET，和IORING_POLL_ADD_LEVEL一起用会EINVAL），
+// 而Channel的回调都按水平触发写的：Acceptor每次只accept一个，readFd一次只读有限的字节。
+// 所以这里用单次的POLL_ADD，事件到了以后下一轮重新挂上，挂的时候内核会马上检查一次就绪状态，
+// 效果就是水平触发。重新挂的SQE和等待在同一次io_uring_enter里提交，不多花系统调用。
+
+namespace
+{
+const int kNew = -1;
+const int kAdded = 1;
+
+// user_data的最高位区分两种SQE：
+// 0 - POLL_ADD，seq(31位) << 32 | fd
+// 1 - 完成式操作，op << 32 | handler id
+const uint64_t kCompletionBit = static_cast<uint64_t>(1) << 63;
+const uint64_t kIgnoredUserData = ~static_cast<uint64_t>(0);
+const uint64_t kCancelAnyUserData = kIgnoredUserData - 1;  // 析构时取消所有操作的那个SQE
+const uint32_t kSeqMask = 0x7fffffff;
+// 析构时等被取消的操作回来，最多等这么多次
+const int kCancelWaits = 20;
+const int kCancelWaitMs = 50;
+// SQ满了内核又不收的时候，收CQE再重交最多这么多次
+const int kSubmitRetries = 16;
+
+uint64_t encodeUserData(int fd, uint32_t seq)
+{
+  return static_cast<uint64_t>(seq & kSeqMask) << 32 | static_cast<uint32_t>(fd);
+}
+
+uint64_t encodeOp(uint32_t id, uint8_t op)
+{
+  return kCompletionBit | static_cast<uint64_t>(op) << 32 | id;
+}
+
+// 完成式操作的最后一个CQE，之后内核不会再碰它的内存
+bool isFinalCompletion(const struct io_uring_cqe &cqe)
+{
+  return cqe.user_data != kIgnoredUserData && cqe.user_data != kCancelAnyUserData && (cqe.user_data & kCompletionBit) &&
+         !(cqe.flags & IORING_CQE_F_MORE);
+}
+
+}  // namespace
+
+const unsigned IoUringPoller::kRingEntries;
+const uint16_t IoUringPoller::kBufferGroup;
+const unsigned IoUringPoller::kNumBuffers;
+const size_t IoUringPoller::kBufferSize;
+
+IoUringPoller::IoUringPoller(EventLoop *loop)
+    : Poller(loop),
+      loop_(loop),
+      ring_(kRingEntries),
+      multishotRecv_(true),
+      nextHandlerId_(0),
+      inflightOps_(0)
+{
+}
+
+IoUringPoller::~IoUringPoller()
+{
+  // 关闭ring是异步的，内核里的recv/sendmsg在那之后还会写provided buffer、读连接的msghdr和输出缓冲区，
+  // 所以先全部取消，等最后的CQE都回来，再让handlers_（持有连接）和buffers_析构
+  cancelInflightOps();
+  dispatchChannel_.reset();
+}
+
+void IoUringPoller::cancelInflightOps()
+{
+  if (!valid() || inflightOps_ == 0)
+  {
+    return;
+  }
+  struct io_uring_sqe *sqe = getSqe();
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->fd = -1;
+  sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+  sqe->user_data = kCancelAnyUserData;
+  for (int i = 0; i < kCancelWaits && inflightOps_ > 0; ++i)
+  {
+    ring_.submitAndWait(kCancelWaitMs);
+    bool cancelAnyUnsupported = false;
+    auto handle = [this, &cancelAnyUnsupported](const struct io_uring_cqe &cqe) {
+      if (cqe.user_data == kCancelAnyUserData && cqe.res == -EINVAL)
+      {
+        cancelAnyUnsupported = true;
+      }
+      else if (isFinalCompletion(cqe))
+      {
+        --inflightOps_;
+      }
+    };
+    for (const struct io_uring_cqe &cqe : reaped_)
+    {
+      handle(cqe);
+    }
+    reaped_.clear();
+    ring_.forEachCqe(handle);
+    if (cancelAnyUnsupported)
+    {
+      // Linux 5.19之前没有IORING_ASYNC_CANCEL_ANY，按还在的handler和用过的op一个个取消
+      for (const auto &handler : handlers_)
+      {
+        for (size_t op = 0; op < opsUsed_.size(); ++op)
+        {
+          if (opsUsed_.test(op))
+          {
+            cancelOp(handler.first, static_cast<uint8_t>(op));
+          }
+        }
+      }
+    }
+  }
+  if (inflightOps_ > 0)
+  {
+    LOG_ERROR << "IoUringPoller::~IoUringPoller " << inflightOps_ << " operations still in flight";
+  }
+}
+
+Timestamp IoUringPoller::poll(int timeoutMs, ChannelList *activeChannels)
+{
+  LOG_TRACE << "fd total count " << channels_.size();
+  applyChanges();
+  // 提前收下来的CQE还没处理，不能再等
+  int n = ring_.submitAndWait(reaped_.empty() ? timeoutMs : 0);
+  int savedErrno = errno;
+  Timestamp now(Timestamp::now());
+  if (n < 0 && savedErrno != EINTR)
+  {
+    errno = savedErrno;
+    LOG_SYSERR << "IoUringPoller::poll()";
+  }
+  fillActiveChannels(activeChannels);
+  if (!completions_.empty())
+  {
+    // 完成事件和就绪事件一样在handleEvent阶段处理
+    dispatchChannel_->set_revents(POLLIN);
+    activeChannels->push_back(get_pointer(dispatchChannel_));
+  }
+  if (activeChannels->empty())
+  {
+    LOG_TRACE << "nothing happened";
+  }
+  return now;
+}
+
+void IoUringPoller::fillActiveChannels(ChannelList *activeChannels)
+{
+  auto handle = [this, activeChannels](const struct io_uring_cqe &cqe) {
+    if (cqe.user_data == kIgnoredUserData)
+    {
+      return;
+    }
+    if (cqe.user_data & kCompletionBit)
+    {
+      if (isFinalCompletion(cqe))
+      {
+        --inflightOps_;
+      }
+      completions_.push_back(cqe);
+      return;
+    }
+    const int fd = static_cast<int>(cqe.user_data & 0xffffffff);
+    const uint32_t seq = static_cast<uint32_t>(cqe.user_data >> 32);
+    assert(fd >= 0 && static_cast<size_t>(fd) < states_.size());
+    PollState &st = states_[fd];
+    if (!st.armed || (st.seq & kSeqMask) != seq)
+    {
+      // 已经撤掉的POLL_ADD，或者fd已经给了别的Channel
+      return;
+    }
+    st.armed = false;
+    markDirty(fd);  // 下一轮重新挂上
+    if (cqe.res < 0)
+    {
+      if (cqe.res != -ECANCELED)
+      {
+        errno = -cqe.res;
+        LOG_SYSERR << "IORING_OP_POLL_ADD fd = " << fd;
+        st.channel->set_revents(POLLERR);
+        activeChannels->push_back(st.channel);
+      }
+      return;
+    }
+    LOG_TRACE << "fd = " << fd << " revents = " << cqe.res;
+    st.channel->set_revents(cqe.res);
+    activeChannels->push_back(st.channel);
+  };
+  // getSqe()提前收下来的在前面，和CQ里的顺序一致
+  for (const struct io_uring_cqe &cqe : reaped_)
+  {
+    handle(cqe);
+  }
+  reaped_.clear();
+  ring_.forEachCqe(handle);
+}
+
+struct io_uring_sqe *IoUringPoller::getSqe()
+{
+  struct io_uring_sqe *sqe = ring_.getSqe();
+  for (int i = 0; sqe == NULL && i < kSubmitRetries; ++i)
+  {
+    // SQ满了内核却一个都不取，多半是CQ溢出了（EBUSY）：
+    // 把CQE收下来留给下一轮处理，CQ腾出地方，内核才会把溢出的挪进来，再接着取SQE
+    ring_.forEachCqe([this](const struct io_uring_cqe &cqe) { reaped_.push_back(cqe); });
+    sqe = ring_.getSqe();
+  }
+  if (sqe == NULL)
+  {
+    // 交不出去的SQE里有重新挂上的POLL_ADD和指向连接内存的RECV/SENDMSG，丢掉或者覆盖都不行
+    LOG_SYSFATAL << "IoUringPoller::getSqe - SQ ring stays full";
+  }
+  return sqe;
+}
+
+void IoUringPoller::updateChannel(Channel *channel)
+{
+  Poller::assertInLoopThread();
+  const int fd = channel->fd();
+  LOG_TRACE << "fd = " << fd << " events = " << channel->events() << " index = " << channel->index();
+  if (channel->index() == kNew)
+  {
+    channels_.insert(fd, channel);
+    channel->set_index(kAdded);
+    PollState &st = state(fd);
+    assert(st.channel == NULL);
+    assert(!st.armed);
+    st.channel = channel;
+  }
+  else
+  {
+    assert(channels_.find(fd) == channel);
+    assert(channel->index() == kAdded);
+  }
+  // 同一轮里的多次修改合并成一次
+  markDirty(fd);
+}
+
+void IoUringPoller::removeChannel(Channel *channel)
+{
+  Poller::assertInLoopThread();
+  const int fd = channel->fd();
+  LOG_TRACE << "fd = " << fd;
+  assert(channels_.find(fd) == channel);
+  assert(channel->isNoneEvent());
+  assert(channel->index() == kAdded);
+  size_t n = channels_.erase(fd);
+  (void) n;
+  assert(n == 1);
+
+  PollState &st = state(fd);
+  // 马上撤掉，fd关掉以后可能被复用，不能等到这一轮结束
+  disarm(fd);
+  st.channel = NULL;
+  channel->set_index(kNew);
+}
+
+IoUringPoller::PollState &IoUringPoller::state(int fd)
+{
+  assert(fd >= 0);
+  if (static_cast<size_t>(fd) >= states_.size())
+  {
+    states_.resize(static_cast<size_t>(fd) + 1);
+  }
+  return states_[fd];
+}
+
+void IoUringPoller::markDirty(int fd)
+{
+  PollState &st = states_[fd];
+  if (!st.dirty)
+  {
+    st.dirty = true;
+    dirtyFds_.push_back(fd);
+  }
+}
+
+void IoUringPoller::disarm(int fd)
+{
+  PollState &st = states_[fd];
+  if (st.armed)
+  {
+    struct io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = encodeUserData(fd, st.seq);
+    sqe->user_data = kIgnoredUserData;
+    st.armed = false;
+  }
+  ++st.seq;
+}
+
+void IoUringPoller::applyChanges()
+{
+  for (int fd : dirtyFds_)
+  {
+    PollState &st = states_[fd];
+    st.dirty = false;
+    const int events = st.channel ? st.channel->events() : 0;
+    if (st.armed && st.armedEvents == events)
+    {
+      continue;
+    }
+    disarm(fd);
+    if (events != 0)
+    {
+      struct io_uring_sqe *sqe = getSqe();
+      sqe->opcode = IORING_OP_POLL_ADD;
+      sqe->fd = fd;
+      sqe->poll32_events = static_cast<__u32>(events);
+      sqe->user_data = encodeUserData(fd, st.seq);
+      st.armed = true;
+      st.armedEvents = events;
+    }
+  }
+  dirtyFds_.clear();
+}
+
+bool IoUringPoller::enableProactor()
+{
+  Poller::assertInLoopThread();
+  if (!valid())
+  {
+    return false;
+  }
+  if (!buffers_)
+  {
+    // 用IORING_OP_PROVIDE_BUFFERS而不是注册buffer ring，老一些的内核也能用，
+    // 而且在有的内核上注册成功了recv还是一直ENOBUFS
+    buffers_.reset(new char[kNumBuffers * kBufferSize]);
+    provideBuffers(0, kNumBuffers);
+
+    // 不注册到poller，只用来把完成事件带进activeChannels
+    dispatchChannel_.reset(new Channel(loop_, ring_.fd()));
+    dispatchChannel_->setReadCallback(std::bind(&IoUringPoller::dispatchCompletions, this));
+  }
+  return true;
+}
+
+uint32_t IoUringPoller::addCompletionHandler(const CompletionCallback &cb)
+{
+  Poller::assertInLoopThread();
+  assert(buffers_);
+  uint32_t id = nextHandlerId_++;
+  while (id == static_cast<uint32_t>(kIgnoredUserData) || handlers_.count(id))
+  {
+    id = nextHandlerId_++;
+  }
+  handlers_[id] = cb;
+  return id;
+}
+
+void IoUringPoller::removeCompletionHandler(uint32_t id)
+{
+  Poller::assertInLoopThread();
+  handlers_.erase(id);
+}
+
+struct io_uring_sqe *IoUringPoller::prepareOp(uint32_t id, uint8_t op)
+{
+  struct io_uring_sqe *sqe = getSqe();
+  sqe->user_data = encodeOp(id, op);
+  opsUsed_.set(op);
+  ++inflightOps_;
+  return sqe;
+}
+
+void IoUringPoller::cancelOp(uint32_t id, uint8_t op)
+{
+  struct io_uring_sqe *sqe = getSqe();
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->fd = -1;
+  sqe->addr = encodeOp(id, op);
+  sqe->user_data = kIgnoredUserData;
+}
+
+const char *IoUringPoller::providedBuffer(const struct io_uring_cqe &cqe) const
+{
+  assert(cqe.flags & IORING_CQE_F_BUFFER);
+  const unsigned bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+  assert(bid < kNumBuffers);
+  return buffers_.get() + bid * kBufferSize;
+}
+
+void IoUringPoller::recycleBuffer(const struct io_uring_cqe &cqe)
+{
+  assert(cqe.flags & IORING_CQE_F_BUFFER);
+  provideBuffers(static_cast<int>(cqe.flags >> IORING_CQE_BUFFER_SHIFT), 1);
+}
+
+void IoUringPoller::provideBuffers(int bid, int count)
+{
+  // 和下一轮的等待一起提交，排在它后面的recv能用上
+  struct io_uring_sqe *sqe = getSqe();
+  sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+  sqe->fd = count;
+  sqe->addr = reinterpret_cast<uintptr_t>(buffers_.get() + static_cast<size_t>(bid) * kBufferSize);
+  sqe->len = static_cast<__u32>(kBufferSize);
+  sqe->off = static_cast<__u64>(bid);
+  sqe->buf_group = kBufferGroup;
+  sqe->user_data = kIgnoredUserData;
+}
+
+void IoUringPoller::dispatchCompletions()
+{
+  std::vector<struct io_uring_cqe> completions;
+  completions.swap(completions_);
+  for (const struct io_uring_cqe &cqe : completions)
+  {
+    const uint32_t id = static_cast<uint32_t>(cqe.user_data);
+    std::map<uint32_t, CompletionCallback>::const_iterator it = handlers_.find(id);
+    if (it == handlers_.end())
+    {
+      // 连接已经没了，缓冲区要还回去
+      if (cqe.flags & IORING_CQE_F_BUFFER)
+      {
+        recycleBuffer(cqe);
+      }
+      continue;
+    }
+    // 拷贝一份，回调里可能会removeCompletionHandler
+    CompletionCallback cb(it->second);
+    cb(cqe);
+  }
+  if (completions_.empty())
+  {
+    // 留着容量
+    completions.clear();
+    completions_.swap(completions);
+  }
+}
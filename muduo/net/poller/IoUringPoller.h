@@ -0,0 +1,115 @@
+#ifndef MUDUO_NET_POLLER_IOURINGPOLLER_H
+#define MUDUO_NET_POLLER_IOURINGPOLLER_H
+
+#include "muduo/net/Poller.h"
+#include "muduo/net/poller/IoUring.h"
+
+#include <bitset>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace muduo
+{
+namespace net
+{
+///
+/// IO Multiplexing with io_uring(7) IORING_OP_POLL_ADD.
+///
+/// updateChannel/removeChannel only queue SQEs, the interest changes of
+/// a whole iteration go to the kernel together with the wait, in one io_uring_enter(2).
+/// Selected by MUDUO_USE_IOURING, falls back to epoll if valid() is false.
+///
+/// It also runs completion-based I/O for TcpConnection::setProactor:
+/// SQEs tagged with a handler id, whose CQEs are handed back to that handler
+/// in the event handling phase, and a group of provided buffers for recv.
+///
+class IoUringPoller : public Poller
+{
+ public:
+  IoUringPoller(EventLoop *loop);
+  ~IoUringPoller() override;
+
+  /// false if the kernel doesn't support io_uring, or it's forbidden (seccomp)
+  bool valid() const { return ring_.valid(); }
+
+  Timestamp poll(int timeoutMs, ChannelList *activeChannels) override;
+  void updateChannel(Channel *channel) override;
+  void removeChannel(Channel *channel) override;
+
+  typedef std::function<void(const struct io_uring_cqe &)> CompletionCallback;
+
+  static const uint16_t kBufferGroup = 0;
+  static const unsigned kNumBuffers = 256;
+  static const size_t kBufferSize = 16 * 1024;
+
+  /// Hands the provided buffers to the kernel on first call.
+  /// @return false if the ring is not valid
+  bool enableProactor();
+
+  /// Completions of SQEs from prepareOp(id, ...) are passed to cb, in the loop's event handling phase.
+  uint32_t addCompletionHandler(const CompletionCallback &cb);
+  /// Later completions for id are dropped, their provided buffers recycled.
+  void removeCompletionHandler(uint32_t id);
+  /// A zeroed SQE whose completion goes to handler @c id, with @c op to tell operations apart.
+  struct io_uring_sqe *prepareOp(uint32_t id, uint8_t op);
+  /// Cancels the operation prepared as (id, op), it completes with -ECANCELED.
+  void cancelOp(uint32_t id, uint8_t op);
+  static uint8_t opOf(const struct io_uring_cqe &cqe) { return static_cast<uint8_t>(cqe.user_data >> 32); }
+
+  /// The provided buffer a recv completion picked, IORING_CQE_F_BUFFER must be set.
+  const char *providedBuffer(const struct io_uring_cqe &cqe) const;
+  /// Gives the buffer of cqe back to the kernel.
+  void recycleBuffer(const struct io_uring_cqe &cqe);
+
+  /// Multishot recv needs Linux 6.0, turned off after the first EINVAL.
+  bool multishotRecv() const { return multishotRecv_; }
+  void disableMultishotRecv() { multishotRecv_ = false; }
+
+ private:
+  static const unsigned kRingEntries = 256;
+
+  // 每个fd一项，下标就是fd
+  struct PollState
+  {
+    PollState() : channel(NULL), seq(0), armed(false), dirty(false), armedEvents(0) {}
+
+    Channel *channel;
+    uint32_t seq;  // 每次撤掉都加一，旧的CQE对不上就丢掉
+    bool armed;    // 有一个POLL_ADD在内核里
+    bool dirty;    // 在dirtyFds_里，等poll()的时候再提交
+    int armedEvents;
+  };
+
+  PollState &state(int fd);
+  void markDirty(int fd);
+  void disarm(int fd);
+  void applyChanges();
+  void fillActiveChannels(ChannelList *activeChannels);
+  struct io_uring_sqe *getSqe();
+  void provideBuffers(int bid, int count);
+  void dispatchCompletions();
+  void cancelInflightOps();
+
+  EventLoop *loop_;
+  IoUring ring_;
+  std::vector<PollState> states_;
+  std::vector<int> dirtyFds_;
+  std::vector<struct io_uring_cqe> reaped_;  // SQ满的时候为了腾地方提前收下的CQE，下一轮处理
+
+  // proactor
+  std::unique_ptr<char[]> buffers_;  // kNumBuffers个provided buffer，下标就是bid
+  bool multishotRecv_;
+  uint32_t nextHandlerId_;
+  // 在ring_之前析构，handler可能持有连接；析构函数先取消并收回内核里的操作，它们才能析构
+  std::map<uint32_t, CompletionCallback> handlers_;
+  int64_t inflightOps_;       // prepareOp之后还没有收到最后一个CQE的
+  std::bitset<256> opsUsed_;  // prepareOp用过的op
+  std::vector<struct io_uring_cqe> completions_;  // 这一轮的完成事件，由dispatchChannel_分发
+  std::unique_ptr<Channel> dispatchChannel_;
+};
+
+}  // namespace net
+}  // namespace muduo
+#endif  // MUDUO_NET_POLLER_IOURINGPOLLER_H
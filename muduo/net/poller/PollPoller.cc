@@ -49,9 +49,8 @@ void PollPoller::fillActiveChannels(int numEvents, ChannelList *activeChannels)
     {
       --numEvents;
       // 根据fd找到channel
-      ChannelMap::const_iterator ch = channels_.find(pfd->fd);
-      assert(ch != channels_.end());
-      Channel *channel = ch->second;
+      Channel *channel = channels_.find(pfd->fd);
+      assert(channel != NULL);
       assert(channel->fd() == pfd->fd);
       // 把revents保存到channel里面
       channel->set_revents(pfd->revents);
@@ -68,7 +67,7 @@ void PollPoller::updateChannel(Channel *channel)
   if (channel->index() < 0)
   {
     // a new one, add to pollfds_
-    assert(channels_.find(channel->fd()) == channels_.end());
+    assert(channels_.find(channel->fd()) == NULL);
     // 保存一个和channel匹配的pollfd
     struct pollfd pfd;
     pfd.fd = channel->fd();
@@ -78,13 +77,12 @@ void PollPoller::updateChannel(Channel *channel)
     int idx = static_cast<int>(pollfds_.size()) - 1;
     // 为新加入的channel分配idx
     channel->set_index(idx);
-    channels_[pfd.fd] = channel;
+    channels_.insert(pfd.fd, channel);
   }
   else
   {
     // update existing one
-    assert(channels_.find(channel->fd()) != channels_.end());
-    assert(channels_[channel->fd()] == channel);
+    assert(channels_.find(channel->fd()) == channel);
     int idx = channel->index();
     assert(0 <= idx && idx < static_cast<int>(pollfds_.size()));
     struct pollfd &pfd = pollfds_[idx];
@@ -104,8 +102,7 @@ void PollPoller::removeChannel(Channel *channel)
 {
   Poller::assertInLoopThread();
   LOG_TRACE << "fd = " << channel->fd();
-  assert(channels_.find(channel->fd()) != channels_.end());
-  assert(channels_[channel->fd()] == channel);
+  assert(channels_.find(channel->fd()) == channel);
   assert(channel->isNoneEvent());
   int idx = channel->index();
   assert(0 <= idx && idx < static_cast<int>(pollfds_.size()));
@@ -133,7 +130,7 @@ void PollPoller::removeChannel(Channel *channel)
       channelAtEnd = -channelAtEnd - 1;
     }
     // 更新被交换的pollfd的index
-    channels_[channelAtEnd]->set_index(idx);
+    channels_.find(channelAtEnd)->set_index(idx);
     // 删除不需要的pollfd
     pollfds_.pop_back();
   }
@@ -0,0 +1,19 @@
+#include "muduo/net/TimerQueue.h"
+#include "muduo/net/timer/SetTimerQueue.h"
+#include "muduo/net/timer/TimingWheelTimerQueue.h"
+
+#include <stdlib.h>
+
+using namespace muduo::net;
+
+TimerQueue *TimerQueue::newDefaultTimerQueue(EventLoop *loop)
+{
+  if (::getenv("MUDUO_USE_TIMING_WHEEL"))
+  {
+    return new TimingWheelTimerQueue(loop);
+  }
+  else
+  {
+    return new SetTimerQueue(loop);
+  }
+}
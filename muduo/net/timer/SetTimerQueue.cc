@@ -0,0 +1,172 @@
+#ifndef __STDC_LIMIT_MACROS
+#define __STDC_LIMIT_MACROS
+#endif
+
+#include "muduo/net/timer/SetTimerQueue.h"
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/Timer.h"
+#include "muduo/net/TimerId.h"
+
+#include <algorithm>
+
+using namespace muduo;
+using namespace muduo::net;
+
+SetTimerQueue::SetTimerQueue(EventLoop *loop) : TimerQueue(loop), timers_(), callingExpiredTimers_(false) {}
+
+SetTimerQueue::~SetTimerQueue()
+{
+  // do not remove channel, since we're in EventLoop::dtor();
+  for (const Entry &timer : timers_)
+  {
+    delete timer.second;
+  }
+}
+
+TimerId SetTimerQueue::addTimer(TimerCallback cb, Timestamp when, double interval, double slack)
+{
+  Timer *timer = new Timer(std::move(cb), when, interval, slack);
+  // runInLoop是线程安全的，addTimer如果被其他线程调用，那么会queueInLoop
+  // 后续运行addTimerLoop的线程一定是TimerQueue归属的EventLoop
+  loop_->runInLoop(std::bind(&SetTimerQueue::addTimerInLoop, this, timer));
+  return TimerId(timer, timer->sequence());
+}
+
+void SetTimerQueue::cancel(TimerId timerId)
+{
+  // 线程安全
+  loop_->runInLoop(std::bind(&SetTimerQueue::cancelInLoop, this, timerId));
+}
+
+void SetTimerQueue::addTimerInLoop(Timer *timer)
+{
+  loop_->assertInLoopThread();
+  // timer会插入到std::set里面
+  insert(timer);
+  // timerFd设置的时间比这个timer的容许范围晚，才重新设置
+  armTimerfd(timer->expiration(), timer->latest());
+}
+
+void SetTimerQueue::cancelInLoop(TimerId timerId)
+{
+  loop_->assertInLoopThread();
+  assert(timers_.size() == activeTimers_.size());
+  ActiveTimer timer(timerOf(timerId), sequenceOf(timerId));
+  ActiveTimerSet::iterator it = activeTimers_.find(timer);
+  if (it != activeTimers_.end())  // 情况一：待删除的timer在激活队列里
+  {
+    // std::set的erase返回的是删除的元素个数
+    size_t n = timers_.erase(Entry(it->first->expiration(), it->first));
+    assert(n == 1);
+    (void) n;
+    delete it->first;  // FIXME: no delete please
+    activeTimers_.erase(it);
+  }
+  else if (callingExpiredTimers_)  // 情况二：待删除的timer不在激活队列里，但是还没调用回调函数
+  {
+    // 因为有可能是用户的timer function取消当前的timer
+    // 这两个回调function都是在handleEvent阶段处理的
+    cancelingTimers_.insert(timer);
+  }
+  assert(timers_.size() == activeTimers_.size());
+}
+
+void SetTimerQueue::handleExpired(Timestamp now)
+{
+  // 获取所有的超时Entry
+  std::vector<Entry> expired = getExpired(now);
+
+  callingExpiredTimers_ = true;
+  cancelingTimers_.clear();
+  // safe to callback outside critical section
+  for (const Entry &it : expired)
+  {
+    // 调用超时的回调函数
+    it.second->run();
+  }
+  callingExpiredTimers_ = false;
+
+  reset(expired, now);
+}
+
+std::vector<SetTimerQueue::Entry> SetTimerQueue::getExpired(Timestamp now)
+{
+  assert(timers_.size() == activeTimers_.size());
+  std::vector<Entry> expired;
+  Entry sentry(now, reinterpret_cast<Timer *>(UINTPTR_MAX));
+  // 从set里面找到第一个 > 当前时间戳的timer的位置
+  TimerList::iterator end = timers_.lower_bound(sentry);
+  assert(end == timers_.end() || now < end->first);
+  // 把超时的timer全部拷贝到expired容器内
+  std::copy(timers_.begin(), end, back_inserter(expired));
+  // 把set的超时时间全部删除
+  timers_.erase(timers_.begin(), end);
+
+  for (const Entry &it : expired)
+  {
+    ActiveTimer timer(it.second, it.second->sequence());
+    size_t n = activeTimers_.erase(timer);
+    assert(n == 1);
+    (void) n;
+  }
+
+  assert(timers_.size() == activeTimers_.size());
+  return expired;
+}
+
+void SetTimerQueue::reset(const std::vector<Entry> &expired, Timestamp now)
+{
+  for (const Entry &it : expired)
+  {
+    ActiveTimer timer(it.second, it.second->sequence());
+    // timer是重复触发的，且没有被取消
+    if (it.second->repeat() && cancelingTimers_.find(timer) == cancelingTimers_.end())
+    {
+      it.second->restart(now);  // 重置超时时间
+      insert(it.second);        // 加入激活序列
+    }
+    else  // 说明timer是一次性的，或者被取消了
+    {
+      // FIXME move to a free list
+      delete it.second;  // FIXME: no delete please
+    }
+  }
+
+  if (!timers_.empty())
+  {
+    // 从最早的timer开始，把能一起触发的timer算成一组，按组里最早的latest设置timerFd
+    // 这一组下次醒来都会到期，遍历的开销算在到期里面
+    TimerList::iterator it = timers_.begin();
+    const Timestamp earliest = it->first;
+    Timestamp latest = it->second->latest();
+    for (++it; it != timers_.end() && !(latest < it->first); ++it)
+    {
+      latest = std::min(latest, it->second->latest());
+    }
+    armTimerfd(earliest, latest);
+  }
+}
+
+void SetTimerQueue::insert(Timer *timer)
+{
+  loop_->assertInLoopThread();
+  assert(timers_.size() == activeTimers_.size());
+  Timestamp when = timer->expiration();
+  {
+    // std::set是基于红黑树的平衡二叉树，元素是唯一的
+    // std::set的insert函数，返回值为std::pair类型
+    // 若插入成功，返回插入位置的迭代器及true
+    // 若插入失败，返回与当前插入元素相同的元素的位置的迭代器及false
+    std::pair<TimerList::iterator, bool> result = timers_.insert(Entry(when, timer));
+    assert(result.second);
+    (void) result;
+  }
+  {
+    std::pair<ActiveTimerSet::iterator, bool> result = activeTimers_.insert(ActiveTimer(timer, timer->sequence()));
+    assert(result.second);
+    (void) result;
+  }
+
+  assert(timers_.size() == activeTimers_.size());
+}
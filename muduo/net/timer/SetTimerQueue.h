@@ -0,0 +1,54 @@
+#ifndef MUDUO_NET_TIMER_SETTIMERQUEUE_H
+#define MUDUO_NET_TIMER_SETTIMERQUEUE_H
+
+#include <set>
+#include <vector>
+
+#include "muduo/net/TimerQueue.h"
+
+namespace muduo
+{
+namespace net
+{
+///
+/// Timers sorted by expiration in a std::set, O(log n) add and cancel.
+///
+class SetTimerQueue : public TimerQueue
+{
+ public:
+  explicit SetTimerQueue(EventLoop *loop);
+  ~SetTimerQueue() override;
+
+  TimerId addTimer(TimerCallback cb, Timestamp when, double interval, double slack = 0.0) override;
+  void cancel(TimerId timerId) override;
+
+ private:
+  // FIXME: use unique_ptr<Timer> instead of raw pointers.
+  // This requires heterogeneous comparison lookup (N3465) from C++14
+  // so that we can find an T* in a set<unique_ptr<T>>.
+  typedef std::pair<Timestamp, Timer *> Entry;
+  typedef std::set<Entry> TimerList;
+  typedef std::pair<Timer *, int64_t> ActiveTimer;
+  typedef std::set<ActiveTimer> ActiveTimerSet;
+
+  void addTimerInLoop(Timer *timer);
+  void cancelInLoop(TimerId timerId);
+  void handleExpired(Timestamp now) override;
+  // move out all expired timers
+  std::vector<Entry> getExpired(Timestamp now);
+  void reset(const std::vector<Entry> &expired, Timestamp now);
+
+  void insert(Timer *timer);
+
+  // Timer list sorted by expiration
+  TimerList timers_;  // 根据超时时间戳从小到大排序
+
+  // for cancel()
+  ActiveTimerSet activeTimers_;
+  bool callingExpiredTimers_; /* atomic */
+  ActiveTimerSet cancelingTimers_;
+};
+
+}  // namespace net
+}  // namespace muduo
+#endif  // MUDUO_NET_TIMER_SETTIMERQUEUE_H
@@ -0,0 +1,401 @@
+#include "muduo/net/timer/TimingWheelTimerQueue.h"
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/Timer.h"
+
+#include <algorithm>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// 和Linux原来的定时器轮一样：第一层256个slot，每个slot一个tick；
+// 往上每层64个slot，每个slot是下一层转一圈的时间。
+// 第一层转完一圈时，把第二层当前slot里的timer重新放到第一层，依此类推（cascade）。
+// 加入和取消都是链表操作，到期时每个timer最多被搬kLevels-1次。
+
+namespace
+{
+int shiftOf(int level)
+{
+  // level >= 1
+  return 8 + 6 * (level - 1);
+}
+
+}  // namespace
+
+struct TimingWheelTimerQueue::Node : Link, Timer
+{
+  enum State
+  {
+    kIdle,     // 不在轮子里：新建的，或者在freeList_里
+    kPending,  // 在某个slot里
+    kExpired,  // 到期了，回调还没跑完
+  };
+
+  Node(TimerCallback cb, Timestamp when, double interval, double slack)
+      : Timer(std::move(cb), when, interval, slack), state(kIdle), canceled(false), slot(-1), tick(0), latestTick(0)
+  {
+    prev = next = NULL;
+  }
+
+  State state;
+  bool canceled;  // 到期以后回调里被取消，不再重复
+  int slot;
+  int64_t tick;        // 到期的tick，向上取整
+  int64_t latestTick;  // 最晚可以触发的tick，slack为0时就是tick
+};
+
+const int TimingWheelTimerQueue::kLevels;
+const int TimingWheelTimerQueue::kRootBits;
+const int TimingWheelTimerQueue::kLevelBits;
+const int TimingWheelTimerQueue::kRootSlots;
+const int TimingWheelTimerQueue::kLevelSlots;
+const int TimingWheelTimerQueue::kSlots;
+
+TimingWheelTimerQueue::TimingWheelTimerQueue(EventLoop *loop, int tickMicroseconds)
+    : TimerQueue(loop),
+      tickMicroseconds_(tickMicroseconds),
+      currentTick_(Timestamp::now().microSecondsSinceEpoch() / tickMicroseconds),
+      size_(0),
+      freeList_(NULL)
+{
+  assert(tickMicroseconds > 0);
+  for (Link &head : slots_)
+  {
+    head.prev = head.next = &head;
+  }
+  memZero(occupied_, sizeof occupied_);
+}
+
+TimingWheelTimerQueue::~TimingWheelTimerQueue()
+{
+  for (Link &head : slots_)
+  {
+    Link *link = head.next;
+    while (link != &head)
+    {
+      Link *next = link->next;
+      delete static_cast<Node *>(link);
+      link = next;
+    }
+  }
+  while (freeList_)
+  {
+    Node *next = static_cast<Node *>(freeList_->next);
+    delete freeList_;
+    freeList_ = next;
+  }
+}
+
+TimerId TimingWheelTimerQueue::addTimer(TimerCallback cb, Timestamp when, double interval, double slack)
+{
+  if (loop_->isInLoopThread())
+  {
+    Node *node = newNode(std::move(cb), when, interval, slack);
+    addTimerInLoop(node);
+    return TimerId(node, node->sequence());
+  }
+  // freeList_只在loop线程里用，其他线程new一个，到期以后一样回收
+  Node *node = new Node(std::move(cb), when, interval, slack);
+  // 先取sequence，放进队列以后这个节点可能马上到期、被回收复用
+  TimerId timerId(node, node->sequence());
+  loop_->queueInLoop(std::bind(&TimingWheelTimerQueue::addTimerInLoop, this, node));
+  return timerId;
+}
+
+void TimingWheelTimerQueue::cancel(TimerId timerId)
+{
+  // 线程安全
+  loop_->runInLoop(std::bind(&TimingWheelTimerQueue::cancelInLoop, this, timerId));
+}
+
+TimingWheelTimerQueue::Node *TimingWheelTimerQueue::newNode(TimerCallback cb, Timestamp when, double interval, double slack)
+{
+  if (freeList_ == NULL)
+  {
+    return new Node(std::move(cb), when, interval, slack);
+  }
+  Node *node = freeList_;
+  freeList_ = static_cast<Node *>(node->next);
+  node->reset(std::move(cb), when, interval, slack);
+  node->canceled = false;
+  return node;
+}
+
+void TimingWheelTimerQueue::recycle(Node *node)
+{
+  // 马上释放回调绑定的资源，sequence也变了，旧的TimerId对不上
+  node->reset(TimerCallback(), Timestamp::invalid(), 0.0);
+  node->state = Node::kIdle;
+  node->next = freeList_;
+  freeList_ = node;
+}
+
+void TimingWheelTimerQueue::addTimerInLoop(Node *node)
+{
+  loop_->assertInLoopThread();
+  setTicks(node);
+  place(node);
+  // 不用找下一个slot，O(1)
+  armTimerfd(timeOf(node->tick), timeOf(node->latestTick));
+}
+
+void TimingWheelTimerQueue::cancelInLoop(TimerId timerId)
+{
+  loop_->assertInLoopThread();
+  // 节点不会在TimerQueue析构之前释放，可以直接比较sequence
+  Node *node = static_cast<Node *>(timerOf(timerId));
+  if (node == NULL || node->sequence() != sequenceOf(timerId))
+  {
+    return;
+  }
+  if (node->state == Node::kPending)
+  {
+    unlink(node);
+    recycle(node);
+  }
+  else if (node->state == Node::kExpired)
+  {
+    // 用户的timer function取消当前的timer
+    node->canceled = true;
+  }
+}
+
+void TimingWheelTimerQueue::handleExpired(Timestamp now)
+{
+  std::vector<Node *> expired;
+  expired.swap(expired_);
+  advance(now.microSecondsSinceEpoch() / tickMicroseconds_, &expired);
+
+  for (Node *node : expired)
+  {
+    node->run();
+  }
+
+  for (Node *node : expired)
+  {
+    if (node->repeat() && !node->canceled)
+    {
+      node->restart(now);
+      setTicks(node);
+      place(node);
+    }
+    else
+    {
+      recycle(node);
+    }
+  }
+  expired.clear();
+  expired_.swap(expired);
+  rearm();
+}
+
+int64_t TimingWheelTimerQueue::tickOf(Timestamp when) const
+{
+  // 向上取整，不会提前触发
+  return (when.microSecondsSinceEpoch() + tickMicroseconds_ - 1) / tickMicroseconds_;
+}
+
+void TimingWheelTimerQueue::setTicks(Node *node) const
+{
+  node->tick = tickOf(node->expiration());
+  // 向下取整，不会晚于latest
+  node->latestTick = std::max(node->tick, node->latest().microSecondsSinceEpoch() / tickMicroseconds_);
+}
+
+void TimingWheelTimerQueue::place(Node *node)
+{
+  int64_t tick = node->tick;
+  int64_t delta = tick - currentTick_;
+  int slot;
+  if (delta < kRootSlots)
+  {
+    // 已经过期的放到下一个要处理的slot
+    if (delta < 0)
+    {
+      tick = currentTick_;
+    }
+    slot = static_cast<int>(tick & (kRootSlots - 1));
+  }
+  else
+  {
+    const int64_t kMaxDelta = (static_cast<int64_t>(1) << shiftOf(kLevels)) - 1;
+    if (delta > kMaxDelta)
+    {
+      // 超出范围的先放在最远的位置，轮到的时候再按真实的tick放
+      tick = currentTick_ + kMaxDelta;
+      delta = kMaxDelta;
+    }
+    int level = 1;
+    while (delta >= static_cast<int64_t>(1) << shiftOf(level + 1))
+    {
+      ++level;
+    }
+    slot = kRootSlots + (level - 1) * kLevelSlots + static_cast<int>((tick >> shiftOf(level)) & (kLevelSlots - 1));
+  }
+
+  Link &head = slots_[slot];
+  node->prev = head.prev;
+  node->next = &head;
+  head.prev->next = node;
+  head.prev = node;
+  occupied_[slot >> 6] |= static_cast<uint64_t>(1) << (slot & 63);
+  node->slot = slot;
+  node->state = Node::kPending;
+  ++size_;
+}
+
+void TimingWheelTimerQueue::unlink(Node *node)
+{
+  assert(node->state == Node::kPending);
+  node->prev->next = node->next;
+  node->next->prev = node->prev;
+  Link &head = slots_[node->slot];
+  if (head.next == &head)
+  {
+    occupied_[node->slot >> 6] &= ~(static_cast<uint64_t>(1) << (node->slot & 63));
+  }
+  node->prev = node->next = NULL;
+  node->slot = -1;
+  node->state = Node::kIdle;
+  --size_;
+}
+
+void TimingWheelTimerQueue::cascade(int level, int index)
+{
+  Link &head = slots_[kRootSlots + (level - 1) * kLevelSlots + index];
+  while (head.next != &head)
+  {
+    Node *node = static_cast<Node *>(head.next);
+    unlink(node);
+    place(node);
+  }
+}
+
+void TimingWheelTimerQueue::advance(int64_t targetTick, std::vector<Node *> *expired)
+{
+  while (currentTick_ <= targetTick)
+  {
+    if (size_ == 0)
+    {
+      currentTick_ = targetTick + 1;
+      break;
+    }
+    const int index = static_cast<int>(currentTick_ & (kRootSlots - 1));
+    if (index == 0)
+    {
+      // 第一层转完一圈，上一层的当前slot搬下来，上一层也转完一圈就继续往上
+      for (int level = 1; level < kLevels; ++level)
+      {
+        const int i = static_cast<int>((currentTick_ >> shiftOf(level)) & (kLevelSlots - 1));
+        cascade(level, i);
+        if (i != 0)
+        {
+          break;
+        }
+      }
+    }
+
+    Link &head = slots_[index];
+    while (head.next != &head)
+    {
+      Node *node = static_cast<Node *>(head.next);
+      unlink(node);
+      node->state = Node::kExpired;
+      expired->push_back(node);
+    }
+    ++currentTick_;
+
+    // 跳过这一圈里空的slot，最远跳到下一次cascade
+    if ((currentTick_ & (kRootSlots - 1)) != 0)
+    {
+      const int next = findRootSlot(static_cast<int>(currentTick_ & (kRootSlots - 1)), false);
+      const int64_t roundStart = currentTick_ & ~static_cast<int64_t>(kRootSlots - 1);
+      const int64_t jump = next >= 0 ? roundStart + next : roundStart + kRootSlots;
+      currentTick_ = std::min(jump, targetTick + 1);
+    }
+  }
+}
+
+int TimingWheelTimerQueue::findRootSlot(int from, bool wrap) const
+{
+  const int kWords = kRootSlots / 64;
+  // wrap时多看一次起始的那个word，前半截是下一圈的
+  const int words = wrap ? kWords + 1 : kWords - (from >> 6);
+  for (int i = 0; i < words; ++i)
+  {
+    const int w = ((from >> 6) + i) % kWords;
+    uint64_t bits = occupied_[w];
+    if (i == 0)
+    {
+      bits &= ~static_cast<uint64_t>(0) << (from & 63);
+    }
+    if (bits)
+    {
+      return w * 64 + __builtin_ctzll(bits);
+    }
+  }
+  return -1;
+}
+
+int64_t TimingWheelTimerQueue::nextTick(int64_t *cascadeTick) const
+{
+  if (size_ == 0)
+  {
+    return -1;
+  }
+  int64_t next = INT64_MAX;
+  const int index = static_cast<int>(currentTick_ & (kRootSlots - 1));
+  const int slot = findRootSlot(index, true);
+  if (slot >= 0)
+  {
+    next = currentTick_ + ((slot - index) & (kRootSlots - 1));
+  }
+  // 上面几层只知道什么时候cascade，醒来搬下来再重新设置
+  for (int level = 1; level < kLevels; ++level)
+  {
+    const uint64_t bits = occupied_[(kRootSlots >> 6) + level - 1];
+    if (bits == 0)
+    {
+      continue;
+    }
+    const int shift = shiftOf(level);
+    // 下一次cascade这一层的时候，这一层的下标
+    const int64_t round = (currentTick_ + (static_cast<int64_t>(1) << shift) - 1) >> shift;
+    const int i = static_cast<int>(round & (kLevelSlots - 1));
+    const uint64_t rotated = i == 0 ? bits : (bits >> i) | (bits << (64 - i));
+    const int64_t tick = (round + __builtin_ctzll(rotated)) << shift;
+    next = std::min(next, tick);
+    *cascadeTick = std::min(*cascadeTick, tick);
+  }
+  return next;
+}
+
+void TimingWheelTimerQueue::rearm()
+{
+  int64_t cascadeTick = INT64_MAX;
+  const int64_t next = nextTick(&cascadeTick);
+  if (next < 0)
+  {
+    return;
+  }
+  // 从下一个非空的slot开始，latest之前的slot都会在这次醒来时到期，
+  // 一起算进这一组。上面几层的timer搬下来之前看不到，latest不超过下一次cascade
+  int64_t latest = cascadeTick;
+  const int index = static_cast<int>(currentTick_ & (kRootSlots - 1));
+  int slot = findRootSlot(index, true);
+  int64_t tick = slot >= 0 ? currentTick_ + ((slot - index) & (kRootSlots - 1)) : INT64_MAX;
+  while (tick <= latest && tick < currentTick_ + kRootSlots)
+  {
+    const Link &head = slots_[slot];
+    for (const Link *link = head.next; link != &head; link = link->next)
+    {
+      latest = std::min(latest, static_cast<const Node *>(link)->latestTick);
+    }
+    const int from = (slot + 1) & (kRootSlots - 1);
+    slot = findRootSlot(from, true);
+    tick += 1 + ((slot - from) & (kRootSlots - 1));
+  }
+  // 只往前调，timer被取消以后多醒一次没关系
+  armTimerfd(timeOf(next), timeOf(std::max(latest, next)));
+}
@@ -0,0 +1,78 @@
+#ifndef MUDUO_NET_TIMER_TIMINGWHEELTIMERQUEUE_H
+#define MUDUO_NET_TIMER_TIMINGWHEELTIMERQUEUE_H
+
+#include <vector>
+
+#include "muduo/net/TimerQueue.h"
+
+namespace muduo
+{
+namespace net
+{
+///
+/// Hierarchical timing wheel, O(1) add and cancel.
+///
+/// Expirations are rounded up to ticks (1ms by default), so timers fire up to
+/// one tick late but never early. Five levels cover 2^32 ticks (49 days at 1ms),
+/// farther timers wait in the last level and are placed again when it turns.
+/// Timer nodes are intrusive and recycled, never freed before the queue,
+/// so a TimerId is checked by its sequence without any lookup.
+/// The timerfd is armed for the next occupied slot, or the latest tick a group
+/// of timers with slack can share, and only moved earlier.
+///
+class TimingWheelTimerQueue : public TimerQueue
+{
+ public:
+  explicit TimingWheelTimerQueue(EventLoop *loop, int tickMicroseconds = 1000);
+  ~TimingWheelTimerQueue() override;
+
+  TimerId addTimer(TimerCallback cb, Timestamp when, double interval, double slack = 0.0) override;
+  void cancel(TimerId timerId) override;
+
+  /// Timers in the wheel. Loop thread only.
+  size_t size() const { return size_; }
+
+ private:
+  struct Link
+  {
+    Link *prev;
+    Link *next;
+  };
+  struct Node;
+
+  static const int kLevels = 5;
+  static const int kRootBits = 8;
+  static const int kLevelBits = 6;
+  static const int kRootSlots = 1 << kRootBits;
+  static const int kLevelSlots = 1 << kLevelBits;
+  static const int kSlots = kRootSlots + (kLevels - 1) * kLevelSlots;
+
+  Node *newNode(TimerCallback cb, Timestamp when, double interval, double slack);
+  void recycle(Node *node);
+  void addTimerInLoop(Node *node);
+  void cancelInLoop(TimerId timerId);
+  void handleExpired(Timestamp now) override;
+
+  int64_t tickOf(Timestamp when) const;
+  void setTicks(Node *node) const;
+  Timestamp timeOf(int64_t tick) const { return Timestamp(tick * tickMicroseconds_); }
+  void place(Node *node);
+  void unlink(Node *node);
+  void cascade(int level, int index);
+  void advance(int64_t targetTick, std::vector<Node *> *expired);
+  int findRootSlot(int from, bool wrap) const;
+  int64_t nextTick(int64_t *cascadeTick) const;  // 下一次cascade的tick放在cascadeTick
+  void rearm();
+
+  const int64_t tickMicroseconds_;
+  int64_t currentTick_;  // 下一个要处理的tick
+  size_t size_;
+  Link slots_[kSlots];              // 0-255是第一层，后面每层64个
+  uint64_t occupied_[kSlots / 64];  // 每个slot一位，找下一个非空的slot
+  Node *freeList_;                  // 回收的节点
+  std::vector<Node *> expired_;
+};
+
+}  // namespace net
+}  // namespace muduo
+#endif  // MUDUO_NET_TIMER_TIMINGWHEELTIMERQUEUE_H
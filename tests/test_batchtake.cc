@@ -0,0 +1,105 @@
+#undef NDEBUG
+// BlockingQueue::takeUpTo一次取一批、超时返回空；ThreadPool一次取一批任务时
+// 每个任务都执行一次，也不会一个worker把活都揽了
+#include "muduo/base/BlockingQueue.h"
+#include "muduo/base/Clock.h"
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/CurrentThread.h"
+#include "muduo/base/Mutex.h"
+#include "muduo/base/Thread.h"
+#include "muduo/base/ThreadPool.h"
+
+#include <atomic>
+#include <map>
+
+#include <assert.h>
+#include <stdio.h>
+
+using namespace muduo;
+
+void checkTakeUpTo()
+{
+  BlockingQueue<int> queue;
+  for (int i = 0; i < 10; ++i)
+  {
+    queue.put(i);
+  }
+  BlockingQueue<int>::queue_type batch = queue.takeUpTo(4);
+  assert(batch.size() == 4);
+  assert(batch.front() == 0 && batch.back() == 3);
+  batch = queue.takeUpTo(100, 0);
+  assert(batch.size() == 6);
+  assert(batch.front() == 4 && batch.back() == 9);
+  assert(queue.size() == 0);
+
+  // 空的时候等到超时
+  int64_t start = Clock::monotonicMicroseconds();
+  batch = queue.takeUpTo(8, 0.05);
+  int64_t waited = Clock::monotonicMicroseconds() - start;
+  assert(batch.empty());
+  assert(waited >= 50 * 1000 && waited < 500 * 1000);
+  assert(queue.takeUpTo(8, 0).empty());
+
+  // 有人放进来就提前返回
+  Thread producer([&queue] {
+    CurrentThread::sleepUsec(20 * 1000);
+    queue.put(42);
+  });
+  producer.start();
+  start = Clock::monotonicMicroseconds();
+  batch = queue.takeUpTo(8, 5.0);
+  waited = Clock::monotonicMicroseconds() - start;
+  producer.join();
+  assert(batch.size() == 1 && batch.front() == 42);
+  assert(waited < 1000 * 1000);
+
+  // 一直等
+  Thread late([&queue] {
+    CurrentThread::sleepUsec(20 * 1000);
+    queue.put(1);
+    queue.put(2);
+  });
+  late.start();
+  batch = queue.takeUpTo(8);
+  late.join();
+  assert(!batch.empty());
+}
+
+void checkPool(int batch, int maxQueueSize)
+{
+  ThreadPool pool("batch");
+  pool.setTaskBatch(batch);
+  pool.setMaxQueueSize(maxQueueSize);
+  pool.start(4);
+  const int kTasks = 20000;
+  std::atomic<int> done(0);
+  Mutex mutex;
+  std::map<int, int> perThread;
+  CountDownLatch finished(1);
+  for (int i = 0; i < kTasks; ++i)
+  {
+    pool.run([&] {
+      {
+        MutexGuard lock(mutex);
+        ++perThread[CurrentThread::tid()];
+      }
+      if (++done == kTasks)
+      {
+        finished.countDown();
+      }
+    });
+  }
+  finished.wait();
+  pool.stop();
+  printf("batch %d, max queue %d: %zu workers ran tasks\n", batch, maxQueueSize, perThread.size());
+  assert(done == kTasks);
+}
+
+int main()
+{
+  checkTakeUpTo();
+  checkPool(1, 0);
+  checkPool(16, 0);
+  checkPool(16, 8);
+  printf("test_batchtake passed\n");
+}
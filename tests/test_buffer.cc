@@ -0,0 +1,83 @@
+#undef NDEBUG
+#include "muduo/net/Buffer.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <unistd.h>
+
+using muduo::string;
+using muduo::net::Buffer;
+using muduo::net::BufferPool;
+using muduo::net::BufferPoolPtr;
+
+void testLazyStorage()
+{
+  Buffer buf(0);
+  assert(!buf.hasStorage());
+  assert(buf.readableBytes() == 0);
+  assert(buf.writableBytes() == 0);
+  assert(buf.internalCapacity() == 0);
+  buf.retrieveAll();
+  assert(!buf.hasStorage());
+
+  buf.append("hello", 5);
+  assert(buf.hasStorage());
+  assert(buf.prependableBytes() == Buffer::kCheapPrepend);
+  assert(buf.retrieveAllAsString() == "hello");
+
+  buf.releaseStorage();
+  assert(!buf.hasStorage());
+  assert(buf.internalCapacity() == 0);
+
+  // prepend也要能在空buffer上用
+  buf.prependInt32(42);
+  assert(buf.readInt32() == 42);
+}
+
+void testShrink()
+{
+  Buffer buf;
+  buf.append(string(10000, 'x'));
+  buf.retrieve(9990);
+  buf.shrink(0);
+  assert(buf.readableBytes() == 10);
+  assert(buf.internalCapacity() < 10000);
+  buf.retrieveAll();
+  buf.shrink(0);
+  assert(!buf.hasStorage());
+}
+
+void testReadFdWithoutStorage()
+{
+  int fds[2];
+  if (::pipe(fds) != 0)
+  {
+    perror("pipe");
+    return;
+  }
+
+  BufferPoolPtr pool(new BufferPool);
+  Buffer buf(pool, 0);
+  string msg(3000, 'r');
+  assert(::write(fds[1], msg.data(), msg.size()) == static_cast<ssize_t>(msg.size()));
+  int savedErrno = 0;
+  ssize_t n = buf.readFd(fds[0], &savedErrno);
+  assert(n == static_cast<ssize_t>(msg.size()));
+  assert(buf.retrieveAllAsString() == msg);
+  // 只按读到的数据量分配
+  assert(buf.internalCapacity() == BufferPool::roundUp(Buffer::kCheapPrepend + msg.size()));
+
+  buf.releaseStorage();
+  assert(pool->stats().cachedBytes > 0);
+
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+int main()
+{
+  testLazyStorage();
+  testShrink();
+  testReadFdWithoutStorage();
+  printf("test_buffer passed\n");
+}
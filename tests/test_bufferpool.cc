@@ -0,0 +1,108 @@
+#undef NDEBUG
+#include "muduo/net/Buffer.h"
+#include "muduo/net/BufferPool.h"
+#include "muduo/net/ChainBuffer.h"
+
+#include "muduo/base/Thread.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+using muduo::string;
+using muduo::net::Buffer;
+using muduo::net::BufferPool;
+using muduo::net::BufferPoolPtr;
+using muduo::net::ChainBuffer;
+
+void testRoundUp()
+{
+  assert(BufferPool::roundUp(1) == 1024);
+  assert(BufferPool::roundUp(1024) == 1024);
+  assert(BufferPool::roundUp(1025) == 2048);
+  assert(BufferPool::roundUp(BufferPool::kMaxBlockSize) == BufferPool::kMaxBlockSize);
+  assert(BufferPool::roundUp(BufferPool::kMaxBlockSize + 1) == BufferPool::kMaxBlockSize + 1);
+}
+
+void testReuse()
+{
+  BufferPoolPtr pool(new BufferPool);
+  char *p1 = pool->allocate(1500);
+  pool->deallocate(p1, 1500);
+  // 同一个size class，拿回同一块内存
+  char *p2 = pool->allocate(2000);
+  assert(p2 == p1);
+  pool->deallocate(p2, 2000);
+
+  BufferPool::Stats s = pool->stats();
+  assert(s.hits == 1);
+  assert(s.misses == 1);
+  assert(s.releases == 2);
+  assert(s.cachedBytes == 2048);
+}
+
+void testCap()
+{
+  BufferPoolPtr pool(new BufferPool(4096));
+  char *blocks[3];
+  for (int i = 0; i < 3; ++i)
+  {
+    blocks[i] = pool->allocate(2048);
+  }
+  for (int i = 0; i < 3; ++i)
+  {
+    pool->deallocate(blocks[i], 2048);
+  }
+  BufferPool::Stats s = pool->stats();
+  assert(s.releases == 2);
+  assert(s.frees == 1);
+  assert(s.cachedBytes == 4096);
+}
+
+void testForeignRelease()
+{
+  BufferPoolPtr pool(new BufferPool);
+  char *p = pool->allocate(1024);
+  muduo::Thread t([&] { pool->deallocate(p, 1024); });
+  t.start();
+  t.join();
+  BufferPool::Stats s = pool->stats();
+  assert(s.foreignReleases == 1);
+  assert(s.cachedBytes == 0);
+}
+
+void testBuffers()
+{
+  BufferPoolPtr pool(new BufferPool);
+  {
+    Buffer buf(pool);
+    buf.append(string(5000, 'x'));
+    assert(buf.readableBytes() == 5000);
+    ChainBuffer chain(pool);
+    chain.append(string(ChainBuffer::kBlockSize * 2, 'y'));
+    assert(chain.numBlocks() == 2);
+  }
+  BufferPool::Stats s = pool->stats();
+  assert(s.cachedBytes > 0);
+  int64_t misses = s.misses;
+
+  // 第二个连接复用第一个连接还回来的内存
+  {
+    Buffer buf(pool);
+    buf.append(string(5000, 'x'));
+    ChainBuffer chain(pool);
+    chain.append(string(ChainBuffer::kBlockSize * 2, 'y'));
+  }
+  s = pool->stats();
+  assert(s.misses == misses);
+  assert(!BufferPool::allStatsString().empty());
+}
+
+int main()
+{
+  testRoundUp();
+  testReuse();
+  testCap();
+  testForeignRelease();
+  testBuffers();
+  printf("test_bufferpool passed\n");
+}
@@ -0,0 +1,63 @@
+#undef NDEBUG
+// 打开空转后，跨线程投递的任务照常执行，空闲时loop会退回阻塞，空转比例不会到100%
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/Timestamp.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThread.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kPings = 2000;
+
+// 从投递到loop线程开始执行的延迟，取中位数
+double medianLatency(EventLoop *loop)
+{
+  std::vector<int64_t> latencies;
+  latencies.reserve(kPings);
+  for (int i = 0; i < kPings; ++i)
+  {
+    CountDownLatch latch(1);
+    Timestamp start(Timestamp::now());
+    int64_t latency = 0;
+    loop->queueInLoop([&] {
+      latency = Timestamp::now().microSecondsSinceEpoch() - start.microSecondsSinceEpoch();
+      latch.countDown();
+    });
+    latch.wait();
+    latencies.push_back(latency);
+  }
+  std::sort(latencies.begin(), latencies.end());
+  return static_cast<double>(latencies[kPings / 2]);
+}
+
+int main()
+{
+  {
+    EventLoopThread loopThread;
+    EventLoop *loop = loopThread.startLoop();
+    assert(loop->spinRatio() == 0.0);
+    printf("blocking   median latency %.0f us\n", medianLatency(loop));
+  }
+
+  {
+    EventLoopThread loopThread([](EventLoop *loop) { loop->setBusyPoll(1000); });
+    EventLoop *loop = loopThread.startLoop();
+    printf("busy poll  median latency %.0f us\n", medianLatency(loop));
+    assert(loop->spinRatio() > 0.0);
+    // 空闲超过空转时长就阻塞，不会一直占着CPU
+    ::usleep(300 * 1000);
+    const double ratio = loop->spinRatio();
+    printf("spin ratio %.2f%%\n", 100.0 * ratio);
+    assert(ratio < 1.0);
+    assert(EventLoop::allStatsString().find("busy_poll=on") != string::npos);
+  }
+  printf("test_busypoll passed\n");
+}
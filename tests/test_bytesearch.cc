@@ -0,0 +1,87 @@
+#undef NDEBUG
+#include "muduo/base/ByteSearch.h"
+#include "muduo/base/Types.h"
+
+#include <algorithm>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using muduo::string;
+namespace ByteSearch = muduo::ByteSearch;
+
+const char *expected(const string &hay, size_t begin, const char *needle, size_t len)
+{
+  const char *b = hay.data() + begin;
+  const char *e = hay.data() + hay.size();
+  const char *found = std::search(b, e, needle, needle + len);
+  return found == e ? NULL : found;
+}
+
+// 在不同的起始位置和长度上和std::search的结果比较，覆盖向量循环和尾部
+void testRandom()
+{
+  const char *needles[] = {"\n", "\r\n", "\r\n\r\n", "abc", "boundary--0123456789"};
+  srand(42);
+  for (int round = 0; round < 200; ++round)
+  {
+    size_t size = static_cast<size_t>(rand() % 300);
+    string hay(size, 'x');
+    for (size_t i = 0; i < size; ++i)
+    {
+      // 字母表很小，部分匹配很多
+      const char alphabet[] = "ab\r\nc-";
+      hay[i] = alphabet[rand() % 6];
+    }
+    if (size > 40 && rand() % 2)
+    {
+      hay.replace(size - 25, 20, needles[4]);
+    }
+    for (size_t begin = 0; begin <= std::min<size_t>(size, 40); ++begin)
+    {
+      const char *b = hay.data() + begin;
+      const char *e = hay.data() + hay.size();
+      assert(ByteSearch::findByte(b, e, '\n') == expected(hay, begin, "\n", 1));
+      assert(ByteSearch::findByte(b, e, 'c') == expected(hay, begin, "c", 1));
+      assert(ByteSearch::findCRLF(b, e) == expected(hay, begin, "\r\n", 2));
+      for (const char *needle : needles)
+      {
+        size_t len = strlen(needle);
+        assert(ByteSearch::find(b, e, needle, len) == expected(hay, begin, needle, len));
+      }
+    }
+  }
+}
+
+void testEmpty()
+{
+  assert(ByteSearch::findByte(NULL, NULL, '\n') == NULL);
+  assert(ByteSearch::findCRLF(NULL, NULL) == NULL);
+  assert(ByteSearch::find(NULL, NULL, "ab", 2) == NULL);
+  const char hay[] = "\r";
+  assert(ByteSearch::findCRLF(hay, hay + 1) == NULL);
+  // 空needle在开头匹配，范围是空的也一样，不管用哪个实现
+  assert(ByteSearch::find(hay, hay, "", 0) == hay);
+  assert(ByteSearch::find(hay, hay + 1, "", 0) == hay);
+  assert(ByteSearch::find(hay + 1, hay + 1, "", 0) == hay + 1);
+}
+
+int main()
+{
+  const char *impls[] = {"scalar", "sse2", "avx2"};
+  for (const char *impl : impls)
+  {
+    if (!ByteSearch::useImplementation(impl))
+    {
+      printf("%s not supported, skipped\n", impl);
+      continue;
+    }
+    assert(strcmp(ByteSearch::implementation(), impl) == 0);
+    testRandom();
+    testEmpty();
+  }
+  assert(!ByteSearch::useImplementation("neon"));
+  printf("test_bytesearch passed\n");
+}
@@ -0,0 +1,90 @@
+// 比较Buffer::findCRLF原来的std::search、memchr和ByteSearch各个实现
+#include "muduo/base/ByteSearch.h"
+#include "muduo/base/Timestamp.h"
+#include "muduo/base/Types.h"
+
+#include <algorithm>
+
+#include <stdio.h>
+#include <string.h>
+
+using muduo::string;
+using muduo::Timestamp;
+namespace ByteSearch = muduo::ByteSearch;
+
+const int kRounds = 2000;
+
+// 流水线的HTTP请求，每个请求都有若干个header
+string makeRequests(size_t total)
+{
+  const char request[] =
+      "GET /index.html HTTP/1.1\r\n"
+      "Host: www.example.com\r\n"
+      "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko)\r\n"
+      "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+      "Accept-Language: en-US,en;q=0.5\r\n"
+      "Connection: keep-alive\r\n"
+      "\r\n";
+  string data;
+  while (data.size() < total)
+  {
+    data += request;
+  }
+  return data;
+}
+
+template <typename Find>
+void bench(const char *name, const string &data, Find find)
+{
+  const char *end = data.data() + data.size();
+  size_t found = 0;
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < kRounds; ++i)
+  {
+    // 和HttpContext一样，一行一行地找
+    const char *p = data.data();
+    while (const char *q = find(p, end))
+    {
+      ++found;
+      p = q + 1;
+    }
+  }
+  double seconds = timeDifference(Timestamp::now(), start);
+  printf("%-24s %8.2f MiB/s  %zu matches\n", name, static_cast<double>(data.size()) * kRounds / seconds / 1024 / 1024, found);
+}
+
+void benchLines(const string &data)
+{
+  printf("--- lines (%zu bytes) ---\n", data.size());
+  bench("std::search CRLF", data, [](const char *b, const char *e) -> const char * {
+    static const char kCRLF[] = "\r\n";
+    const char *crlf = std::search(b, e, kCRLF, kCRLF + 2);
+    return crlf == e ? NULL : crlf;
+  });
+  bench("memchr LF", data, [](const char *b, const char *e) { return static_cast<const char *>(memchr(b, '\n', e - b)); });
+  bench("memmem CRLF", data, [](const char *b, const char *e) { return static_cast<const char *>(memmem(b, e - b, "\r\n", 2)); });
+
+  const char *impls[] = {"scalar", "sse2", "avx2"};
+  for (const char *impl : impls)
+  {
+    if (!ByteSearch::useImplementation(impl))
+    {
+      continue;
+    }
+    string name = string(impl) + " findCRLF";
+    bench(name.c_str(), data, ByteSearch::findCRLF);
+    name = string(impl) + " findByte LF";
+    bench(name.c_str(), data, [](const char *b, const char *e) { return ByteSearch::findByte(b, e, '\n'); });
+    name = string(impl) + " find CRLFCRLF";
+    bench(name.c_str(), data, [](const char *b, const char *e) { return ByteSearch::find(b, e, "\r\n\r\n", 4); });
+  }
+}
+
+int main()
+{
+  benchLines(makeRequests(64 * 1024));
+  // 一个很长的body，中间没有分隔符
+  string body(1024 * 1024, 'x');
+  body += "\r\n";
+  benchLines(body);
+}
@@ -0,0 +1,193 @@
+#undef NDEBUG
+#include "muduo/net/ChainBuffer.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+using muduo::string;
+using muduo::net::ChainBuffer;
+using muduo::net::SharedPayload;
+
+void testAppendRetrieve()
+{
+  ChainBuffer buf;
+  assert(buf.readableBytes() == 0);
+  assert(buf.numBlocks() == 0);
+
+  const string str(200, 'x');
+  buf.append(str);
+  assert(buf.readableBytes() == str.size());
+  assert(buf.numBlocks() == 1);
+
+  buf.retrieve(50);
+  assert(buf.readableBytes() == str.size() - 50);
+
+  buf.retrieveAll();
+  assert(buf.readableBytes() == 0);
+  assert(buf.numBlocks() == 0);
+}
+
+void testBigMessage()
+{
+  ChainBuffer buf;
+  // 大消息分散到多个block，不会拷贝成一整块连续内存
+  string big(ChainBuffer::kBlockSize * 3 + 100, 'y');
+  for (size_t i = 0; i < big.size(); ++i)
+  {
+    big[i] = static_cast<char>('a' + i % 26);
+  }
+  buf.append(big);
+  assert(buf.readableBytes() == big.size());
+  assert(buf.numBlocks() == 4);
+
+  struct iovec vec[ChainBuffer::kMaxIovec];
+  int iovcnt = buf.peekIovec(vec, ChainBuffer::kMaxIovec);
+  assert(iovcnt == 4);
+  string joined;
+  for (int i = 0; i < iovcnt; ++i)
+  {
+    joined.append(static_cast<const char *>(vec[i].iov_base), vec[i].iov_len);
+  }
+  assert(joined == big);
+
+  buf.retrieve(ChainBuffer::kBlockSize + 1);
+  assert(buf.numBlocks() == 3);
+  assert(buf.readableBytes() == big.size() - ChainBuffer::kBlockSize - 1);
+}
+
+void testWriteFd()
+{
+  int fds[2];
+  if (::pipe(fds) != 0)
+  {
+    perror("pipe");
+    return;
+  }
+
+  ChainBuffer buf;
+  string msg(ChainBuffer::kBlockSize + 10, 'z');
+  buf.append(msg);
+  buf.append("tail", 4);
+
+  int savedErrno = 0;
+  ssize_t n = buf.writeFd(fds[1], &savedErrno);
+  assert(n == static_cast<ssize_t>(msg.size() + 4));
+  assert(buf.readableBytes() == 0);
+
+  string received(msg.size() + 4, '\0');
+  ssize_t nr = 0;
+  while (nr < n)
+  {
+    ssize_t r = ::read(fds[0], &received[nr], received.size() - nr);
+    assert(r > 0);
+    nr += r;
+  }
+  assert(received == msg + "tail");
+
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+void testSharedPayload()
+{
+  SharedPayload payload(string(ChainBuffer::kBlockSize * 2, 'p'));
+  {
+    ChainBuffer buf1;
+    ChainBuffer buf2;
+    buf1.append("head", 4);
+    buf1.append(payload);
+    buf2.append(payload, 100);
+    // 两个buffer只持有引用，没有拷贝
+    assert(payload.useCount() == 3);
+    assert(buf1.readableBytes() == payload.size() + 4);
+    assert(buf2.readableBytes() == payload.size() - 100);
+
+    struct iovec vec[ChainBuffer::kMaxIovec];
+    int iovcnt = buf1.peekIovec(vec, ChainBuffer::kMaxIovec);
+    assert(iovcnt == 2);
+    assert(vec[1].iov_base == payload.data());
+
+    buf1.retrieve(4 + payload.size());
+    assert(payload.useCount() == 2);
+    buf2.retrieve(1);
+    assert(payload.useCount() == 2);
+  }
+  assert(payload.useCount() == 1);
+
+  // 短payload直接拷贝进最后一个block
+  SharedPayload small(muduo::StringPiece("tiny"));
+  ChainBuffer buf;
+  buf.append("head", 4);
+  buf.append(small);
+  assert(small.useCount() == 1);
+  assert(buf.numBlocks() == 1);
+  assert(buf.readableBytes() == 8);
+}
+
+// 文件区间和普通数据交错，顺序不能乱
+void testFileRegion()
+{
+  char path[] = "/tmp/test_chainbuffer_XXXXXX";
+  int fileFd = ::mkstemp(path);
+  assert(fileFd >= 0);
+  ::unlink(path);
+  string content(100000, 'f');
+  for (size_t i = 0; i < content.size(); ++i)
+  {
+    content[i] = static_cast<char>('A' + i % 26);
+  }
+  assert(::write(fileFd, content.data(), content.size()) == static_cast<ssize_t>(content.size()));
+
+  int fds[2];
+  if (::pipe2(fds, O_NONBLOCK) != 0)
+  {
+    perror("pipe");
+    return;
+  }
+
+  ChainBuffer buf;
+  buf.append("head", 4);
+  assert(buf.appendFile(fileFd, 10, 50000));
+  buf.append("middle", 6);
+  assert(buf.appendFile(fileFd, 60000, 40000));
+  ::close(fileFd);  // 已经dup过了
+  buf.append("tail", 4);
+  assert(buf.readableBytes() == 4 + 50000 + 6 + 40000 + 4);
+
+  struct iovec vec[ChainBuffer::kMaxIovec];
+  assert(buf.peekIovec(vec, ChainBuffer::kMaxIovec) == 1);
+
+  const string expected = "head" + content.substr(10, 50000) + "middle" + content.substr(60000, 40000) + "tail";
+  string received;
+  while (buf.readableBytes() > 0)
+  {
+    int savedErrno = 0;
+    ssize_t n = buf.writeFd(fds[1], &savedErrno);
+    assert(n > 0 || savedErrno == EAGAIN);
+    char tmp[65536];
+    ssize_t r;
+    while ((r = ::read(fds[0], tmp, sizeof tmp)) > 0)
+    {
+      received.append(tmp, r);
+    }
+  }
+  assert(received == expected);
+
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+int main()
+{
+  testAppendRetrieve();
+  testBigMessage();
+  testWriteFd();
+  testSharedPayload();
+  testFileRegion();
+  printf("test_chainbuffer passed\n");
+}
@@ -0,0 +1,168 @@
+// Poller里按fd找Channel：原来的std::map和按fd下标的ChannelTable
+// 1. 只比查找/增删，10k、100k、1M个fd
+// 2. 真实的Channel在loop里反复改关注的事件，fd个数受RLIMIT_NOFILE限制
+#include "muduo/base/Timestamp.h"
+#include "muduo/net/Channel.h"
+#include "muduo/net/ChannelTable.h"
+#include "muduo/net/EventLoop.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kOps = 4 * 1000 * 1000;
+
+// 打乱的fd序列，相邻两次访问不在一起，和大量连接各自活动的情况相近
+std::vector<int> randomFds(int n, int count)
+{
+  std::mt19937 gen(n);
+  std::uniform_int_distribution<int> dist(0, n - 1);
+  std::vector<int> fds(count);
+  for (int &fd : fds)
+  {
+    fd = dist(gen);
+  }
+  return fds;
+}
+
+template <typename Lookup>
+double mops(int ops, Lookup lookup)
+{
+  Timestamp start(Timestamp::now());
+  size_t found = lookup();
+  double seconds = timeDifference(Timestamp::now(), start);
+  if (found != static_cast<size_t>(ops))
+  {
+    printf("found %zu of %d\n", found, ops);
+    abort();
+  }
+  return ops / seconds / 1e6;
+}
+
+void benchTable(int n)
+{
+  std::vector<char> dummy(n);
+  std::map<int, Channel *> map;
+  ChannelTable table;
+  for (int fd = 0; fd < n; ++fd)
+  {
+    Channel *channel = reinterpret_cast<Channel *>(&dummy[fd]);
+    map[fd] = channel;
+    table.insert(fd, channel);
+  }
+  const std::vector<int> fds = randomFds(n, kOps);
+
+  // updateChannel里的检查：fd在不在，是不是同一个Channel
+  double mapLookup = mops(kOps, [&] {
+    size_t found = 0;
+    for (int fd : fds)
+    {
+      std::map<int, Channel *>::const_iterator it = map.find(fd);
+      found += it != map.end() && it->second == reinterpret_cast<Channel *>(&dummy[fd]);
+    }
+    return found;
+  });
+  double tableLookup = mops(kOps, [&] {
+    size_t found = 0;
+    for (int fd : fds)
+    {
+      found += table.find(fd) == reinterpret_cast<Channel *>(&dummy[fd]);
+    }
+    return found;
+  });
+
+  // 连接关闭又马上有新连接，拿到同一个fd：removeChannel + updateChannel(kNew)
+  double mapChurn = mops(kOps, [&] {
+    size_t found = 0;
+    for (int fd : fds)
+    {
+      found += map.erase(fd);
+      map[fd] = reinterpret_cast<Channel *>(&dummy[fd]);
+    }
+    return found;
+  });
+  double tableChurn = mops(kOps, [&] {
+    size_t found = 0;
+    for (int fd : fds)
+    {
+      found += table.erase(fd);
+      table.insert(fd, reinterpret_cast<Channel *>(&dummy[fd]));
+    }
+    return found;
+  });
+  printf("%8d fds   lookup map %7.1f table %7.1f Mops/s   erase+insert map %7.1f table %7.1f Mops/s\n", n, mapLookup,
+         tableLookup, mapChurn, tableChurn);
+}
+
+// 每次切换一个Channel的可写关注，走完整的Channel::update -> Poller::updateChannel
+void benchPoller(const char *name, int n)
+{
+  EventLoop loop;
+  std::vector<std::unique_ptr<Channel>> channels;
+  for (int i = 0; i < n; ++i)
+  {
+    int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd < 0)
+    {
+      break;
+    }
+    channels.emplace_back(new Channel(&loop, fd));
+    channels.back()->enableReading();
+  }
+  const int count = static_cast<int>(channels.size());
+  const std::vector<int> picks = randomFds(count, kOps / 4);
+
+  Timestamp start(Timestamp::now());
+  for (int i : picks)
+  {
+    Channel *channel = channels[i].get();
+    if (channel->isWriting())
+    {
+      channel->disableWriting();
+    }
+    else
+    {
+      channel->enableWriting();
+    }
+  }
+  double seconds = timeDifference(Timestamp::now(), start);
+  printf("%-6s %8d fds   %7.2f M updateChannel/s\n", name, count, static_cast<double>(picks.size()) / seconds / 1e6);
+
+  for (auto &channel : channels)
+  {
+    channel->disableAll();
+    channel->remove();
+    ::close(channel->fd());
+  }
+}
+
+int main()
+{
+  for (int n : {10 * 1000, 100 * 1000, 1000 * 1000})
+  {
+    benchTable(n);
+  }
+
+  // 真实fd能开多少开多少
+  struct rlimit rl;
+  ::getrlimit(RLIMIT_NOFILE, &rl);
+  rl.rlim_cur = rl.rlim_max;
+  ::setrlimit(RLIMIT_NOFILE, &rl);
+  const int n = static_cast<int>(std::min<rlim_t>(rl.rlim_cur - 100, 1000 * 1000));
+  ::unsetenv("MUDUO_USE_POLL");
+  ::unsetenv("MUDUO_USE_IOURING");
+  benchPoller("epoll", n);
+  ::setenv("MUDUO_USE_POLL", "1", 1);
+  benchPoller("poll", n);
+}
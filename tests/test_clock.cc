@@ -0,0 +1,110 @@
+#undef NDEBUG
+// 各个时钟和Timestamp::now()对得上；loop线程里Clock::loopTime()是poll返回的时间，
+// 日志和timer可以用它
+#include "muduo/base/Clock.h"
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+
+#include <algorithm>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+int64_t diffUs(Timestamp a, Timestamp b)
+{
+  return std::abs(a.microSecondsSinceEpoch() - b.microSecondsSinceEpoch());
+}
+
+string g_lastLine;
+
+void captureOutput(const char *msg, int len)
+{
+  g_lastLine.assign(msg, len);
+}
+
+void stdoutOutput(const char *msg, int len)
+{
+  fwrite(msg, 1, len, stdout);
+}
+
+void checkSources()
+{
+  assert(diffUs(Clock::realtime(), Timestamp::now()) < 1000);
+  // 粗的时钟是上一个tick的时间，只会落后
+  assert(!(addTime(Timestamp::now(), 0.001) < Clock::realtimeCoarse()));
+  assert(diffUs(Clock::realtimeCoarse(), Timestamp::now()) < 20 * 1000);
+
+  int64_t last = Clock::monotonicMicroseconds();
+  int64_t lastCoarse = Clock::monotonicCoarseMicroseconds();
+  for (int i = 0; i < 1000; ++i)
+  {
+    const int64_t now = Clock::monotonicMicroseconds();
+    const int64_t coarse = Clock::monotonicCoarseMicroseconds();
+    assert(now >= last && coarse >= lastCoarse);
+    last = now;
+    lastCoarse = coarse;
+  }
+
+  // 校准以后，TSC换算出来的时间和CLOCK_REALTIME差不到1ms
+  printf("tsc available: %s\n", Clock::tscAvailable() ? "yes" : "no");
+  int64_t worst = 0;
+  for (int i = 0; i < 20; ++i)
+  {
+    worst = std::max(worst, diffUs(Clock::tsc(), Clock::realtime()));
+    ::usleep(10 * 1000);
+    if (i == 10)
+    {
+      Clock::calibrateTsc();
+    }
+  }
+  printf("tsc worst drift %lld us\n", static_cast<long long>(worst));
+  assert(worst < 1000);
+}
+
+void checkLoopTime()
+{
+  // 没有loop的线程直接读时钟
+  assert(diffUs(Clock::loopTime(), Timestamp::now()) < 1000);
+
+  EventLoop loop;
+  loop.setCachedClock(true);
+  Logger::setOutput(captureOutput);
+  Logger::setClock(Clock::loopTime);
+  int fired = 0;
+  loop.runEvery(0.01, [&] {
+    assert(Clock::loopTime() == loop.pollReturnTime());
+    LOG_WARN << "tick";
+    // 日志的时间就是poll返回的时间，不是现在
+    assert(g_lastLine.compare(0, 24, loop.pollReturnTime().toFormattedString()) == 0);
+    ++fired;
+  });
+  // 从loop线程加的timer从poll返回的时间算起，不会比它更早触发
+  Timestamp base;
+  bool onTime = false;
+  loop.runAfter(0.05, [&] {
+    base = loop.pollReturnTime();
+    loop.runAfter(0.02, [&] { onTime = !(loop.pollReturnTime() < addTime(base, 0.02)); });
+  });
+  loop.runAfter(0.2, [&] { loop.quit(); });
+  loop.loop();
+  Logger::setClock(Timestamp::now);
+  Logger::setOutput(stdoutOutput);
+
+  printf("%d ticks with the cached clock\n", fired);
+  assert(fired >= 10);
+  assert(onTime);
+  // loop退出以后不再用旧的时间
+  assert(diffUs(Clock::loopTime(), Timestamp::now()) < 1000);
+}
+
+int main()
+{
+  checkSources();
+  checkLoopTime();
+  printf("test_clock passed\n");
+}
@@ -0,0 +1,47 @@
+// 各种时钟读一次要多少纳秒
+#include "muduo/base/Clock.h"
+#include "muduo/base/Timestamp.h"
+
+#include <functional>
+
+#include <stdio.h>
+#include <sys/time.h>
+#include <time.h>
+
+using namespace muduo;
+
+const int kCalls = 10 * 1000 * 1000;
+
+int64_t sink;  // 防止被优化掉
+
+void bench(const char *name, const std::function<int64_t()> &read)
+{
+  const int64_t start = Clock::monotonicMicroseconds();
+  int64_t sum = 0;
+  for (int i = 0; i < kCalls; ++i)
+  {
+    sum += read();
+  }
+  const int64_t elapsed = Clock::monotonicMicroseconds() - start;
+  sink += sum;
+  printf("%-28s %6.1f ns\n", name, static_cast<double>(elapsed) * 1000.0 / kCalls);
+}
+
+int main()
+{
+  printf("tsc available: %s\n", Clock::tscAvailable() ? "yes" : "no");
+  bench("gettimeofday", [] {
+    struct timeval tv;
+    ::gettimeofday(&tv, NULL);
+    return static_cast<int64_t>(tv.tv_usec);
+  });
+  bench("Timestamp::now", [] { return Timestamp::now().microSecondsSinceEpoch(); });
+  bench("Clock::realtimeCoarse", [] { return Clock::realtimeCoarse().microSecondsSinceEpoch(); });
+  bench("Clock::monotonicMicroseconds", [] { return Clock::monotonicMicroseconds(); });
+  bench("Clock::monotonicCoarse", [] { return Clock::monotonicCoarseMicroseconds(); });
+  bench("Clock::tsc", [] { return Clock::tsc().microSecondsSinceEpoch(); });
+  Clock::setLoopTime(Timestamp::now());
+  bench("Clock::loopTime (cached)", [] { return Clock::loopTime().microSecondsSinceEpoch(); });
+  Clock::setLoopTime(Timestamp::invalid());
+  return sink == 42;
+}
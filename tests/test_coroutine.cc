@@ -0,0 +1,209 @@
+#undef NDEBUG
+// 协程写的行协议服务端和客户端：分包到达的行和定长数据都能读全，
+// 子任务的返回值能拿回来，对端关闭时读返回空，关闭前已经收到的行还能读出来
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThread.h"
+#include "muduo/net/InetAddress.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+#include "muduo/net/coro/Awaitables.h"
+#include "muduo/net/coro/Stream.h"
+
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const uint16_t kPort = 20361;
+const uint16_t kLatePort = 20362;
+
+int g_serverSessions = 0;
+int g_serverClosed = 0;
+
+// "DATA n\r\n"后面跟n个字节，回"GOT n\r\n"；"BYE\r\n"回"BYE\r\n"后关闭写端；其他的行原样回去
+coro::Task<> serve(TcpConnectionPtr conn)
+{
+  coro::Stream stream(conn);
+  ++g_serverSessions;
+  for (;;)
+  {
+    std::optional<string> line = co_await stream.readUntil("\r\n");
+    if (!line)
+    {
+      break;
+    }
+    if (line->compare(0, 5, "DATA ") == 0)
+    {
+      const size_t n = static_cast<size_t>(atoi(line->c_str() + 5));
+      std::optional<string> data = co_await stream.read(n);
+      if (!data)
+      {
+        break;
+      }
+      assert(*data == string(n, 'x'));
+      stream.write("GOT " + std::to_string(n) + "\r\n");
+    }
+    else if (*line == "BYE\r\n")
+    {
+      stream.write(*line);
+      const bool drained = co_await stream.drain();
+      assert(drained);
+      stream.shutdown();
+    }
+    else
+    {
+      stream.write(*line);
+    }
+  }
+  ++g_serverClosed;
+}
+
+// 先睡一会儿再读，对端在这期间发完两行就关了
+std::vector<string> g_lateLines;
+bool g_lateDone = false;
+
+coro::Task<> serveLate(TcpConnectionPtr conn)
+{
+  coro::Stream stream(conn);
+  co_await coro::sleep(conn->getLoop(), 0.1);
+  assert(stream.closed());
+  for (;;)
+  {
+    std::optional<string> line = co_await stream.readUntil("\r\n");
+    if (!line)
+    {
+      break;
+    }
+    g_lateLines.push_back(*line);
+  }
+  // 不完整的行留在buffer里
+  assert(stream.buffer()->retrieveAllAsString() == "C");
+  g_lateDone = true;
+}
+
+// 子任务：发一行，等回来的那一行
+coro::Task<string> roundTrip(coro::Stream &stream, const string &line)
+{
+  stream.write(line);
+  std::optional<string> reply = co_await stream.readUntil("\r\n");
+  assert(reply);
+  co_return *reply;
+}
+
+std::vector<string> g_replies;
+bool g_clientDone = false;
+
+coro::Task<> client(EventLoop *loop, EventLoop *other, TcpClient &tcpClient)
+{
+  // 到别的loop取个值，回到自己的loop接着跑
+  const pid_t otherTid = co_await coro::awaitOn(loop, other->submit([] { return CurrentThread::tid(); }));
+  assert(otherTid != CurrentThread::tid());
+  assert(loop->isInLoopThread());
+
+  TcpConnectionPtr conn = co_await coro::connect(tcpClient);
+  assert(conn->connected());
+  assert(loop->isInLoopThread());
+  coro::Stream stream(conn);
+
+  g_replies.push_back(co_await roundTrip(stream, "hello\r\n"));
+
+  // 一行拆成几段发，分隔符也拆开
+  stream.write("split");
+  co_await coro::sleep(loop, 0.02);
+  stream.write(" line\r");
+  co_await coro::sleep(loop, 0.02);
+  stream.write("\nsecond\r\n");
+  for (int i = 0; i < 2; ++i)
+  {
+    std::optional<string> reply = co_await stream.readUntil("\r\n");
+    assert(reply);
+    g_replies.push_back(*reply);
+  }
+
+  // 定长数据比一次read大，也拆开发
+  const size_t kBig = 256 * 1024;
+  stream.write("DATA " + std::to_string(kBig) + "\r\n");
+  stream.write(string(kBig / 2, 'x'));
+  co_await coro::sleep(loop, 0.01);
+  stream.write(string(kBig - kBig / 2, 'x'));
+  g_replies.push_back(*co_await stream.readUntil("\r\n"));
+
+  g_replies.push_back(co_await roundTrip(stream, "BYE\r\n"));
+  // 服务端关了写端，读返回空，没读完的留在buffer里
+  std::optional<string> rest = co_await stream.readSome();
+  assert(!rest);
+  assert(stream.closed());
+  g_clientDone = true;
+}
+
+int main()
+{
+  Logger::setLogLevel(Logger::WARN);
+  EventLoop loop;
+  InetAddress addr(kPort);
+  TcpServer server(&loop, addr, "CoroServer");
+  server.setConnectionCallback([](const TcpConnectionPtr &conn) {
+    if (conn->connected())
+    {
+      coro::spawn(serve(conn));
+    }
+  });
+  server.start();
+
+  TcpServer lateServer(&loop, InetAddress(kLatePort), "LateServer");
+  lateServer.setConnectionCallback([](const TcpConnectionPtr &conn) {
+    if (conn->connected())
+    {
+      coro::spawn(serveLate(conn));
+    }
+  });
+  lateServer.start();
+  TcpClient lateClient(&loop, InetAddress("127.0.0.1", kLatePort), "LateClient");
+  lateClient.setConnectionCallback([](const TcpConnectionPtr &conn) {
+    if (conn->connected())
+    {
+      conn->send("A\r\nB\r\nC");
+      conn->shutdown();
+    }
+  });
+  lateClient.connect();
+
+  TcpClient tcpClient(&loop, InetAddress("127.0.0.1", kPort), "CoroClient");
+  EventLoopThread otherThread;
+  coro::spawn(client(&loop, otherThread.startLoop(), tcpClient));
+  // 客户端会话结束时连接也释放了，等服务端的会话读到关闭再退出
+  loop.runEvery(0.01, [&] {
+    if (g_clientDone && g_serverClosed == 1 && g_lateDone)
+    {
+      loop.quit();
+    }
+  });
+  loop.runAfter(5.0, [&] {
+    printf("timed out\n");
+    abort();
+  });
+  loop.loop();
+
+  for (size_t i = 0; i < g_replies.size(); ++i)
+  {
+    printf("reply %zu: %s", i, g_replies[i].c_str());
+  }
+  assert(g_clientDone);
+  assert(g_replies.size() == 5);
+  assert(g_replies[0] == "hello\r\n");
+  assert(g_replies[1] == "split line\r\n");
+  assert(g_replies[2] == "second\r\n");
+  assert(g_replies[3] == "GOT 262144\r\n");
+  assert(g_replies[4] == "BYE\r\n");
+  assert(g_serverSessions == 1);
+  assert(g_serverClosed == 1);
+  assert(g_lateLines.size() == 2);
+  assert(g_lateLines[0] == "A\r\n");
+  assert(g_lateLines[1] == "B\r\n");
+  printf("test_coroutine passed\n");
+}
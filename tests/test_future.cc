@@ -0,0 +1,241 @@
+#undef NDEBUG
+// EventLoop::submit()：结果和异常能拿回来，和runInLoop保持先后顺序，
+// then()回到指定的loop，whenAll()收齐每个loop的结果，loop析构时没执行的调用会报错，
+// 小的调用从CallNodePool取节点，大的走malloc，Future比loop活得久也没问题
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/CurrentThread.h"
+#include "muduo/base/Logging.h"
+#include "muduo/base/Thread.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThread.h"
+#include "muduo/net/EventLoopThreadPool.h"
+#include "muduo/net/Future.h"
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+void checkGet(EventLoop *loop, pid_t loopTid)
+{
+  Future<pid_t> tid = loop->submit([] { return CurrentThread::tid(); });
+  assert(tid.valid());
+  assert(tid.get() == loopTid);
+  assert(!tid.valid());
+
+  // 和runInLoop在同一个队列里，先后顺序不变
+  int counter = 0;
+  for (int i = 0; i < 100; ++i)
+  {
+    loop->runInLoop([&counter] { ++counter; });
+  }
+  assert(loop->submit([&counter] { return counter; }).get() == 100);
+
+  Future<string> big = loop->submit([] { return string(1000, 'x'); });
+  assert(big.get().size() == 1000);
+
+  bool ran = false;
+  loop->submit([&ran] { ran = true; }).get();
+  assert(ran);
+
+  Future<int> failed = loop->submit([]() -> int { throw std::runtime_error("boom"); });
+  bool caught = false;
+  try
+  {
+    failed.get();
+  }
+  catch (const std::runtime_error &e)
+  {
+    caught = string(e.what()) == "boom";
+  }
+  assert(caught);
+}
+
+void checkThenAndWhenAll()
+{
+  EventLoop loop;
+  EventLoopThread other;
+  EventLoop *otherLoop = other.startLoop();
+  EventLoopThreadPool pool(&loop, "pool");
+  pool.setThreadNum(3);
+  pool.start();
+
+  // loop线程里submit直接执行，结果就在Future里
+  Future<int> inline_ = loop.submit([] { return 7; });
+  assert(inline_.ready());
+  assert(inline_.get() == 7);
+
+  const pid_t mainTid = CurrentThread::tid();
+  int thenCalls = 0;
+  otherLoop->submit([] { return CurrentThread::tid(); }).then(&loop, [&](Future<pid_t> f) {
+    assert(f.ready());
+    assert(CurrentThread::tid() == mainTid);
+    assert(f.get() != mainTid);
+    ++thenCalls;
+  });
+
+  std::vector<pid_t> tids;
+  whenAll(&pool, [] { return CurrentThread::tid(); }).then(&loop, [&](Future<std::vector<pid_t>> f) {
+    assert(CurrentThread::tid() == mainTid);
+    tids = f.get();
+    ++thenCalls;
+  });
+
+  // 有一个loop抛异常，合起来的Future拿到异常
+  std::vector<EventLoop *> loops = pool.getAllLoops();
+  bool caught = false;
+  whenAll(loops, [&loops] {
+    if (EventLoop::getEventLoopOfCurrentThread() == loops[1])
+    {
+      throw std::runtime_error("one failed");
+    }
+  }).then(&loop, [&](Future<void> f) {
+    try
+    {
+      f.get();
+    }
+    catch (const std::runtime_error &)
+    {
+      caught = true;
+    }
+    ++thenCalls;
+  });
+
+  assert(whenAll(std::vector<EventLoop *>(), [] { return 1; }).get().empty());
+
+  loop.runEvery(0.01, [&] {
+    if (thenCalls == 3)
+    {
+      loop.quit();
+    }
+  });
+  loop.loop();
+
+  assert(tids.size() == 3);
+  for (size_t i = 0; i < tids.size(); ++i)
+  {
+    assert(tids[i] != mainTid);
+    assert(loops[i]->submit([] { return CurrentThread::tid(); }).get() == tids[i]);
+  }
+  assert(caught);
+}
+
+void checkAbandoned()
+{
+  // loop还没跑就析构了，排着的submit得到异常而不是永远等下去
+  EventLoop *loop = NULL;
+  CountDownLatch created(1);
+  CountDownLatch submitted(1);
+  Thread thread([&] {
+    EventLoop local;
+    loop = &local;
+    created.countDown();
+    submitted.wait();
+  });
+  thread.start();
+  created.wait();
+  Future<int> never = loop->submit([] { return 1; });
+  submitted.countDown();
+  bool caught = false;
+  try
+  {
+    never.get();
+  }
+  catch (const Exception &e)
+  {
+    caught = true;
+    printf("abandoned: %s\n", e.what());
+  }
+  assert(caught);
+  thread.join();
+}
+
+void checkNodePool()
+{
+  std::unique_ptr<EventLoopThread> thread(new EventLoopThread);
+  EventLoop *loop = thread->startLoop();
+
+  // 几个线程同时submit，节点在各个线程之间借来还去
+  const int kThreads = 4;
+  const int kCalls = 20000;
+  std::atomic<int64_t> sum(0);
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int t = 0; t < kThreads; ++t)
+  {
+    threads.emplace_back(new Thread([loop, &sum] {
+      for (int i = 0; i < kCalls; ++i)
+      {
+        sum += loop->submit([i] { return i; }).get();
+      }
+    }));
+    threads.back()->start();
+  }
+  for (auto &t : threads)
+  {
+    t->join();
+  }
+  assert(sum == static_cast<int64_t>(kThreads) * kCalls * (kCalls - 1) / 2);
+
+  // 捕获的东西放不进节点，走malloc
+  char bigCapture[net::detail::CallNodePool::kNodeSize];
+  for (size_t i = 0; i < sizeof bigCapture; ++i)
+  {
+    bigCapture[i] = static_cast<char>(i);
+  }
+  assert(loop->submit([bigCapture] { return bigCapture[100]; }).get() == 100);
+
+  // loop和它的pool析构以后，手里的Future还能取结果，节点最后还回去
+  Future<string> late = loop->submit([] { return string("late"); });
+  Future<int> notTaken = loop->submit([] { return 2; });
+  loop->submit([] {}).get();
+  thread.reset();
+  assert(late.get() == "late");
+  assert(notTaken.ready());
+}
+
+void bench(EventLoop *loop)
+{
+  const int kCalls = 100 * 1000;
+  int sink = 0;
+  Timestamp start = Timestamp::now();
+  for (int i = 0; i < kCalls; ++i)
+  {
+    CountDownLatch latch(1);
+    loop->runInLoop([&sink, &latch] {
+      ++sink;
+      latch.countDown();
+    });
+    latch.wait();
+  }
+  const double latchUs = timeDifference(Timestamp::now(), start) * 1e6 / kCalls;
+  start = Timestamp::now();
+  for (int i = 0; i < kCalls; ++i)
+  {
+    sink += loop->submit([&sink] { return sink; }).get();
+  }
+  const double submitUs = timeDifference(Timestamp::now(), start) * 1e6 / kCalls;
+  printf("round trip: runInLoop+CountDownLatch %.2f us, submit().get() %.2f us\n", latchUs, submitUs);
+}
+
+int main()
+{
+  Logger::setLogLevel(Logger::WARN);
+  {
+    EventLoopThread thread;
+    EventLoop *loop = thread.startLoop();
+    const pid_t loopTid = loop->submit([] { return CurrentThread::tid(); }).get();
+    assert(loopTid != CurrentThread::tid());
+    checkGet(loop, loopTid);
+    bench(loop);
+  }
+  checkThenAndWhenAll();
+  checkAbandoned();
+  checkNodePool();
+  printf("test_future passed\n");
+}
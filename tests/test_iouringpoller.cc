@@ -0,0 +1,195 @@
+#undef NDEBUG
+// 用MUDUO_USE_IOURING跑一遍回显，检查水平触发的语义：
+// 一次可读事件读不完的数据、同时到达的多个连接都要处理完；
+// 再把SQ塞满：一轮要交的SQE比SQ大、CQ也溢出了，哪个都不能丢
+#include "muduo/base/Logging.h"
+#include "muduo/base/Thread.h"
+#include "muduo/net/Channel.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/InetAddress.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+#include "muduo/net/poller/IoUring.h"
+
+#include <memory>
+#include <vector>
+
+#include <assert.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const uint16_t kPort = 20331;
+const int kClients = 8;
+const size_t kMessage = 4 * 1024 * 1024;
+// 比IoUringPoller的256项SQ和512项CQ都多
+const int kChannels = 600;
+
+// io_uring的fd在/proc/self/fd里是anon_inode:[io_uring]
+bool hasIoUring()
+{
+  bool found = false;
+  DIR *dir = ::opendir("/proc/self/fd");
+  while (struct dirent *ent = ::readdir(dir))
+  {
+    char path[300];
+    char target[64];
+    snprintf(path, sizeof path, "/proc/self/fd/%s", ent->d_name);
+    ssize_t n = ::readlink(path, target, sizeof target - 1);
+    if (n > 0)
+    {
+      target[n] = '\0';
+      found = found || strstr(target, "io_uring") != NULL;
+    }
+  }
+  ::closedir(dir);
+  return found;
+}
+
+// 小ring里连续排NOP，一直不收CQE：SQ一满getSqe就得先交，CQ也会溢出，
+// 交不出去的时候拿到的是NULL，收一下CQE再要，每个NOP都要完成且只完成一次
+void fillRing()
+{
+  IoUring ring(4);
+  assert(ring.valid());
+  const int kNops = 64;
+  std::vector<int> completed(kNops, 0);
+  int seen = 0;
+  auto reap = [&] {
+    seen += static_cast<int>(ring.forEachCqe([&](const struct io_uring_cqe &cqe) {
+      assert(cqe.user_data < static_cast<uint64_t>(kNops));
+      ++completed[cqe.user_data];
+    }));
+  };
+  for (int i = 0; i < kNops; ++i)
+  {
+    struct io_uring_sqe *sqe = ring.getSqe();
+    while (sqe == NULL)
+    {
+      reap();
+      sqe = ring.getSqe();
+    }
+    sqe->opcode = IORING_OP_NOP;
+    sqe->user_data = static_cast<uint64_t>(i);
+  }
+  for (int i = 0; i < 100 && seen < kNops; ++i)
+  {
+    ring.submitAndWait(10);
+    reap();
+  }
+  assert(seen == kNops);
+  for (int n : completed)
+  {
+    assert(n == 1);
+  }
+  assert(ring.queuedSqes() == 0);
+}
+
+// 几百个一直可读的eventfd，每轮都要重新挂上几百个POLL_ADD，比SQ多，完成的也比CQ多
+void fillPoller()
+{
+  EventLoop loop;
+  std::vector<int> fds;
+  std::vector<std::unique_ptr<Channel>> channels;
+  std::vector<int> fired(kChannels, 0);
+  int done = 0;
+  for (int i = 0; i < kChannels; ++i)
+  {
+    int fd = ::eventfd(1, EFD_NONBLOCK | EFD_CLOEXEC);
+    assert(fd >= 0);
+    fds.push_back(fd);
+    channels.emplace_back(new Channel(&loop, fd));
+    // 不读，一直是可读的
+    channels.back()->setReadCallback([&, i](Timestamp) {
+      if (++fired[i] == 3 && ++done == kChannels)
+      {
+        loop.quit();
+      }
+    });
+    channels.back()->enableReading();
+  }
+  loop.runAfter(10, [&] { loop.quit(); });
+  loop.loop();
+  assert(done == kChannels);
+  for (auto &channel : channels)
+  {
+    channel->disableAll();
+    channel->remove();
+  }
+  for (int fd : fds)
+  {
+    ::close(fd);
+  }
+}
+
+int main()
+{
+  ::setenv("MUDUO_USE_IOURING", "1", 1);
+  Logger::setLogLevel(Logger::WARN);
+  EventLoop loop;
+  if (!hasIoUring())
+  {
+    printf("test_iouringpoller skipped, io_uring is not available\n");
+    return 0;
+  }
+  fillRing();
+  // 一个线程只能有一个EventLoop
+  Thread thread(fillPoller);
+  thread.start();
+  thread.join();
+
+  TcpServer server(&loop, InetAddress(kPort), "Echo");
+  server.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) { conn->send(buf); });
+  server.start();
+
+  string message(kMessage, 0);
+  for (size_t i = 0; i < message.size(); ++i)
+  {
+    message[i] = static_cast<char>(i * 7 % 253);
+  }
+
+  int finished = 0;
+  std::vector<string> received(kClients);
+  std::vector<std::unique_ptr<TcpClient>> clients;
+  for (int i = 0; i < kClients; ++i)
+  {
+    clients.emplace_back(new TcpClient(&loop, InetAddress("127.0.0.1", kPort), "Client"));
+    clients.back()->setConnectionCallback([&](const TcpConnectionPtr &conn) {
+      if (conn->connected())
+      {
+        conn->send(message);
+      }
+    });
+    clients.back()->setMessageCallback([&, i](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+      received[i].append(buf->peek(), buf->readableBytes());
+      buf->retrieveAll();
+      if (received[i].size() == kMessage && ++finished == kClients)
+      {
+        loop.quit();
+      }
+    });
+  }
+  // 所有连接一起发起，Acceptor的一次可读事件只accept一个
+  for (auto &client : clients)
+  {
+    client->connect();
+  }
+  bool timerFired = false;
+  loop.runAfter(0.01, [&] { timerFired = true; });
+  loop.runAfter(30, [&] { loop.quit(); });
+  loop.loop();
+
+  assert(timerFired);
+  assert(finished == kClients);
+  for (const string &r : received)
+  {
+    assert(r == message);
+  }
+  printf("test_iouringpoller passed\n");
+}
@@ -0,0 +1,186 @@
+#undef NDEBUG
+// MpmcQueue：单线程下先进先出、满了放不进、空了取不到，批量操作跨过数组末尾，
+// 多生产者多消费者下每个元素恰好取到一次，阻塞的put/take能被对面叫醒
+#include "muduo/base/MpmcQueue.h"
+#include "muduo/base/CurrentThread.h"
+#include "muduo/base/Thread.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+
+using namespace muduo;
+
+void checkSingleThread()
+{
+  MpmcQueue<int> queue(5);
+  assert(queue.capacity() == 8);
+  assert(queue.empty());
+  for (int i = 0; i < 8; ++i)
+  {
+    assert(queue.tryPut(i));
+  }
+  assert(queue.full());
+  assert(!queue.tryPut(8));
+  assert(queue.size() == 8);
+  int x = -1;
+  for (int i = 0; i < 8; ++i)
+  {
+    assert(queue.tryTake(&x));
+    assert(x == i);
+  }
+  assert(!queue.tryTake(&x));
+
+  // 批量，每次都跨过数组末尾
+  int in[6];
+  int out[8];
+  int next = 0;
+  int expect = 0;
+  for (int round = 0; round < 100; ++round)
+  {
+    for (int i = 0; i < 6; ++i)
+    {
+      in[i] = next + i;
+    }
+    const size_t put = queue.tryPutN(in, 6);
+    next += static_cast<int>(put);
+    const size_t taken = queue.tryTakeN(out, 5);
+    for (size_t i = 0; i < taken; ++i)
+    {
+      assert(out[i] == expect++);
+    }
+  }
+  // 只放得进剩下的空位
+  const size_t room = queue.capacity() - queue.size();
+  for (int i = 0; i < 6; ++i)
+  {
+    in[i] = next + i;
+  }
+  assert(queue.tryPutN(in, 6) == std::min<size_t>(room, 6));
+}
+
+void checkOwnership()
+{
+  // 不可拷贝的元素，队列析构时剩下的也要释放
+  MpmcQueue<std::unique_ptr<std::string>> queue(4);
+  queue.put(std::unique_ptr<std::string>(new std::string("hello")));
+  queue.put(std::unique_ptr<std::string>(new std::string("world")));
+  std::unique_ptr<std::string> s(queue.take());
+  assert(*s == "hello");
+}
+
+void checkConcurrent(int producers, int consumers, size_t batch)
+{
+  MpmcQueue<int64_t> queue(64);
+  const int64_t kPerProducer = 200000;
+  std::atomic<int64_t> sum(0);
+  std::atomic<int64_t> count(0);
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int p = 0; p < producers; ++p)
+  {
+    threads.emplace_back(new Thread([&queue, p, batch, kPerProducer] {
+      std::vector<int64_t> items(batch);
+      for (int64_t i = 0; i < kPerProducer;)
+      {
+        if (batch == 1)
+        {
+          queue.put(p * kPerProducer + i + 1);
+          ++i;
+          continue;
+        }
+        size_t n = 0;
+        while (n < batch && i + static_cast<int64_t>(n) < kPerProducer)
+        {
+          items[n] = p * kPerProducer + i + static_cast<int64_t>(n) + 1;
+          ++n;
+        }
+        size_t done = 0;
+        while (done < n)
+        {
+          const size_t put = queue.tryPutN(&items[done], n - done);
+          if (put == 0)
+          {
+            ::sched_yield();
+          }
+          done += put;
+        }
+        i += static_cast<int64_t>(n);
+      }
+    }));
+  }
+  for (int c = 0; c < consumers; ++c)
+  {
+    threads.emplace_back(new Thread([&queue, &sum, &count, batch] {
+      std::vector<int64_t> items(batch);
+      for (;;)
+      {
+        const size_t n = queue.takeN(&items[0], batch);
+        for (size_t i = 0; i < n; ++i)
+        {
+          if (items[i] == 0)
+          {
+            return;  // 结束标记
+          }
+          sum += items[i];
+          ++count;
+        }
+      }
+    }));
+  }
+  for (auto &t : threads)
+  {
+    t->start();
+  }
+  for (int p = 0; p < producers; ++p)
+  {
+    threads[p]->join();
+  }
+  // 每个消费者一个结束标记；批量取的消费者可能一次拿到好几个，多放一些
+  for (int c = 0; c < consumers * static_cast<int>(batch); ++c)
+  {
+    queue.put(0);
+  }
+  for (int c = 0; c < consumers; ++c)
+  {
+    threads[producers + c]->join();
+  }
+  const int64_t n = producers * kPerProducer;
+  printf("%d producers %d consumers batch %zu: %lld items\n", producers, consumers, batch, static_cast<long long>(count.load()));
+  assert(count == n);
+  assert(sum == n * (n + 1) / 2);
+}
+
+void checkBlocking()
+{
+  // 消费者先睡着，生产者放进来把它叫醒
+  MpmcQueue<int> queue(2);
+  std::atomic<int> got(0);
+  Thread consumer([&] {
+    for (int i = 0; i < 3; ++i)
+    {
+      got += queue.take();
+    }
+  });
+  consumer.start();
+  CurrentThread::sleepUsec(50 * 1000);
+  queue.put(1);
+  queue.put(2);
+  queue.put(3);  // 可能要等消费者腾出位置
+  consumer.join();
+  assert(got == 6);
+}
+
+int main()
+{
+  checkSingleThread();
+  checkOwnership();
+  checkConcurrent(1, 1, 1);
+  checkConcurrent(4, 4, 1);
+  checkConcurrent(4, 2, 16);
+  checkBlocking();
+  printf("test_mpmcqueue passed\n");
+}
@@ -0,0 +1,167 @@
+// 阶段之间传消息：BoundedBlockingQueue、BlockingQueue和MpmcQueue（单个和批量）比吞吐
+#include "muduo/base/BlockingQueue.h"
+#include "muduo/base/BoundedBlockingQueue.h"
+#include "muduo/base/Clock.h"
+#include "muduo/base/MpmcQueue.h"
+#include "muduo/base/Thread.h"
+
+#include <memory>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+
+const size_t kCapacity = 1024;
+const size_t kBatch = 32;
+
+struct Bounded
+{
+  Bounded() : queue(kCapacity) {}
+  void put(int64_t x) { queue.put(x); }
+  int64_t take() { return queue.take(); }
+  BoundedBlockingQueue<int64_t> queue;
+};
+
+struct Unbounded
+{
+  void put(int64_t x) { queue.put(x); }
+  int64_t take() { return queue.take(); }
+  BlockingQueue<int64_t> queue;
+};
+
+struct Mpmc
+{
+  Mpmc() : queue(kCapacity) {}
+  void put(int64_t x) { queue.put(x); }
+  int64_t take() { return queue.take(); }
+  MpmcQueue<int64_t> queue;
+};
+
+// 每次一个地放、取，结束标记是-1
+template <typename Queue>
+double single(int producers, int consumers, int64_t perProducer)
+{
+  Queue queue;
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int p = 0; p < producers; ++p)
+  {
+    threads.emplace_back(new Thread([&queue, perProducer] {
+      for (int64_t i = 0; i < perProducer; ++i)
+      {
+        queue.put(i);
+      }
+    }));
+  }
+  for (int c = 0; c < consumers; ++c)
+  {
+    threads.emplace_back(new Thread([&queue] {
+      while (queue.take() >= 0)
+      {
+      }
+    }));
+  }
+  const int64_t start = Clock::monotonicMicroseconds();
+  for (auto &t : threads)
+  {
+    t->start();
+  }
+  for (int p = 0; p < producers; ++p)
+  {
+    threads[p]->join();
+  }
+  for (int c = 0; c < consumers; ++c)
+  {
+    queue.put(-1);
+  }
+  for (int c = 0; c < consumers; ++c)
+  {
+    threads[producers + c]->join();
+  }
+  const int64_t elapsed = Clock::monotonicMicroseconds() - start;
+  return static_cast<double>(producers * perProducer) / static_cast<double>(elapsed);
+}
+
+double batched(int producers, int consumers, int64_t perProducer)
+{
+  MpmcQueue<int64_t> queue(kCapacity);
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int p = 0; p < producers; ++p)
+  {
+    threads.emplace_back(new Thread([&queue, perProducer] {
+      int64_t items[kBatch];
+      for (int64_t i = 0; i < perProducer; i += kBatch)
+      {
+        const size_t n = static_cast<size_t>(std::min<int64_t>(kBatch, perProducer - i));
+        for (size_t j = 0; j < n; ++j)
+        {
+          items[j] = i + static_cast<int64_t>(j);
+        }
+        size_t done = 0;
+        while (done < n)
+        {
+          const size_t put = queue.tryPutN(items + done, n - done);
+          if (put == 0)
+          {
+            ::sched_yield();
+          }
+          done += put;
+        }
+      }
+    }));
+  }
+  for (int c = 0; c < consumers; ++c)
+  {
+    threads.emplace_back(new Thread([&queue] {
+      int64_t items[kBatch];
+      for (;;)
+      {
+        const size_t n = queue.takeN(items, kBatch);
+        for (size_t j = 0; j < n; ++j)
+        {
+          if (items[j] < 0)
+          {
+            return;
+          }
+        }
+      }
+    }));
+  }
+  const int64_t start = Clock::monotonicMicroseconds();
+  for (auto &t : threads)
+  {
+    t->start();
+  }
+  for (int p = 0; p < producers; ++p)
+  {
+    threads[p]->join();
+  }
+  // 批量取的消费者一次可能拿走好几个结束标记
+  for (size_t c = 0; c < consumers * kBatch; ++c)
+  {
+    queue.put(-1);
+  }
+  for (int c = 0; c < consumers; ++c)
+  {
+    threads[producers + c]->join();
+  }
+  const int64_t elapsed = Clock::monotonicMicroseconds() - start;
+  return static_cast<double>(producers * perProducer) / static_cast<double>(elapsed);
+}
+
+int main(int argc, char *argv[])
+{
+  const int64_t kMessages = argc > 1 ? atoll(argv[1]) : 2000000;
+  const int configs[][2] = {{1, 1}, {2, 2}, {4, 4}, {8, 1}, {1, 8}};
+  printf("Mmsgs/s    P x C   %10s %10s %10s %10s\n", "bounded", "blocking", "mpmc", "mpmc-x32");
+  for (const auto &config : configs)
+  {
+    const int producers = config[0];
+    const int consumers = config[1];
+    const int64_t perProducer = kMessages / producers;
+    printf("          %2d x %-2d  %10.3f %10.3f %10.3f %10.3f\n", producers, consumers,
+           single<Bounded>(producers, consumers, perProducer), single<Unbounded>(producers, consumers, perProducer),
+           single<Mpmc>(producers, consumers, perProducer), batched(producers, consumers, perProducer));
+  }
+}
@@ -0,0 +1,94 @@
+#undef NDEBUG
+// 多个生产者同时push，检查没有丢失，并且每个生产者的顺序不变
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/MpscQueue.h"
+#include "muduo/base/Thread.h"
+
+#include <memory>
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+
+using namespace muduo;
+
+const int kProducers = 4;
+const int kPerProducer = 200000;
+
+void testSingleThread()
+{
+  MpscQueue<int> queue;
+  int x = 0;
+  assert(queue.empty());
+  assert(!queue.pop(&x));
+  for (int i = 0; i < 10; ++i)
+  {
+    queue.push(i);
+  }
+  assert(queue.size() == 10);
+  for (int i = 0; i < 10; ++i)
+  {
+    assert(queue.pop(&x));
+    assert(x == i);
+  }
+  assert(!queue.pop(&x));
+  assert(queue.empty());
+  assert(queue.size() == 0);
+
+  // 取空以后哑节点重新入队，还能继续用
+  queue.push(42);
+  assert(queue.pop(&x) && x == 42);
+  assert(!queue.pop(&x));
+
+  // 析构时释放还没取出的节点
+  MpscQueue<std::unique_ptr<int>> owning;
+  owning.push(std::unique_ptr<int>(new int(1)));
+  owning.push(std::unique_ptr<int>(new int(2)));
+}
+
+void testProducers()
+{
+  MpscQueue<int> queue;
+  CountDownLatch latch(1);
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int p = 0; p < kProducers; ++p)
+  {
+    threads.emplace_back(new Thread([&queue, &latch, p] {
+      latch.wait();
+      for (int i = 0; i < kPerProducer; ++i)
+      {
+        queue.push(p * kPerProducer + i);
+      }
+    }));
+    threads.back()->start();
+  }
+  latch.countDown();
+
+  std::vector<int> next(kProducers, 0);
+  int received = 0;
+  while (received < kProducers * kPerProducer)
+  {
+    int x = 0;
+    if (queue.pop(&x))
+    {
+      const int p = x / kPerProducer;
+      assert(x % kPerProducer == next[p]);
+      ++next[p];
+      ++received;
+    }
+  }
+  for (auto &thr : threads)
+  {
+    thr->join();
+  }
+  int x = 0;
+  assert(!queue.pop(&x));
+  assert(queue.size() == 0);
+}
+
+int main()
+{
+  testSingleThread();
+  testProducers();
+  printf("test_mpscqueue passed\n");
+}
@@ -0,0 +1,158 @@
+// 多个线程同时往一个loop投递任务，比较原来的mutex+vector和MpscQueue
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/Mutex.h"
+#include "muduo/base/MpscQueue.h"
+#include "muduo/base/Thread.h"
+#include "muduo/base/Timestamp.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThread.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+typedef std::function<void()> Functor;
+
+const int kPerProducer = 200000;
+
+// 原来EventLoop::queueInLoop/doPendingFunctors的做法
+class MutexQueue
+{
+ public:
+  void push(Functor cb)
+  {
+    MutexGuard lock(mutex_);
+    pending_.push_back(std::move(cb));
+  }
+
+  size_t run()
+  {
+    std::vector<Functor> functors;
+    {
+      MutexGuard lock(mutex_);
+      functors.swap(pending_);
+    }
+    for (const Functor &f : functors)
+    {
+      f();
+    }
+    return functors.size();
+  }
+
+ private:
+  Mutex mutex_;
+  std::vector<Functor> pending_;
+};
+
+class LockFreeQueue
+{
+ public:
+  void push(Functor cb) { queue_.push(std::move(cb)); }
+
+  size_t run()
+  {
+    size_t n = 0;
+    Functor f;
+    while (queue_.pop(&f))
+    {
+      f();
+      ++n;
+    }
+    return n;
+  }
+
+ private:
+  MpscQueue<Functor> queue_;
+};
+
+template <typename Queue>
+void bench(const char *name, int producers)
+{
+  Queue queue;
+  CountDownLatch latch(1);
+  int64_t sum = 0;
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int p = 0; p < producers; ++p)
+  {
+    threads.emplace_back(new Thread([&] {
+      latch.wait();
+      for (int i = 0; i < kPerProducer; ++i)
+      {
+        queue.push([&sum] { ++sum; });
+      }
+    }));
+    threads.back()->start();
+  }
+
+  Timestamp start(Timestamp::now());
+  latch.countDown();
+  const size_t total = static_cast<size_t>(producers) * kPerProducer;
+  size_t done = 0;
+  while (done < total)
+  {
+    done += queue.run();
+  }
+  const double seconds = timeDifference(Timestamp::now(), start);
+  for (auto &thr : threads)
+  {
+    thr->join();
+  }
+  printf("%-8s producers %2d  %6.1f ns/op  %5.2f Mops/s\n", name, producers, seconds * 1e9 / static_cast<double>(total),
+         static_cast<double>(total) / seconds / 1e6);
+}
+
+// 真实的EventLoop::queueInLoop，包括wakeup
+void benchEventLoop(int producers)
+{
+  EventLoopThread loopThread;
+  EventLoop *loop = loopThread.startLoop();
+  CountDownLatch latch(1);
+  CountDownLatch finished(1);
+  const int64_t total = static_cast<int64_t>(producers) * kPerProducer;
+  int64_t count = 0;
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int p = 0; p < producers; ++p)
+  {
+    threads.emplace_back(new Thread([&] {
+      latch.wait();
+      for (int i = 0; i < kPerProducer; ++i)
+      {
+        loop->queueInLoop([&] {
+          if (++count == total)
+          {
+            finished.countDown();
+          }
+        });
+      }
+    }));
+    threads.back()->start();
+  }
+  Timestamp start(Timestamp::now());
+  latch.countDown();
+  finished.wait();
+  const double seconds = timeDifference(Timestamp::now(), start);
+  for (auto &thr : threads)
+  {
+    thr->join();
+  }
+  printf("%-8s producers %2d  %6.1f ns/op  %5.2f Mops/s\n", "loop", producers,
+         seconds * 1e9 / static_cast<double>(total), static_cast<double>(total) / seconds / 1e6);
+}
+
+int main(int argc, char *argv[])
+{
+  const int maxProducers = argc > 1 ? atoi(argv[1]) : 16;
+  for (int producers = 1; producers <= maxProducers; producers *= 2)
+  {
+    bench<MutexQueue>("mutex", producers);
+    bench<LockFreeQueue>("mpsc", producers);
+    benchEventLoop(producers);
+  }
+}
@@ -0,0 +1,146 @@
+#undef NDEBUG
+// 服务端用proactor模式：回显大消息，sendFile和send混在一起发，最后shutdown
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/InetAddress.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+#include "muduo/net/poller/IoUringPoller.h"
+
+#include <memory>
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const uint16_t kEchoPort = 20341;
+const uint16_t kFilePort = 20342;
+const int kClients = 6;
+const size_t kMessage = 2 * 1024 * 1024;
+const size_t kFile = 1024 * 1024;
+
+string makeData(size_t len, int seed)
+{
+  string data(len, 0);
+  for (size_t i = 0; i < len; ++i)
+  {
+    data[i] = static_cast<char>((i * 7 + static_cast<size_t>(seed)) % 251);
+  }
+  return data;
+}
+
+int main()
+{
+  ::setenv("MUDUO_USE_IOURING", "1", 1);
+  Logger::setLogLevel(Logger::WARN);
+  EventLoop loop;
+  if (loop.ioUringPoller() == NULL || !loop.ioUringPoller()->enableProactor())
+  {
+    printf("test_proactor skipped, io_uring proactor is not available\n");
+    return 0;
+  }
+
+  char path[] = "/tmp/test_proactor_XXXXXX";
+  int fd = ::mkstemp(path);
+  assert(fd >= 0);
+  ::unlink(path);
+  const string fileData = makeData(kFile, 3);
+  assert(::write(fd, fileData.data(), fileData.size()) == static_cast<ssize_t>(fileData.size()));
+
+  int proactorConns = 0;
+  TcpServer echo(&loop, InetAddress(kEchoPort), "Echo");
+  echo.setProactor(true);
+  echo.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+    if (conn->connected())
+    {
+      proactorConns += conn->isProactor();
+      assert(!conn->spliceTo(conn));
+    }
+  });
+  echo.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) { conn->send(buf); });
+  echo.start();
+
+  // 文件前后都有普通数据，发完了shutdown
+  int writeCompletes = 0;
+  TcpServer files(&loop, InetAddress(kFilePort), "Files");
+  files.setProactor(true);
+  files.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+    if (conn->connected())
+    {
+      proactorConns += conn->isProactor();
+      conn->send("head");
+      conn->sendFile(fd, 0, kFile);
+      conn->send("tail");
+      conn->shutdown();
+    }
+  });
+  files.setWriteCompleteCallback([&](const TcpConnectionPtr &) { ++writeCompletes; });
+  files.start();
+
+  int finished = 0;
+  std::vector<string> messages;
+  std::vector<string> received(kClients + 1);
+  std::vector<std::unique_ptr<TcpClient>> clients;
+  for (int i = 0; i < kClients; ++i)
+  {
+    messages.push_back(makeData(kMessage + static_cast<size_t>(i), i));
+    clients.emplace_back(new TcpClient(&loop, InetAddress("127.0.0.1", kEchoPort), "Client"));
+    clients.back()->setConnectionCallback([&, i](const TcpConnectionPtr &conn) {
+      if (conn->connected())
+      {
+        conn->send(messages[i]);
+      }
+    });
+    clients.back()->setMessageCallback([&, i](const TcpConnectionPtr &, Buffer *buf, Timestamp) {
+      received[i].append(buf->peek(), buf->readableBytes());
+      buf->retrieveAll();
+      if (received[i].size() == messages[i].size())
+      {
+        ++finished;
+      }
+    });
+  }
+  bool fileClosed = false;
+  clients.emplace_back(new TcpClient(&loop, InetAddress("127.0.0.1", kFilePort), "FileClient"));
+  clients.back()->setConnectionCallback([&](const TcpConnectionPtr &conn) {
+    if (conn->disconnected())
+    {
+      fileClosed = true;
+      ++finished;
+    }
+  });
+  clients.back()->setMessageCallback([&](const TcpConnectionPtr &, Buffer *buf, Timestamp) {
+    received[kClients].append(buf->peek(), buf->readableBytes());
+    buf->retrieveAll();
+  });
+
+  for (auto &client : clients)
+  {
+    client->connect();
+  }
+  loop.runEvery(0.01, [&] {
+    if (finished == kClients + 1)
+    {
+      loop.quit();
+    }
+  });
+  loop.runAfter(30, [&] { loop.quit(); });
+  loop.loop();
+
+  assert(proactorConns == kClients + 1);
+  assert(finished == kClients + 1);
+  for (int i = 0; i < kClients; ++i)
+  {
+    assert(received[i] == messages[i]);
+  }
+  assert(fileClosed);
+  assert(received[kClients] == "head" + fileData + "tail");
+  assert(writeCompletes >= 1);
+  ::close(fd);
+  printf("test_proactor passed\n");
+}
@@ -0,0 +1,120 @@
+#undef NDEBUG
+// echo server <- splice tunnel <- client，检查经过管道转发的数据是否完整
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/InetAddress.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+
+#include <map>
+#include <memory>
+
+#include <assert.h>
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const uint16_t kEchoPort = 20301;
+const uint16_t kTunnelPort = 20302;
+const size_t kTotal = 16 * 1024 * 1024;
+
+class Tunnel
+{
+ public:
+  Tunnel(EventLoop *loop, const InetAddress &listenAddr, const InetAddress &backendAddr)
+      : loop_(loop), backendAddr_(backendAddr), server_(loop, listenAddr, "Tunnel")
+  {
+    server_.setConnectionCallback(std::bind(&Tunnel::onClientConnection, this, _1));
+  }
+
+  void start() { server_.start(); }
+
+ private:
+  void onClientConnection(const TcpConnectionPtr &conn)
+  {
+    if (conn->connected())
+    {
+      // 后端连上之前先不读
+      conn->stopRead();
+      std::shared_ptr<TcpClient> backend(new TcpClient(loop_, backendAddr_, conn->name()));
+      backend->setConnectionCallback(std::bind(&Tunnel::onBackendConnection, this, conn, _1));
+      backends_[conn->name()] = backend;
+      backend->connect();
+    }
+    else
+    {
+      std::map<string, std::shared_ptr<TcpClient>>::iterator it = backends_.find(conn->name());
+      TcpConnectionPtr peer = it == backends_.end() ? TcpConnectionPtr() : it->second->connection();
+      if (peer)
+      {
+        peer->shutdown();
+      }
+      // TcpClient不能在自己的回调里析构
+      loop_->queueInLoop(std::bind(&Tunnel::removeBackend, this, conn->name()));
+    }
+  }
+
+  void onBackendConnection(const TcpConnectionPtr &client, const TcpConnectionPtr &backend)
+  {
+    if (backend->connected())
+    {
+      assert(client->spliceTo(backend));
+      assert(backend->spliceTo(client));
+      client->startRead();
+    }
+    else if (client->connected())
+    {
+      client->shutdown();
+    }
+  }
+
+  void removeBackend(const string &name) { backends_.erase(name); }
+
+  EventLoop *loop_;
+  InetAddress backendAddr_;
+  // server_析构时还会回调onClientConnection，所以backends_要后析构
+  std::map<string, std::shared_ptr<TcpClient>> backends_;
+  TcpServer server_;
+};
+
+int main()
+{
+  Logger::setLogLevel(Logger::WARN);
+  EventLoop loop;
+
+  TcpServer echo(&loop, InetAddress(kEchoPort), "Echo");
+  echo.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) { conn->send(buf); });
+  echo.start();
+
+  Tunnel tunnel(&loop, InetAddress(kTunnelPort), InetAddress("127.0.0.1", kEchoPort));
+  tunnel.start();
+
+  string sent(kTotal, 0);
+  for (size_t i = 0; i < sent.size(); ++i)
+  {
+    sent[i] = static_cast<char>(i * 7 % 253);
+  }
+  string received;
+  TcpClient client(&loop, InetAddress("127.0.0.1", kTunnelPort), "Client");
+  client.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+    if (conn->connected())
+    {
+      conn->send(sent);
+    }
+  });
+  client.setMessageCallback([&](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+    received.append(buf->peek(), buf->readableBytes());
+    buf->retrieveAll();
+    if (received.size() == kTotal)
+    {
+      loop.quit();
+    }
+  });
+  client.connect();
+  loop.runAfter(30, [&] { loop.quit(); });
+  loop.loop();
+
+  assert(received == sent);
+  printf("test_splicetunnel passed\n");
+}
@@ -0,0 +1,124 @@
+// ThreadPool（一次取一个、一次取一批）和WorkStealingThreadPool比吞吐：
+// 不同线程数、不同任务大小，外面两个线程提交，以及任务里再提交子任务
+#include "muduo/base/Clock.h"
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/Thread.h"
+#include "muduo/base/ThreadPool.h"
+#include "muduo/base/WorkStealingThreadPool.h"
+
+#include <atomic>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+
+std::atomic<int64_t> g_sink(0);
+
+// 每个worker一次取16个任务
+class BatchedThreadPool : public ThreadPool
+{
+ public:
+  explicit BatchedThreadPool(const string &name) : ThreadPool(name) { setTaskBatch(16); }
+};
+
+// 大约spin纳秒的计算
+void work(int spin)
+{
+  const int64_t until = Clock::monotonicMicroseconds() * 1000 + spin;
+  int64_t x = 0;
+  while (spin > 0 && Clock::monotonicMicroseconds() * 1000 < until)
+  {
+    ++x;
+  }
+  g_sink.fetch_add(x, std::memory_order_relaxed);
+}
+
+template <typename Pool>
+double external(int threads, int spin, int tasks)
+{
+  Pool pool("bench");
+  pool.start(threads);
+  std::atomic<int> left(tasks);
+  CountDownLatch finished(1);
+  const int kSubmitters = 2;
+  const int64_t start = Clock::monotonicMicroseconds();
+  std::vector<std::unique_ptr<Thread>> submitters;
+  for (int i = 0; i < kSubmitters; ++i)
+  {
+    submitters.emplace_back(new Thread([&] {
+      for (int j = 0; j < tasks / kSubmitters; ++j)
+      {
+        pool.run([&] {
+          work(spin);
+          if (left.fetch_sub(1) == 1)
+          {
+            finished.countDown();
+          }
+        });
+      }
+    }));
+    submitters.back()->start();
+  }
+  for (auto &t : submitters)
+  {
+    t->join();
+  }
+  finished.wait();
+  const int64_t elapsed = Clock::monotonicMicroseconds() - start;
+  pool.stop();
+  return static_cast<double>(tasks) / static_cast<double>(elapsed);  // 每微秒的任务数，即百万/秒
+}
+
+template <typename Pool>
+void fanOut(Pool *pool, int depth, int spin, std::atomic<int> *left, CountDownLatch *finished)
+{
+  if (depth == 0)
+  {
+    work(spin);
+    if (left->fetch_sub(1) == 1)
+    {
+      finished->countDown();
+    }
+    return;
+  }
+  pool->run([=] { fanOut(pool, depth - 1, spin, left, finished); });
+  pool->run([=] { fanOut(pool, depth - 1, spin, left, finished); });
+}
+
+template <typename Pool>
+double nested(int threads, int spin, int depth)
+{
+  Pool pool("bench");
+  pool.start(threads);
+  std::atomic<int> left(1 << depth);
+  CountDownLatch finished(1);
+  const int64_t start = Clock::monotonicMicroseconds();
+  pool.run([&] { fanOut(&pool, depth, spin, &left, &finished); });
+  finished.wait();
+  const int64_t elapsed = Clock::monotonicMicroseconds() - start;
+  pool.stop();
+  return static_cast<double>(1 << depth) / static_cast<double>(elapsed);
+}
+
+int main(int argc, char *argv[])
+{
+  const int kTasks = argc > 1 ? atoi(argv[1]) : 100000;
+  const int kDepth = 16;
+  const int threadCounts[] = {1, 2, 4, 8, 16, 32};
+  const int spins[] = {0, 1000, 10000};
+  printf("Mtasks/s  %7s %6s %10s %10s %10s %10s %10s %10s\n", "threads", "ns", "ext-fifo", "ext-x16", "ext-steal", "nest-fifo", "nest-x16",
+         "nest-steal");
+  for (int spin : spins)
+  {
+    for (int threads : threadCounts)
+    {
+      printf("          %7d %6d %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n", threads, spin, external<ThreadPool>(threads, spin, kTasks),
+             external<BatchedThreadPool>(threads, spin, kTasks), external<WorkStealingThreadPool>(threads, spin, kTasks),
+             nested<ThreadPool>(threads, spin, kDepth), nested<BatchedThreadPool>(threads, spin, kDepth),
+             nested<WorkStealingThreadPool>(threads, spin, kDepth));
+    }
+  }
+  return g_sink == 42;
+}
@@ -0,0 +1,182 @@
+#undef NDEBUG
+// ThreadPool按优先级取任务；排队超时的不跑，改跑onExpired；每个优先级的排队时间统计
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/CurrentThread.h"
+#include "muduo/base/Mutex.h"
+#include "muduo/base/ThreadPool.h"
+
+#include <atomic>
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+
+using namespace muduo;
+
+// 一个worker被堵住，期间排进去的任务按优先级出队
+void checkOrder(int batch)
+{
+  ThreadPool pool("order");
+  pool.setTaskBatch(batch);
+  pool.start(1);
+  CountDownLatch blocked(1);
+  CountDownLatch release(1);
+  pool.run([&] {
+    blocked.countDown();
+    release.wait();
+  });
+  blocked.wait();
+
+  Mutex mutex;
+  std::vector<int> order;
+  auto record = [&](int x) {
+    MutexGuard lock(mutex);
+    order.push_back(x);
+  };
+  pool.run(std::bind(record, 30), ThreadPool::kLowPriority);
+  pool.run(std::bind(record, 20));
+  pool.run(std::bind(record, 10), ThreadPool::kHighPriority);
+  pool.run(std::bind(record, 31), ThreadPool::kLowPriority);
+  pool.run(std::bind(record, 11), ThreadPool::kHighPriority);
+  CountDownLatch done(1);
+  pool.run([&] { done.countDown(); }, ThreadPool::kLowPriority);
+  assert(pool.queueSize() == 6);
+  release.countDown();
+  done.wait();
+  pool.stop();
+
+  const int expected[] = {10, 11, 20, 30, 31};
+  assert(order.size() == 5);
+  for (size_t i = 0; i < order.size(); ++i)
+  {
+    assert(order[i] == expected[i]);
+  }
+  ThreadPool::Stats high = pool.stats(ThreadPool::kHighPriority);
+  assert(high.submitted == 2 && high.started == 2 && high.expired == 0 && high.queued == 0);
+  assert(high.maxWaitMicros > 0);
+  assert(pool.stats(ThreadPool::kNormalPriority).started == 2);  // 加上堵住worker的那个
+  assert(pool.stats(ThreadPool::kLowPriority).started == 3);
+}
+
+// 排队超过timeout的不跑，onExpired代替它跑
+void checkDeadline()
+{
+  ThreadPool pool("deadline");
+  pool.start(1);
+  CountDownLatch blocked(1);
+  CountDownLatch release(1);
+  pool.run([&] {
+    blocked.countDown();
+    release.wait();
+  });
+  blocked.wait();
+
+  std::atomic<int> ran(0);
+  std::atomic<int> cancelled(0);
+  pool.run([&] { ++ran; }, ThreadPool::kHighPriority, 0.02, [&] { ++cancelled; });
+  pool.run([&] { ++ran; }, ThreadPool::kNormalPriority, 0.02);  // 没有onExpired，直接丢掉
+  pool.run([&] { ++ran; }, ThreadPool::kNormalPriority, 10.0, [&] { ++cancelled; });
+  CurrentThread::sleepUsec(50 * 1000);
+  CountDownLatch done(1);
+  pool.run([&] { done.countDown(); }, ThreadPool::kLowPriority);
+  release.countDown();
+  done.wait();
+  pool.stop();
+
+  assert(ran == 1);
+  assert(cancelled == 1);
+  assert(pool.stats(ThreadPool::kHighPriority).expired == 1);
+  ThreadPool::Stats normal = pool.stats(ThreadPool::kNormalPriority);
+  assert(normal.expired == 1 && normal.started == 2);
+  assert(normal.maxWaitMicros >= 50 * 1000);
+  printf("%s", pool.statsString().c_str());
+}
+
+// 一批取出来的任务，排在后面的等到前面的跑完已经过期了，也不能再跑
+void checkDeadlineInBatch()
+{
+  ThreadPool pool("batchdeadline");
+  pool.setTaskBatch(16);
+  pool.start(1);
+  CountDownLatch blocked(1);
+  CountDownLatch release(1);
+  pool.run([&] {
+    blocked.countDown();
+    release.wait();
+  });
+  blocked.wait();
+
+  std::atomic<int> ran(0);
+  std::atomic<int> cancelled(0);
+  // 两个任务会被同一批取走，取的时候后一个还没过期
+  pool.run([&] {
+    CurrentThread::sleepUsec(100 * 1000);
+    ++ran;
+  });
+  pool.run([&] { ++ran; }, ThreadPool::kNormalPriority, 0.05, [&] { ++cancelled; });
+  CountDownLatch done(1);
+  pool.run([&] { done.countDown(); });
+  release.countDown();
+  done.wait();
+  pool.stop();
+
+  assert(ran == 1);
+  assert(cancelled == 1);
+  ThreadPool::Stats normal = pool.stats(ThreadPool::kNormalPriority);
+  assert(normal.expired == 1 && normal.started == 3);
+  // 最后那个在批里等了前面那个100ms
+  assert(normal.maxWaitMicros >= 100 * 1000);
+}
+
+// 过载时按类别丢掉排队太久的，高优先级的不受影响
+void checkShedding(int batch)
+{
+  ThreadPool pool("shed");
+  pool.setTaskBatch(batch);
+  pool.setMaxQueueWait(ThreadPool::kLowPriority, 0.005);
+  pool.start(2);
+  const int kTasks = 2000;
+  std::atomic<int> ran(0);
+  std::atomic<int> shed(0);
+  std::atomic<int> high(0);
+  CountDownLatch done(kTasks);  // 跑了或者丢了都算完
+  for (int i = 0; i < kTasks; ++i)
+  {
+    // 每个任务100us，两个worker，排在后面的低优先级任务等不了5ms
+    pool.run(
+        [&] {
+          CurrentThread::sleepUsec(100);
+          ++ran;
+          done.countDown();
+        },
+        ThreadPool::kLowPriority, 0.0,
+        [&] {
+          ++shed;
+          done.countDown();
+        });
+    if (i % 100 == 0)
+    {
+      pool.run([&] { ++high; }, ThreadPool::kHighPriority);
+    }
+  }
+  done.wait();
+  pool.stop();
+  printf("batch %d: ran %d, shed %d of %d low priority tasks\n", batch, ran.load(), shed.load(), kTasks);
+  printf("%s", pool.statsString().c_str());
+  assert(ran + shed == kTasks);
+  assert(shed > 0);
+  assert(high == kTasks / 100);
+  assert(pool.stats(ThreadPool::kLowPriority).expired == shed);
+  assert(pool.stats(ThreadPool::kHighPriority).expired == 0);
+}
+
+int main()
+{
+  checkOrder(1);
+  checkOrder(16);
+  checkDeadline();
+  checkDeadlineInBatch();
+  checkShedding(1);
+  checkShedding(8);
+  printf("test_threadpoolpriority passed\n");
+}
@@ -0,0 +1,259 @@
+#undef NDEBUG
+// TcpServer的空闲、读、写超时：不提前断开，也不拖太久；有读写的连接不会被误关；
+// 同一个loop上先有超时很长的server，后来的短超时也不能被粗的tick拖慢
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/InetAddress.h"
+#include "muduo/net/SocketsOps.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+#include "muduo/net/TimeoutWheel.h"
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const uint16_t kIdlePort = 20351;
+const uint16_t kReadPort = 20352;
+const uint16_t kWritePort = 20353;
+const uint16_t kLateWritePort = 20354;
+const uint16_t kSlowPort = 20355;
+const uint16_t kFastPort = 20356;
+const double kTimeout = 0.3;
+const double kLate = 0.3;  // 只有一个核的机器上也够了
+
+struct Closed
+{
+  Timestamp connected;
+  double after = -1.0;  // 连上以后多久被服务端关掉，-1表示没关
+};
+
+void track(TcpServer *server, std::map<string, Closed> *closed)
+{
+  server->setConnectionCallback([closed](const TcpConnectionPtr &conn) {
+    Closed &c = (*closed)[conn->peerAddress().toIpPort()];
+    if (conn->connected())
+    {
+      c.connected = Timestamp::now();
+    }
+    else
+    {
+      c.after = timeDifference(Timestamp::now(), c.connected);
+    }
+  });
+}
+
+// TcpConnection不给出fd，按两端地址找回来
+int findSocket(const TcpConnectionPtr &conn)
+{
+  for (int fd = 3; fd < 1024; ++fd)
+  {
+    struct sockaddr_in6 local, peer;
+    socklen_t localLen = sizeof local, peerLen = sizeof peer;
+    if (::getsockname(fd, sockets::sockaddr_cast(&local), &localLen) == 0 &&
+        ::getpeername(fd, sockets::sockaddr_cast(&peer), &peerLen) == 0 &&
+        InetAddress(local).toIpPort() == conn->localAddress().toIpPort() &&
+        InetAddress(peer).toIpPort() == conn->peerAddress().toIpPort())
+    {
+      return fd;
+    }
+  }
+  return -1;
+}
+
+void checkInRange(const char *name, double after, double timeout)
+{
+  printf("%-10s closed after %.3fs\n", name, after);
+  assert(after >= timeout);
+  assert(after < timeout + kLate);
+}
+
+// 60秒空闲超时的连接先建立，loop上先有了1秒tick的轮子，0.2秒的空闲超时照样按时断开
+void checkMixedTicks()
+{
+  EventLoop loop;
+  TcpServer slow(&loop, InetAddress(kSlowPort), "Slow");
+  slow.setIdleTimeout(60);
+  slow.start();
+  const double kFast = 0.2;
+  TcpServer fast(&loop, InetAddress(kFastPort), "Fast");
+  fast.setIdleTimeout(kFast);
+  Timestamp connected;
+  double after = -1.0;
+  fast.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+    if (conn->connected())
+    {
+      connected = Timestamp::now();
+    }
+    else
+    {
+      after = timeDifference(Timestamp::now(), connected);
+      loop.quit();
+    }
+  });
+  fast.start();
+
+  TcpClient fastClient(&loop, InetAddress("127.0.0.1", kFastPort), "FastClient");
+  TcpClient slowClient(&loop, InetAddress("127.0.0.1", kSlowPort), "SlowClient");
+  slowClient.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+    if (conn->connected())
+    {
+      // 服务端那边已经建好轮子了
+      loop.runAfter(0.05, [&] { fastClient.connect(); });
+    }
+  });
+  slowClient.connect();
+  loop.runAfter(3.0, [&] { loop.quit(); });
+  loop.loop();
+
+  checkInRange("mixed", after, kFast);
+  assert(loop.timeoutWheel(60.0 / 8)->tickSeconds() == 1.0);
+  assert(loop.timeoutWheel(60.0 / 8)->size() == 1);
+  assert(loop.timeoutWheel(kFast / 8)->tickSeconds() < kFast / 8);
+}
+
+int main()
+{
+  Logger::setLogLevel(Logger::WARN);
+  checkMixedTicks();
+  EventLoop loop;
+
+  std::map<string, Closed> idleClosed;
+  TcpServer idle(&loop, InetAddress(kIdlePort), "Idle");
+  idle.setIdleTimeout(kTimeout);
+  track(&idle, &idleClosed);
+  idle.start();
+
+  std::map<string, Closed> readClosed;
+  TcpServer read(&loop, InetAddress(kReadPort), "Read");
+  read.setReadTimeout(kTimeout);
+  track(&read, &readClosed);
+  read.start();
+
+  // 只有写超时：连上就发很多，对端不读
+  std::map<string, Closed> writeClosed;
+  TcpServer write(&loop, InetAddress(kWritePort), "Write");
+  write.setWriteTimeout(kTimeout);
+  track(&write, &writeClosed);
+  write.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+    buf->retrieveAll();
+    conn->send(string(64 * 1024 * 1024, 'x'));
+  });
+  write.start();
+
+  // 1. 一直不说话的连接
+  TcpClient silent(&loop, InetAddress("127.0.0.1", kIdlePort), "Silent");
+  silent.connect();
+
+  // 2. 前一秒每0.1秒发一个字节，之后不说话
+  TcpClient chatty(&loop, InetAddress("127.0.0.1", kIdlePort), "Chatty");
+  chatty.connect();
+  Timestamp chattyStopped;
+  TimerId chat = loop.runEvery(0.1, [&] {
+    if (chatty.connection())
+    {
+      chatty.connection()->send("x");
+    }
+  });
+  loop.runAfter(1.0, [&] {
+    loop.cancel(chat);
+    chattyStopped = Timestamp::now();
+  });
+
+  // 3. 服务端一直在发，但是对端不发，读超时照样断开
+  TcpClient listener(&loop, InetAddress("127.0.0.1", kReadPort), "Listener");
+  listener.connect();
+  // 服务端定时给所有连接推数据
+  loop.runEvery(0.05, [&] { read.broadcast(SharedPayload(string("tick"))); });
+
+  // 4. 不读的客户端，服务端写不动了
+  TcpClient stuck(&loop, InetAddress("127.0.0.1", kWritePort), "Stuck");
+  stuck.setConnectionCallback([](const TcpConnectionPtr &conn) {
+    if (conn->connected())
+    {
+      conn->stopRead();
+      conn->send("go");
+    }
+  });
+  stuck.connect();
+
+  // 5. 只有写超时时，没东西要写的连接一直不断开
+  TcpClient quiet(&loop, InetAddress("127.0.0.1", kWritePort), "Quiet");
+  quiet.connect();
+
+  // 6. 安静超过写超时以后再发，内核缓冲区是满的，一个字节也写不进去，
+  // 写超时从这次发送算起，而不是上一次写成功的时候
+  TcpServer lateWrite(&loop, InetAddress(kLateWritePort), "LateWrite");
+  lateWrite.setWriteTimeout(kTimeout);
+  TcpConnectionPtr lateConn;
+  Timestamp lateSent;
+  double lateAfter = -1.0;
+  lateWrite.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+    if (conn->connected())
+    {
+      lateConn = conn;
+    }
+    else
+    {
+      lateAfter = timeDifference(Timestamp::now(), lateSent);
+      lateConn.reset();
+    }
+  });
+  lateWrite.start();
+  TcpClient late(&loop, InetAddress("127.0.0.1", kLateWritePort), "Late");
+  late.setConnectionCallback([](const TcpConnectionPtr &conn) {
+    if (conn->connected())
+    {
+      conn->stopRead();
+    }
+  });
+  late.connect();
+  loop.runAfter(kTimeout * 2, [&] {
+    assert(lateConn);
+    const int fd = findSocket(lateConn);
+    assert(fd >= 0);
+    // 绕过TcpConnection写满内核缓冲区，单线程里客户端这期间不会读
+    const string chunk(64 * 1024, 'y');
+    while (::send(fd, chunk.data(), chunk.size(), MSG_DONTWAIT) > 0)
+    {
+    }
+    assert(errno == EAGAIN || errno == EWOULDBLOCK);
+    lateSent = Timestamp::now();
+    lateConn->send(chunk);
+    assert(lateConn->outputBuffer()->readableBytes() == chunk.size());
+  });
+
+  // 断开之前记下客户端的地址
+  std::map<const TcpClient *, string> addrs;
+  loop.runAfter(0.1, [&] {
+    for (const TcpClient *c : {&silent, &chatty, &listener, &stuck, &quiet})
+    {
+      assert(c->connection());
+      addrs[c] = c->connection()->localAddress().toIpPort();
+    }
+  });
+  loop.runAfter(2.0, [&] { loop.quit(); });
+  loop.loop();
+
+  checkInRange("silent", idleClosed[addrs[&silent]].after, kTimeout);
+  const double chattyAfter = idleClosed[addrs[&chatty]].after;
+  printf("%-10s closed after %.3fs, stopped talking at %.3fs\n", "chatty", chattyAfter,
+         timeDifference(chattyStopped, idleClosed[addrs[&chatty]].connected));
+  checkInRange("chatty", chattyAfter - timeDifference(chattyStopped, idleClosed[addrs[&chatty]].connected), kTimeout - 0.1);
+  checkInRange("listener", readClosed[addrs[&listener]].after, kTimeout);
+  checkInRange("stuck", writeClosed[addrs[&stuck]].after, kTimeout);
+  assert(writeClosed[addrs[&quiet]].after < 0);
+  checkInRange("late", lateAfter, kTimeout);
+  TimeoutWheel *wheel = loop.timeoutWheel(kTimeout / 8);
+  printf("wheel: %zu scheduled, %lld expired\n", wheel->size(), static_cast<long long>(wheel->expiredCount()));
+  printf("test_timeouts passed\n");
+}
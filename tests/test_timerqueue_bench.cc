@@ -0,0 +1,72 @@
+// SetTimerQueue和TimingWheelTimerQueue：加、刷新（取消再加，连接的空闲超时）、取消
+// 都在loop线程里调用，不经过pending functors
+#include "muduo/base/Timestamp.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/timer/SetTimerQueue.h"
+#include "muduo/net/timer/TimingWheelTimerQueue.h"
+
+#include <random>
+#include <vector>
+
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+double nsPerOp(Timestamp start, size_t ops)
+{
+  return timeDifference(Timestamp::now(), start) * 1e9 / static_cast<double>(ops);
+}
+
+void bench(const char *name, TimerQueue *queue, int n)
+{
+  std::mt19937 gen(n);
+  std::uniform_int_distribution<int> dist(1000, 60 * 1000);  // 1秒到1分钟，毫秒
+  const Timestamp now(Timestamp::now());
+  std::vector<Timestamp> whens(n);
+  for (Timestamp &when : whens)
+  {
+    when = Timestamp(now.microSecondsSinceEpoch() + dist(gen) * 1000);
+  }
+  std::vector<TimerId> ids(n);
+
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < n; ++i)
+  {
+    ids[i] = queue->addTimer([] {}, whens[i], 0.0);
+  }
+  double add = nsPerOp(start, n);
+
+  // 每个连接收到数据就把超时往后推
+  start = Timestamp::now();
+  for (int i = 0; i < n; ++i)
+  {
+    queue->cancel(ids[i]);
+    ids[i] = queue->addTimer([] {}, addTime(whens[i], 1.0), 0.0);
+  }
+  double refresh = nsPerOp(start, n);
+
+  start = Timestamp::now();
+  for (int i = 0; i < n; ++i)
+  {
+    queue->cancel(ids[i]);
+  }
+  double cancel = nsPerOp(start, n);
+  printf("%-6s %8d timers   add %6.0f ns   refresh %6.0f ns   cancel %6.0f ns\n", name, n, add, refresh, cancel);
+}
+
+int main()
+{
+  EventLoop loop;
+  for (int n : {10 * 1000, 100 * 1000, 1000 * 1000})
+  {
+    {
+      SetTimerQueue queue(&loop);
+      bench("set", &queue, n);
+    }
+    {
+      TimingWheelTimerQueue queue(&loop);
+      bench("wheel", &queue, n);
+    }
+  }
+}
@@ -0,0 +1,85 @@
+#undef NDEBUG
+// 错开1ms的一串timer，有slack时一组只设置一次timerfd，
+// 每个timer都不提前触发，也不超过when + slack太多
+#include "muduo/net/EventLoop.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kTimers = 1000;
+const int64_t kLateUs = 300 * 1000;  // 只有一个核的机器上也够了
+
+int64_t run(const char *name, double slack)
+{
+  EventLoop loop;
+  std::vector<int> order(kTimers);
+  for (int i = 0; i < kTimers; ++i)
+  {
+    order[i] = i;
+  }
+  // 乱序加入，新加的timer经常比已经设置的早
+  std::shuffle(order.begin(), order.end(), std::mt19937(kTimers));
+
+  const int64_t before = loop.timerfdResets();
+  const int64_t savedBefore = loop.timerfdResetsSaved();
+  const Timestamp base(addTime(Timestamp::now(), 0.05));
+  int fired = 0;
+  int late = 0;
+  for (int i : order)
+  {
+    const Timestamp when(base.microSecondsSinceEpoch() + i * 1000);
+    loop.runAt(
+        when,
+        [&, when] {
+          Timestamp now(Timestamp::now());
+          assert(!(now < when));
+          late += timeDifference(now, when) * 1e6 > static_cast<double>(kLateUs) + slack * 1e6;
+          ++fired;
+        },
+        slack);
+  }
+  // 一直有一个重复的timer，带着slack重新加入
+  int repeats = 0;
+  loop.runEvery(0.1, [&] { ++repeats; }, slack);
+
+  loop.runAfter(1.5, [&] { loop.quit(); });
+  loop.loop();
+
+  const int64_t resets = loop.timerfdResets() - before;
+  const int64_t saved = loop.timerfdResetsSaved() - savedBefore;
+  printf("%-6s slack %.3fs: %d fired, timerfd_settime %lld, saved %lld\n", name, slack, fired,
+         static_cast<long long>(resets), static_cast<long long>(saved));
+  assert(fired == kTimers);
+  assert(late == 0);
+  assert(repeats >= 10);
+  if (slack == 0.0)
+  {
+    assert(saved == 0);
+  }
+  return resets;
+}
+
+void check(const char *name)
+{
+  const int64_t exact = run(name, 0.0);
+  const int64_t grouped = run(name, 0.02);
+  // 20ms一组，1秒里大约50组
+  assert(grouped * 4 < exact);
+}
+
+int main()
+{
+  ::unsetenv("MUDUO_USE_TIMING_WHEEL");
+  check("set");
+  ::setenv("MUDUO_USE_TIMING_WHEEL", "1", 1);
+  check("wheel");
+  printf("test_timerslack passed\n");
+}
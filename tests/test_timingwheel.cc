@@ -0,0 +1,151 @@
+#undef NDEBUG
+// SetTimerQueue和TimingWheelTimerQueue跑同样的检查：
+// 不提前触发、按时间顺序、取消、回调里取消自己、其他线程加和取消、旧的TimerId不影响复用的节点
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/Thread.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/timer/TimingWheelTimerQueue.h"
+
+#include <random>
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kTimers = 2000;
+const int64_t kLateUs = 300 * 1000;  // 只有一个核的机器上也够了
+
+void check(const char *name)
+{
+  EventLoop loop;
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<int> dist(0, 700);  // 跨过第一层的256ms
+
+  // 1. 随机的一次性timer，一半马上取消
+  const Timestamp base(addTime(Timestamp::now(), 0.05));
+  std::vector<Timestamp> fired;
+  std::vector<bool> canceled(kTimers);
+  int late = 0;
+  for (int i = 0; i < kTimers; ++i)
+  {
+    Timestamp when(base.microSecondsSinceEpoch() + dist(gen) * 1000);
+    TimerId id = loop.runAt(when, [&, when, i] {
+      Timestamp now(Timestamp::now());
+      assert(!canceled[i]);
+      assert(!(now < when));
+      late += now.microSecondsSinceEpoch() - when.microSecondsSinceEpoch() > kLateUs;
+      fired.push_back(when);
+    });
+    if (i % 2)
+    {
+      canceled[i] = true;
+      loop.cancel(id);
+    }
+  }
+
+  // 2. 重复的timer在回调里取消自己
+  int repeats = 0;
+  TimerId every;
+  every = loop.runEvery(0.02, [&] {
+    if (++repeats == 5)
+    {
+      loop.cancel(every);
+    }
+  });
+
+  // 3. 其他线程加和取消
+  int fromThread = 0;
+  CountDownLatch added(1);
+  Thread thread([&] {
+    for (int i = 0; i < 200; ++i)
+    {
+      TimerId id = loop.runAfter(0.1, [&] { ++fromThread; });
+      if (i % 4 == 0)
+      {
+        loop.cancel(id);
+      }
+    }
+    added.countDown();
+  });
+  thread.start();
+
+  // 4. 到期以后再取消旧的TimerId，不能取消掉复用同一个节点的新timer
+  bool reused = false;
+  TimerId first = loop.runAfter(0.01, [] {});
+  loop.runAfter(0.03, [&] {
+    loop.runAfter(0.01, [&] { reused = true; });
+    loop.cancel(first);
+  });
+
+  // 5. 很远的timer不会提前触发，也不会让loop反复醒来
+  bool farFired = false;
+  loop.runAfter(3600, [&] { farFired = true; });
+
+  loop.runAfter(1.2, [&] { loop.quit(); });
+  loop.loop();
+  thread.join();
+  added.wait();
+
+  assert(fired.size() == static_cast<size_t>(kTimers / 2));
+  for (size_t i = 1; i < fired.size(); ++i)
+  {
+    assert(!(fired[i] < fired[i - 1]));
+  }
+  assert(late == 0);
+  assert(repeats == 5);
+  assert(fromThread == 150);
+  assert(reused);
+  assert(!farFired);
+
+  // 只剩很远的timer时，loop一直睡着
+  int64_t before = loop.iteration();
+  loop.runAfter(0.3, [&] { loop.quit(); });
+  loop.loop();
+  printf("%s: %zu fired, %lld iterations while idle\n", name, fired.size(), static_cast<long long>(loop.iteration() - before));
+  assert(loop.iteration() - before < 10);
+}
+
+// 1us一个tick，一秒多的timer会经过所有层的cascade
+void checkLevels()
+{
+  EventLoop loop;
+  TimingWheelTimerQueue wheel(&loop, 1);
+  std::mt19937 gen(7);
+  std::uniform_int_distribution<int> dist(0, 1500 * 1000);
+  const Timestamp base(Timestamp::now());
+  int fired = 0;
+  int late = 0;
+  for (int i = 0; i < kTimers; ++i)
+  {
+    Timestamp when(base.microSecondsSinceEpoch() + dist(gen));
+    wheel.addTimer(
+        [&, when] {
+          Timestamp now(Timestamp::now());
+          assert(!(now < when));
+          late += now.microSecondsSinceEpoch() - when.microSecondsSinceEpoch() > kLateUs;
+          ++fired;
+        },
+        when, 0.0);
+  }
+  assert(wheel.size() == static_cast<size_t>(kTimers));
+  loop.runAfter(1.8, [&] { loop.quit(); });
+  loop.loop();
+  printf("levels: %d fired\n", fired);
+  assert(fired == kTimers);
+  assert(late == 0);
+  assert(wheel.size() == 0);
+}
+
+int main()
+{
+  ::unsetenv("MUDUO_USE_TIMING_WHEEL");
+  check("set");
+  ::setenv("MUDUO_USE_TIMING_WHEEL", "1", 1);
+  check("wheel");
+  checkLevels();
+  printf("test_timingwheel passed\n");
+}
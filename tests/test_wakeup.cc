@@ -0,0 +1,85 @@
+#undef NDEBUG
+// 已经有一次wakeup没被读走的时候，后面的queueInLoop不再写eventfd，并且不会丢任务
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/Thread.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThread.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// loop阻塞在一个任务里，这期间投递的任务只需要一次wakeup
+void testSuppressed()
+{
+  EventLoopThread loopThread;
+  EventLoop *loop = loopThread.startLoop();
+  CountDownLatch blocked(1);
+  CountDownLatch release(1);
+  loop->queueInLoop([&] {
+    blocked.countDown();
+    release.wait();
+  });
+  blocked.wait();
+  const int64_t issued = loop->wakeupsIssued();
+  const int64_t suppressed = loop->wakeupsSuppressed();
+
+  const int kTasks = 1000;
+  CountDownLatch done(kTasks);
+  for (int i = 0; i < kTasks; ++i)
+  {
+    loop->queueInLoop([&] { done.countDown(); });
+  }
+  assert(loop->wakeupsIssued() == issued + 1);
+  assert(loop->wakeupsSuppressed() == suppressed + kTasks - 1);
+  release.countDown();
+  done.wait();
+  assert(EventLoop::allStatsString().find("wakeups_suppressed=") != string::npos);
+}
+
+// 多个线程一起投递，一个都不能丢
+void testNoLostWakeup()
+{
+  EventLoopThread loopThread;
+  EventLoop *loop = loopThread.startLoop();
+  const int kProducers = 4;
+  const int kRounds = 20000;
+  std::atomic<int> ran(0);
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int p = 0; p < kProducers; ++p)
+  {
+    threads.emplace_back(new Thread([&] {
+      for (int i = 0; i < kRounds; ++i)
+      {
+        // 每次都等上一个执行完，让loop反复进入poll再被唤醒
+        CountDownLatch latch(1);
+        loop->queueInLoop([&] {
+          ran.fetch_add(1);
+          latch.countDown();
+        });
+        latch.wait();
+      }
+    }));
+    threads.back()->start();
+  }
+  for (auto &thr : threads)
+  {
+    thr->join();
+  }
+  assert(ran.load() == kProducers * kRounds);
+  printf("issued %lld suppressed %lld\n", static_cast<long long>(loop->wakeupsIssued()),
+         static_cast<long long>(loop->wakeupsSuppressed()));
+}
+
+int main()
+{
+  testSuppressed();
+  testNoLostWakeup();
+  printf("test_wakeup passed\n");
+}
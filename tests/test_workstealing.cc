@@ -0,0 +1,174 @@
+#undef NDEBUG
+// WorkStealingThreadPool和ThreadPool用法一样：任务都执行一次，任务里提交的子任务
+// 进自己的deque、被别的worker偷走，maxQueueSize挡住提交者，stop()之后run()直接返回
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/CurrentThread.h"
+#include "muduo/base/Mutex.h"
+#include "muduo/base/Thread.h"
+#include "muduo/base/WorkStealingThreadPool.h"
+
+#include <atomic>
+#include <set>
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+
+using namespace muduo;
+
+void checkExternal()
+{
+  WorkStealingThreadPool pool("external");
+  std::atomic<int> inits(0);
+  pool.setThreadInitCallback([&inits] { ++inits; });
+  pool.start(4);
+
+  // 几个线程同时从外面提交
+  const int kThreads = 4;
+  const int kTasks = 20000;
+  std::atomic<int> done(0);
+  CountDownLatch finished(1);
+  std::vector<std::unique_ptr<Thread>> submitters;
+  for (int i = 0; i < kThreads; ++i)
+  {
+    submitters.emplace_back(new Thread([&] {
+      for (int j = 0; j < kTasks; ++j)
+      {
+        pool.run([&] {
+          if (++done == kThreads * kTasks)
+          {
+            finished.countDown();
+          }
+        });
+      }
+    }));
+    submitters.back()->start();
+  }
+  for (auto &t : submitters)
+  {
+    t->join();
+  }
+  finished.wait();
+  assert(done == kThreads * kTasks);
+  assert(inits == 4);
+  printf("external: %d tasks, %lld steals, %lld parks\n", done.load(), static_cast<long long>(pool.steals()), static_cast<long long>(pool.parks()));
+  pool.stop();
+}
+
+// 一个任务拆成两半，直到够小，只有一个提交者的时候全靠偷才能分到别的线程
+void split(WorkStealingThreadPool *pool, int n, std::atomic<int> *leaves, CountDownLatch *finished, Mutex *mutex, std::set<int> *tids)
+{
+  if (n == 1)
+  {
+    {
+      MutexGuard lock(*mutex);
+      tids->insert(CurrentThread::tid());
+    }
+    if (leaves->fetch_sub(1) == 1)
+    {
+      finished->countDown();
+    }
+    return;
+  }
+  pool->run([=] { split(pool, n / 2, leaves, finished, mutex, tids); });
+  pool->run([=] { split(pool, n - n / 2, leaves, finished, mutex, tids); });
+  // 稍微干点活，别的worker有时间来偷
+  CurrentThread::sleepUsec(10);
+}
+
+void checkNested()
+{
+  WorkStealingThreadPool pool("nested");
+  pool.start(4);
+  const int kLeaves = 4096;
+  std::atomic<int> leaves(kLeaves);
+  CountDownLatch finished(1);
+  Mutex mutex;
+  std::set<int> tids;
+  pool.run([&] { split(&pool, kLeaves, &leaves, &finished, &mutex, &tids); });
+  finished.wait();
+  printf("nested: %zu workers ran leaves, %lld steals\n", tids.size(), static_cast<long long>(pool.steals()));
+  assert(pool.steals() > 0);
+  assert(tids.size() > 1);
+  pool.stop();
+}
+
+void checkBounded()
+{
+  WorkStealingThreadPool pool("bounded");
+  pool.setMaxQueueSize(2);
+  pool.start(1);
+  CountDownLatch release(1);
+  std::atomic<int> done(0);
+  pool.run([&] {
+    release.wait();
+    ++done;
+  });
+  // 唯一的worker卡住了，排满两个以后第三个run()要等
+  CurrentThread::sleepUsec(10 * 1000);
+  pool.run([&] { ++done; });
+  pool.run([&] { ++done; });
+  assert(pool.queueSize() == 2);
+  std::atomic<bool> thirdQueued(false);
+  Thread submitter([&] {
+    pool.run([&] { ++done; });
+    thirdQueued = true;
+  });
+  submitter.start();
+  CurrentThread::sleepUsec(50 * 1000);
+  assert(!thirdQueued);
+  release.countDown();
+  submitter.join();
+  while (done < 4)
+  {
+    CurrentThread::sleepUsec(1000);
+  }
+  pool.stop();
+}
+
+void checkStop()
+{
+  // 单线程直接在调用者线程里跑
+  WorkStealingThreadPool inlinePool("inline");
+  inlinePool.start(0);
+  int ran = 0;
+  inlinePool.run([&ran] { ++ran; });
+  assert(ran == 1);
+
+  WorkStealingThreadPool pool("stop");
+  pool.start(2);
+  CountDownLatch started(2);
+  CountDownLatch release(1);
+  for (int i = 0; i < 2; ++i)
+  {
+    pool.run([&] {
+      started.countDown();
+      release.wait();
+    });
+  }
+  started.wait();
+  std::atomic<int> dropped(0);
+  for (int i = 0; i < 100; ++i)
+  {
+    pool.run([&dropped] { ++dropped; });
+  }
+  Thread stopper([&pool] { pool.stop(); });
+  stopper.start();
+  CurrentThread::sleepUsec(10 * 1000);
+  release.countDown();
+  stopper.join();
+  // 没开始的丢掉，stop()以后run()什么都不做
+  printf("stop: %d of 100 queued tasks ran\n", dropped.load());
+  pool.run([&dropped] { dropped = -1; });
+  assert(dropped >= 0);
+  assert(pool.queueSize() == 0);
+}
+
+int main()
+{
+  checkExternal();
+  checkNested();
+  checkBounded();
+  checkStop();
+  printf("test_workstealing passed\n");
+}
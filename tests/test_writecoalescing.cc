@@ -0,0 +1,75 @@
+#undef NDEBUG
+// 打开写合并后，一条消息分header/body/trailer三次send，检查数据完整，并且每轮loop只flush一次
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/InetAddress.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const uint16_t kPort = 20321;
+const int kMessages = 1000;
+
+string makeMessage(int i)
+{
+  char header[32];
+  snprintf(header, sizeof header, "%08d:", i);
+  return header + string(static_cast<size_t>(i % 100 + 1), static_cast<char>('a' + i % 26)) + "\r\n";
+}
+
+int main()
+{
+  Logger::setLogLevel(Logger::WARN);
+  EventLoop loop;
+
+  string expected;
+  for (int i = 0; i < kMessages; ++i)
+  {
+    expected += makeMessage(i);
+  }
+
+  TcpServer server(&loop, InetAddress(kPort), "Coalescing");
+  server.setWriteCoalescing(true);
+  server.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+    if (conn->connected())
+    {
+      // 每条消息一个定时器，各自在不同的loop迭代里发送
+      for (int i = 0; i < kMessages; ++i)
+      {
+        loop.runAfter(0.0001 * i, [conn, i] {
+          string msg = makeMessage(i);
+          conn->send(msg.data(), 9);
+          conn->send(msg.data() + 9, static_cast<int>(msg.size() - 11));
+          conn->send("\r\n");
+        });
+      }
+    }
+  });
+  server.start();
+
+  string received;
+  TcpClient client(&loop, InetAddress("127.0.0.1", kPort), "Client");
+  client.setMessageCallback([&](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+    received.append(buf->peek(), buf->readableBytes());
+    buf->retrieveAll();
+    if (received.size() == expected.size())
+    {
+      loop.quit();
+    }
+  });
+  client.connect();
+  loop.runAfter(30, [&] { loop.quit(); });
+  loop.loop();
+
+  assert(received == expected);
+  assert(loop.coalescedSends() == 3 * kMessages);
+  assert(loop.coalescedFlushes() > 0);
+  assert(loop.coalescedFlushes() <= kMessages);
+  printf("test_writecoalescing passed, %lld sends in %lld writes\n", static_cast<long long>(loop.coalescedSends()),
+         static_cast<long long>(loop.coalescedFlushes()));
+}
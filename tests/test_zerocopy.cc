@@ -0,0 +1,70 @@
+#undef NDEBUG
+// 用MSG_ZEROCOPY发送SharedPayload，检查数据完整，并且完成通知到达后payload被释放
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/InetAddress.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const uint16_t kPort = 20311;
+const int kRounds = 32;
+
+int main()
+{
+  Logger::setLogLevel(Logger::WARN);
+  EventLoop loop;
+
+  string data(1024 * 1024, 0);
+  for (size_t i = 0; i < data.size(); ++i)
+  {
+    data[i] = static_cast<char>(i * 13 % 251);
+  }
+  SharedPayload payload(data);
+  bool supported = true;
+
+  TcpServer server(&loop, InetAddress(kPort), "ZeroCopy");
+  server.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+    if (conn->connected())
+    {
+      supported = conn->setZeroCopy(true);
+      for (int i = 0; i < kRounds; ++i)
+      {
+        conn->send(payload);
+      }
+      // 小消息走普通的拷贝
+      conn->send("end");
+    }
+  });
+  server.start();
+
+  string received;
+  TcpClient client(&loop, InetAddress("127.0.0.1", kPort), "Client");
+  client.setMessageCallback([&](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+    received.append(buf->peek(), buf->readableBytes());
+    buf->retrieveAll();
+    if (received.size() == data.size() * kRounds + 3)
+    {
+      // 等一下完成通知
+      loop.runAfter(0.1, [&] { loop.quit(); });
+    }
+  });
+  client.connect();
+  loop.runAfter(30, [&] { loop.quit(); });
+  loop.loop();
+
+  assert(received.size() == data.size() * kRounds + 3);
+  for (int i = 0; i < kRounds; ++i)
+  {
+    assert(received.compare(data.size() * i, data.size(), data) == 0);
+  }
+  assert(received.compare(data.size() * kRounds, 3, "end") == 0);
+  // 连接还在，payload只被这里引用，说明内核的引用都已经释放
+  assert(payload.useCount() == 1);
+  printf("test_zerocopy passed%s\n", supported ? "" : " (SO_ZEROCOPY not supported, copied)");
+}